@@ -11,6 +11,9 @@
  *		cmd_malloc(): allocate some memory of a certain size for use
  *		cmd_free(): deallocate memory for future use
  *		cmd_memorymap(): print a table of free and used memory
+ *		cmd_memstat(): print the allocator statistics
+ *		cmd_memtrace(): print the allocation trace
+ *		cmd_masktime(): print the longest time interrupts were disabled/scheduler locked
  *		cmd_memset(): assigns a value to a certain region of memory
  *		cmd_memchk(): check to see if a certain value is stored in a particular region of memory
  *
@@ -33,6 +36,10 @@
  *		cmd_fputc(): writes a character to a file;
  *		cmd_fgetc(): reads a character from a file
  *		cmd_ls(): lists files in the specified directory
+ *		cmd_fsstat(): prints the file system statistics
+ *		cmd_ps(): lists the processes, the processor time and the memory they use
+ *		cmd_priority(): sets the priority of a process
+ *		cmd_quantum(): sets the quantum of a process
  */
 
 #include <errno.h>
@@ -49,7 +56,6 @@
 #include "lcdcConsole.h"
 #include "adc.h"
 #include "ctp.h"
-#include "delay.h"
 #include "svc.h"
 #include "intSerialIO.h"
 #include "PDB.h"
@@ -58,7 +64,7 @@
 #include "usr.h"
 #include "help.h"
 
-const unsigned long int delayCount = 0xe1a7f;
+const uint32_t cmdPollMs = 50; /* ms the polling commands sleep between two polls */
 
 const cmdCommandEntry_t commands[] = {{"date", cmd_date},
 									  {"echo", cmd_echo},
@@ -69,6 +75,9 @@ const cmdCommandEntry_t commands[] = {{"date", cmd_date},
 									  {"malloc", cmd_malloc},
 									  {"free", cmd_free},
 									  {"memorymap", cmd_memorymap},
+									  {"memstat", cmd_memstat},
+									  {"memtrace", cmd_memtrace},
+									  {"masktime", cmd_masktime},
 									  {"memset", cmd_memset},
 									  {"memchk", cmd_memchk},
 									  {"fopen",cmd_fopen},
@@ -79,6 +88,7 @@ const cmdCommandEntry_t commands[] = {{"date", cmd_date},
 									  {"fputc",cmd_fputc},
 									  {"fgetc",cmd_fgetc},
 									  {"ls",cmd_ls},
+									  {"fsstat",cmd_fsstat},
 									  {"ser2lcd",cmd_ser2lcd},
 									  {"touch2led",cmd_touch2led},
 									  {"pot2ser",cmd_pot2ser},
@@ -100,6 +110,9 @@ const cmdCommandEntry_t commands[] = {{"date", cmd_date},
 									  {"spawnFlashGB", cmd_spawnFlashGB},
 									  {"killFlashGB", cmd_killFlashGB},
 									  {"spawn", cmd_spawn},
+									  {"ps", cmd_ps},
+									  {"priority", cmd_priority},
+									  {"quantum", cmd_quantum},
 									  {"", NULL }};
 
 int toBool(int i);
@@ -243,7 +256,7 @@ utlErrno_t cmd_exit(int argc, char *argv[]) {
 	if (argc > 1) {
 		return utlArgNumERROR;
 	}
-	delay(delayCount);
+	SVCsleep(cmdPollMs);
 	exit(0);
 }
 
@@ -294,6 +307,8 @@ utlErrno_t cmd_help(int argc, char *argv[]) {
 		SVCprintStr(HELP_MALLOC);
 		SVCprintStr(HELP_FREE);
 		SVCprintStr(HELP_MEMMAP);
+		SVCprintStr(HELP_MEMSTAT);
+		SVCprintStr(HELP_MEMTRACE);
 		SVCprintStr(HELP_MEMSET);
 		SVCprintStr(HELP_MEMCHK);
 		return utlNoERROR;
@@ -318,6 +333,10 @@ utlErrno_t cmd_help(int argc, char *argv[]) {
 		SVCprintStr(HELP_LOG_PUR);
 		SVCprintStr(HELP_LOG_RD);
 		SVCprintStr(HELP_SPAWN);
+		SVCprintStr(HELP_PS);
+		SVCprintStr(HELP_PRIORITY);
+		SVCprintStr(HELP_QUANTUM);
+		SVCprintStr(HELP_MASKTIME);
 		return utlNoERROR;
 	}
 
@@ -334,6 +353,7 @@ utlErrno_t cmd_help(int argc, char *argv[]) {
 		SVCprintStr(HELP_FGET);
 		SVCprintStr(HELP_FPUR);
 		SVCprintStr(HELP_PRINT);
+		SVCprintStr(HELP_FSSTAT);
 		return utlNoERROR;
 	}
 
@@ -366,12 +386,15 @@ utlErrno_t cmd_help(int argc, char *argv[]) {
 		SVCprintStr(HELP_FGET);
 		SVCprintStr(HELP_FPUR);
 		SVCprintStr(HELP_PRINT);
+		SVCprintStr(HELP_FSSTAT);
 
 		SVCprintStr(HELP_DEPOSIT);
 		SVCprintStr(HELP_EXAM);
 		SVCprintStr(HELP_MALLOC);
 		SVCprintStr(HELP_FREE);
 		SVCprintStr(HELP_MEMMAP);
+		SVCprintStr(HELP_MEMSTAT);
+		SVCprintStr(HELP_MEMTRACE);
 		SVCprintStr(HELP_MEMSET);
 		SVCprintStr(HELP_MEMCHK);
 
@@ -381,6 +404,10 @@ utlErrno_t cmd_help(int argc, char *argv[]) {
 		SVCprintStr(HELP_LOG_PUR);
 		SVCprintStr(HELP_LOG_RD);
 		SVCprintStr(HELP_SPAWN);
+		SVCprintStr(HELP_PS);
+		SVCprintStr(HELP_PRIORITY);
+		SVCprintStr(HELP_QUANTUM);
+		SVCprintStr(HELP_MASKTIME);
 
 		return utlNoERROR;
 	}
@@ -982,6 +1009,132 @@ utlErrno_t cmd_memorymap(int argc, char *argv[]) {
 	return (utlNoERROR);
 }
 
+/* outputs the allocator statistics: bytes free and in use, largest free
+ * segment, allocation counts, the number of free segments per size class,
+ * and the bytes in use by each process. Takes no arguments beyond the
+ * command itself. The statistics are fetched with a supervisor call and
+ * are kept in allocated memory, since they do not fit well on the stack
+ * of a spawned command.
+ *
+ * param: int argc, char *argv[]
+ * return: utlErrno_t
+ */
+utlErrno_t cmd_memstat(int argc, char *argv[]) {
+	char str[shMAX_BUFFERSIZE + 1];
+	MemStats *stats_p;
+	MemErrno err;
+	unsigned i;
+
+	if (argc > 1) {
+		return utlArgNumERROR;
+	}
+
+	stats_p = SVCMalloc(sizeof(MemStats));
+	if (stats_p == NULL) {
+		return (utlMemERROR);
+	}
+
+	err = SVCmemStats(stats_p);
+	if (err != MEM_NO_ERROR) {
+		SVCFree(stats_p);
+		MEM_PRINT_ERROR_CODE("memstat", err);
+		return (utlFailERROR);
+	}
+
+	snprintf(str, shMAX_BUFFERSIZE,
+			"\r\n used: %u (peak %u)   free: %u   largest free: %u\r\n",
+			stats_p->usedBytes, stats_p->peakUsedBytes, stats_p->freeBytes,
+			stats_p->largestFree);
+	SVCprintStr(str);
+	snprintf(str, shMAX_BUFFERSIZE,
+			" allocs: %u   frees: %u   failed: %u   free segments: %u\r\n",
+			stats_p->numAllocs, stats_p->numFrees, stats_p->numFailed,
+			stats_p->numFree);
+	SVCprintStr(str);
+
+	SVCprintStr("\r\n free segments per size class:\r\n");
+	for (i = 0; i < MEM_FL_COUNT; i++) {
+		if (stats_p->freeHist[i] > 0) {
+			snprintf(str, shMAX_BUFFERSIZE, "   < %-10u | %u\r\n",
+					1U << (i + MEM_FL_SHIFT), stats_p->freeHist[i]);
+			SVCprintStr(str);
+		}
+	}
+
+	SVCprintStr("\r\n  PID    |  bytes in use\r\n");
+	for (i = 0; i < stats_p->numOwners; i++) {
+		snprintf(str, shMAX_BUFFERSIZE, " %-7d | %u\r\n",
+				stats_p->owner[i].processID, stats_p->owner[i].bytes);
+		SVCprintStr(str);
+	}
+
+	SVCFree(stats_p);
+	return (utlNoERROR);
+}
+
+/* outputs the allocation trace recorded by the memory manager, one line per
+ * event, so that it can be captured from the terminal and replayed on the
+ * host with memreplay. Takes a single argument, the action 'dump'. Calls
+ * memTraceDump from mem.c to complete execution of the command; the trace is
+ * only recorded if the project is built with MEM_TRACE defined.
+ *
+ * param: int argc, char *argv[]
+ * return: utlErrno_t
+ */
+utlErrno_t cmd_memtrace(int argc, char *argv[]) {
+	if (argc != 2) {
+		return utlArgNumERROR;
+	}
+
+	if (!utlStrCmp("dump", argv[1])) {
+		return utlArgValERROR;
+	}
+
+	memTraceDump();
+	return (utlNoERROR);
+}
+
+/* outputs the longest time interrupts were disabled, and the longest time the
+ * scheduler was locked, since start up or the last reset, with the address of
+ * the code that ended each of these windows. Takes an optional argument 'reset'
+ * to start the measurement over.
+ *
+ * param: int argc, char *argv[]
+ * return: utlErrno_t
+ */
+utlErrno_t cmd_masktime(int argc, char *argv[]) {
+	char str[shMAX_BUFFERSIZE + 1];
+	utlMaskStats_t stats;
+
+	if (argc > 2) {
+		return utlArgNumERROR;
+	}
+
+	if (argc == 2) {
+		if (!utlStrCmp("reset", argv[1])) {
+			return utlArgValERROR;
+		}
+		utlResetMaskStats();
+		return (utlNoERROR);
+	}
+
+	utlGetMaskStats(&stats);
+	snprintf(str, shMAX_BUFFERSIZE,
+			"interrupts disabled: %u cycles (%u us), ended at %p\r\n",
+			(unsigned) stats.diMaxCycles,
+			(unsigned) UTL_CYCLES_TO_USEC(stats.diMaxCycles),
+			stats.diMaxCaller_p);
+	SVCprintStr(str);
+	snprintf(str, shMAX_BUFFERSIZE,
+			"scheduler locked:    %u cycles (%u us), ended at %p\r\n",
+			(unsigned) stats.lockMaxCycles,
+			(unsigned) UTL_CYCLES_TO_USEC(stats.lockMaxCycles),
+			stats.lockMaxCaller_p);
+	SVCprintStr(str);
+
+	return (utlNoERROR);
+}
+
 /* assigns a value to a specified region of memory. It takes  three
  * arguments: the start address of a memory region, the value
  * to which each byte in the specified region will be set, and
@@ -1500,6 +1653,33 @@ utlErrno_t cmd_ls(int argc, char *argv[]) {
 	return (utlErrno);
 }
 
+/* prints the file system statistics: how many path names were found in the
+ * path lookup cache and how many had to be looked up dir by dir, and how many
+ * the cache holds. Takes no arguments beyond the command itself.
+ *
+ * param: int argc, char *argv[]
+ * return: utlErrno_t
+ */
+utlErrno_t cmd_fsstat(int argc, char *argv[]) {
+	char str[shMAX_BUFFERSIZE + 1];
+	FioStats stats;
+
+	if (argc > 1) {
+		return utlArgNumERROR;
+	}
+
+	if (SVCfsStats(&stats) == -1) {
+		return (utlFailERROR);
+	}
+
+	snprintf(str, shMAX_BUFFERSIZE,
+			"\r\n path lookups: %u cached, %u walked   cached paths: %u of %u\r\n",
+			stats.pathHits, stats.pathMisses, stats.pathEntries,
+			FIO_PATH_CACHE_SIZE);
+	SVCprintStr(str);
+	return (utlNoERROR);
+}
+
 /* Continuously copy characters from serial input to LCD.  End on
  * a ^D (control-D) input character.  The behavior of the LCD device
  * should mirror the behavior of our terminal emulator.  That is,
@@ -1642,10 +1822,10 @@ utlErrno_t cmd_touch2led(int argc, char *argv[]){
 				SVCFPutc('0', getPresetDev("BLUE"));
 			}
 		}
-		delay(delayCount);
+		SVCsleep(cmdPollMs);
 	}
 
-	delay(delayCount);
+	SVCsleep(cmdPollMs);
 	SVCFPutc('0', getPresetDev("ORANGE"));
 	SVCFPutc('0', getPresetDev("YELLOW"));
 	SVCFPutc('0', getPresetDev("GREEN"));
@@ -1691,7 +1871,7 @@ utlErrno_t cmd_pot2ser(int argc, char *argv[]){
 		snprintf(str, shMAX_BUFFERSIZE, "pot: %4u\r\n",
 				(unsigned int) SVCFGetc(getPresetDev("POTENTIOMETER")));
 		SVCprintStr(str);
-		delay(delayCount);
+		SVCsleep(cmdPollMs);
 	}
 
 	SVCFClose(fi1);
@@ -1728,7 +1908,7 @@ utlErrno_t cmd_therm2ser(int argc, char *argv[]){
 		snprintf(str, shMAX_BUFFERSIZE, "temp: %4u\r\n",
 				(unsigned int) SVCFGetc(getPresetDev("THERMISTOR")));
 		SVCprintStr(str);
-		delay(delayCount);
+		SVCsleep(cmdPollMs);
 	}
 
 	SVCFClose(fi1);
@@ -1785,7 +1965,7 @@ utlErrno_t cmd_pb2led(int argc, char *argv[]){
 			SVCFPutc('0', getPresetDev("YELLOW"));
 		}
 	}
-	delay(delayCount);
+	SVCsleep(cmdPollMs);
 	SVCFPutc('0', getPresetDev("ORANGE"));
 	SVCFPutc('0', getPresetDev("YELLOW"));
 
@@ -2009,18 +2189,28 @@ utlErrno_t cmd_multitask(int argc, char *argv[]){
 	}
 	utlErrno = utlNoERROR;
 
-	pid_t first = getNextPID();
-	pid_t second = getNextPID();
-	pid_t third = getNextPID();
+	pid_t first, second, third; /* set by spawn */
 	shArg_t arg1;
 	shArg_t arg2;
 	shArg_t arg3;
 	arg1.argc = 1;
 	arg1.argv = NULL;
+	arg1.memQuota = 0;
+	arg1.priority = PCB_DEFAULT_PRIORITY;
+	arg1.stdin_p = NULL;
+	arg1.stdout_p = NULL;
 	arg2.argc = 1;
 	arg2.argv = NULL;
+	arg2.memQuota = 0;
+	arg2.priority = PCB_DEFAULT_PRIORITY;
+	arg2.stdin_p = NULL;
+	arg2.stdout_p = NULL;
 	arg3.argc = 1;
 	arg3.argv = NULL;
+	arg3.memQuota = 0;
+	arg3.priority = PCB_DEFAULT_PRIORITY;
+	arg3.stdin_p = NULL;
+	arg3.stdout_p = NULL;
 
 	int i = SVCspawn(cmd_ser2lcd, &arg1, STACK_SIZE, &first);
 	if(i == -1){
@@ -2040,7 +2230,7 @@ utlErrno_t cmd_multitask(int argc, char *argv[]){
 		return (utlErrno);
 	}
 
-	SVCwait(first);
+	SVCwait(first, NULL);
 	SVCmyKill(second);
 	SVCmyKill(third);
 
@@ -2313,13 +2503,17 @@ utlErrno_t cmd_spawnFlashGB(int argc, char *argv[]){
 		return (utlPrivERROR);
 	}
 
-	flashGBpid = getNextPID();
 	shArg_t arg;
 	arg.argc = 1;
 	arg.argv = NULL;
+	arg.memQuota = 0;
+	arg.priority = PCB_DEFAULT_PRIORITY;
+	arg.stdin_p = NULL;
+	arg.stdout_p = NULL;
 
 	int i = SVCspawn(flashGB, &arg, STACK_SIZE, &flashGBpid);
 	if (i == -1) {
+		flashGBpid = -1;
 		utlErrno = utlFailERROR;
 		return (utlErrno);
 	}
@@ -2348,23 +2542,39 @@ utlErrno_t cmd_spawn(int argc, char *argv[]){
 		return (utlPrivERROR);
 	}
 
-	if (argc != 2) {
+	if ((argc < 2) || (argc > 4)) {
 		return utlArgNumERROR;
 	}
 
 	shArg_t arg;
 	arg.argc = 1;
 	arg.argv = NULL;
+	arg.memQuota = 0;
+	arg.priority = PCB_DEFAULT_PRIORITY;
+	arg.stdin_p = NULL;
+	arg.stdout_p = NULL;
+
+	if (argc >= 3) {
+		if (cmdValidNum(argv[2]) != utlNoERROR) {
+			return (utlArgValERROR);
+		}
+		arg.memQuota = (unsigned) utlAtoD(argv[2]);
+	}
+	if (argc == 4) {
+		if (cmdValidNum(argv[3]) != utlNoERROR) {
+			return (utlArgValERROR);
+		}
+		arg.priority = (int) utlAtoD(argv[3]);
+	}
 
 	int j;
 	if(utlStrCmp(argv[1], "flashGB")){
-		flashGBpid = getNextPID();
 		j = SVCspawn(flashGB, &arg, STACK_SIZE, &flashGBpid);
 	} else if ((utlStrCmp(argv[1], "touch2led"))
 			|| (utlStrCmp(argv[1], "flashled"))
 			|| (utlStrCmp(argv[1], "pb2led"))) {
 		int i = cmdMatch(argv[1]);
-		int k = getNextPID();
+		pid_t k;
 		j = SVCspawn(commands[i].functionp, &arg, STACK_SIZE, &k);
 	}else{
 		return (utlFailERROR);
@@ -2376,6 +2586,124 @@ utlErrno_t cmd_spawn(int argc, char *argv[]){
 
 	return (utlNoERROR);
 }
+/* sets the priority of a process; 0 is the highest, PCB_PRIORITIES - 1 the
+ * lowest, and processes are spawned with PCB_DEFAULT_PRIORITY. Takes the pid
+ * of the process and the priority. Can only be run by admin.
+ *
+ * param: int argc, char *argv[]
+ * return: utlErrno_t
+ */
+utlErrno_t cmd_priority(int argc, char *argv[]){
+	if (!usrAdmin()) {
+		logWrite(FIO_INVREQ_READ, "unprivileged user",
+				"attempted to execute 'priority'");
+		return (utlPrivERROR);
+	}
+
+	if (argc != 3) {
+		return utlArgNumERROR;
+	}
+
+	if ((cmdValidNum(argv[1]) != utlNoERROR)
+			|| (cmdValidNum(argv[2]) != utlNoERROR)) {
+		return (utlArgValERROR);
+	}
+
+	if (SVCsetPriority((pid_t) utlAtoD(argv[1]), (int) utlAtoD(argv[2])) == -1) {
+		return (utlFailERROR);
+	}
+
+	return (utlNoERROR);
+}
+
+/* sets the quantum of a process: the ms it runs before a process of the same
+ * priority gets a turn, from 1 to SYSTICK_MAX_QUANTUM; processes are spawned
+ * with PROCESS_QUANTUM. Takes the pid of the process and the quantum. Can only
+ * be run by admin.
+ *
+ * param: int argc, char *argv[]
+ * return: utlErrno_t
+ */
+utlErrno_t cmd_quantum(int argc, char *argv[]){
+	if (!usrAdmin()) {
+		logWrite(FIO_INVREQ_READ, "unprivileged user",
+				"attempted to execute 'quantum'");
+		return (utlPrivERROR);
+	}
+
+	if (argc != 3) {
+		return utlArgNumERROR;
+	}
+
+	if ((cmdValidNum(argv[1]) != utlNoERROR)
+			|| (cmdValidNum(argv[2]) != utlNoERROR)) {
+		return (utlArgValERROR);
+	}
+
+	if (SVCsetQuantum((pid_t) utlAtoD(argv[1]), (int) utlAtoD(argv[2])) == -1) {
+		return (utlFailERROR);
+	}
+
+	return (utlNoERROR);
+}
+
+/* lists the processes: PID, state, priority, quantum, share of the processor since it was
+ * spawned and time run, how deep its stack was used, and the memory each one holds
+ * against its quota. Takes no arguments. The PCBs are copied with a supervisor
+ * call, so that the list does not change while it is walked.
+ *
+ * param: int argc, char *argv[]
+ * return: utlErrno_t
+ */
+utlErrno_t cmd_ps(int argc, char *argv[]){
+	const char *stateName[] = {"ready", "running", "blocked", "kill"};
+	char str[shMAX_BUFFERSIZE + 1];
+	char quota[16];
+	char stack[24];
+	PcbInfo *info_p;
+	int i, n;
+
+	if (argc != 1) {
+		return utlArgNumERROR;
+	}
+
+	info_p = SVCMalloc(sizeof(PcbInfo) * PCB_MAX_INFO);
+	if (info_p == NULL) {
+		return (utlMemERROR);
+	}
+
+	n = SVCpcbInfo(info_p, PCB_MAX_INFO);
+
+	SVCprintStr("\r\n  PID    |  state   |  prio  |  q ms  |  cpu %  |  cpu ms    |  stack used  |  mem used  |  quota\r\n");
+	for (i = 0; i < n; i++) {
+		if (info_p[i].memQuota == 0) {
+			snprintf(quota, sizeof(quota), "-");
+		} else {
+			snprintf(quota, sizeof(quota), "%u", info_p[i].memQuota);
+		}
+		if (info_p[i].stackUsed < 0) {
+			snprintf(stack, sizeof(stack), "-");
+		} else {
+			snprintf(stack, sizeof(stack), "%d/%d", info_p[i].stackUsed,
+					info_p[i].stackSize);
+		}
+		snprintf(str, shMAX_BUFFERSIZE,
+				" %-7d | %-8s | %-6d | %-6u | %3u.%u   | %-10u | %-12s | %-10u | %s\r\n",
+				info_p[i].processID, stateName[info_p[i].state],
+				info_p[i].priority, (unsigned) info_p[i].quantum, info_p[i].cpuPermille / 10,
+				info_p[i].cpuPermille % 10, (unsigned) info_p[i].cpuMs, stack,
+				info_p[i].memUsed, quota);
+		SVCprintStr(str);
+	}
+
+	/* the time slept away by the polling commands shows up here */
+	snprintf(str, shMAX_BUFFERSIZE, "\r\n idle: %u ms\r\n", (unsigned) SVCidleTime());
+	SVCprintStr(str);
+
+	SVCFree(info_p);
+	return (utlNoERROR);
+}
+
 /*helpers*/
 int toBool(int i){
 	if (i == 49){
@@ -2401,7 +2729,7 @@ utlErrno_t pb2uart(int argc, char *argv[]){
 	while(1){
 		if(toBool(SVCFGetc(getPresetDev("SW2")))){
 			SVCprintStr("Hello user!\r\n");
-			delay(0x259BF); //to slow the output down
+			SVCsleep(10); //to slow the output down
 		}
 	}
 }
@@ -2425,6 +2753,6 @@ utlErrno_t flashGB(int argc, char *argv[]){
 			myfputc('1', getPresetDev("BLUE"));
 			myfputc('0', getPresetDev("GREEN"));
 		}
-		delay(delayCount);
+		SVCsleep(cmdPollMs);
 	}
 }
@@ -17,6 +17,8 @@ typedef struct commandEntry {
 	utlErrno_t (*functionp)(int argc, char *argv[]);
 } cmdCommandEntry_t;
 
+extern const cmdCommandEntry_t commands[]; /* command table; ends with a NULL functionp */
+
 #define CHAR_EOF 4
 
 #ifndef ALLOCATE_
@@ -35,6 +37,9 @@ utlErrno_t cmd_unset(int argc, char *argv[]);
 utlErrno_t cmd_malloc(int argc, char *argv[]);
 utlErrno_t cmd_free(int argc, char *argv[]);
 utlErrno_t cmd_memorymap(int argc, char *argv[]);
+utlErrno_t cmd_memstat(int argc, char *argv[]);
+utlErrno_t cmd_memtrace(int argc, char *argv[]);
+utlErrno_t cmd_masktime(int argc, char *argv[]);
 utlErrno_t cmd_memset(int argc, char *argv[]);
 utlErrno_t cmd_memchk(int argc, char *argv[]);
 utlErrno_t cmd_fopen(int argc, char *argv[]);
@@ -45,6 +50,7 @@ utlErrno_t cmd_rewind(int argc, char *argv[]);
 utlErrno_t cmd_fputc(int argc, char *argv[]);
 utlErrno_t cmd_fgetc(int argc, char *argv[]);
 utlErrno_t cmd_ls(int argc, char *argv[]);
+utlErrno_t cmd_fsstat(int argc, char *argv[]);
 utlErrno_t cmd_ser2lcd(int argc, char *argv[]);
 utlErrno_t cmd_touch2led(int argc, char *argv[]);
 utlErrno_t cmd_pot2ser(int argc, char *argv[]);
@@ -66,6 +72,9 @@ utlErrno_t cmd_logpurge(int argc, char *argv[]);
 utlErrno_t cmd_spawnFlashGB(int argc, char *argv[]);
 utlErrno_t cmd_killFlashGB(int argc, char *argv[]);
 utlErrno_t cmd_spawn(int argc, char *argv[]);
+utlErrno_t cmd_ps(int argc, char *argv[]);
+utlErrno_t cmd_priority(int argc, char *argv[]);
+utlErrno_t cmd_quantum(int argc, char *argv[]);
 
 /* helper functions */
 utlErrno_t cmdExecute(int i, int argc, char *argv_p[]);
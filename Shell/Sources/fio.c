@@ -23,6 +23,8 @@
 #include "ctp.h"
 #include "intSerialIO.h"
 #include "delay.h"
+#include "pipe.h"
+#include "cmd.h"
 
 /* not declared in mem.h, since to be used by OS only */
 extern void *memAlloc(unsigned size, bool setPID);
@@ -39,13 +41,26 @@ FioErrno fioInit(void) {
 		return FIO_NO_ERROR;
 	}
 
-	/* create inode table */
+	/* create inode table: the first chunk, with the reserved entries; */
+	/* the others are added by getFreeInodeIdx as files are created */
 
-	inode = (INode *) myMalloc((sizeof(INode)) * FIO_MAX_FILES);
-	if (!inode){
+	firstFreeInode = FIO_MAX_FILES;
+	if (inodeChunkAdd() == -1){
 		return FIO_INIT_FAILED;
 	}
 
+	/* create pools for file blocks */
+
+	if ((poolCreate(&fioBlockPool, sizeof(Block), FIO_BLOCKS_PER_CHUNK) == -1)
+			|| (poolCreate(&fioDataPool, FIO_BLOCK_SIZE, FIO_BLOCKS_PER_CHUNK)
+					== -1)
+			|| (poolCreate(&fioDirEntryPool, sizeof(DirEntry),
+					FIO_DIR_ENTRIES_PER_CHUNK) == -1)) {
+		return FIO_INIT_FAILED;
+	}
+
+	pathCacheInit();
+
 	/* setup device types */
 
 	/* ram files */
@@ -56,6 +71,8 @@ FioErrno fioInit(void) {
 	fioDevice[RAM].fputc = ramPutc;
 	fioDevice[RAM].fputs = ramPuts;
 	fioDevice[RAM].fgets = ramGets;
+	fioDevice[RAM].fread = ramRead;
+	fioDevice[RAM].fwrite = ramWrite;
 	fioDevice[RAM].create = fileCreate;
 	fioDevice[RAM].delete = fileDelete;
 	fioDevice[RAM].rewind = fileRewind;
@@ -69,6 +86,8 @@ FioErrno fioInit(void) {
 	fioDevice[STD].fputc = stdPutc;
 	fioDevice[STD].fputs = stubPuts; //talk about
 	fioDevice[STD].fgets = stubGets; //talk about
+	fioDevice[STD].fread = charRead;
+	fioDevice[STD].fwrite = charWrite;
 	fioDevice[STD].create = stubCr;
 	fioDevice[STD].delete = stubC;
 	fioDevice[STD].rewind = stubI;
@@ -84,6 +103,8 @@ FioErrno fioInit(void) {
 	fioDevice[LED].fputc = ledPutc;
 	fioDevice[LED].fputs = stubPuts;
 	fioDevice[LED].fgets = stubGets;
+	fioDevice[LED].fread = charRead;
+	fioDevice[LED].fwrite = charWrite;
 	fioDevice[LED].create = stubCr;
 	fioDevice[LED].delete = stubC;
 	fioDevice[LED].rewind = stubI;
@@ -97,6 +118,8 @@ FioErrno fioInit(void) {
 	fioDevice[PUSH_BUTTON].fputc = pbPutc;
 	fioDevice[PUSH_BUTTON].fputs = stubPuts;
 	fioDevice[PUSH_BUTTON].fgets = stubGets;
+	fioDevice[PUSH_BUTTON].fread = charRead;
+	fioDevice[PUSH_BUTTON].fwrite = charWrite;
 	fioDevice[PUSH_BUTTON].create = stubCr;
 	fioDevice[PUSH_BUTTON].delete = stubC;
 	fioDevice[PUSH_BUTTON].rewind = stubI;
@@ -110,6 +133,8 @@ FioErrno fioInit(void) {
 	fioDevice[TWR_LCD].fputc = lcdPutc;
 	fioDevice[TWR_LCD].fputs = stubPuts;
 	fioDevice[TWR_LCD].fgets = stubGets;
+	fioDevice[TWR_LCD].fread = charRead;
+	fioDevice[TWR_LCD].fwrite = charWrite;
 	fioDevice[TWR_LCD].create = stubCr;
 	fioDevice[TWR_LCD].delete = stubC;
 	fioDevice[TWR_LCD].rewind = stubI;
@@ -123,6 +148,8 @@ FioErrno fioInit(void) {
 	fioDevice[ANALOG].fputc = anlgPutc;
 	fioDevice[ANALOG].fputs = stubPuts;
 	fioDevice[ANALOG].fgets = stubGets;
+	fioDevice[ANALOG].fread = charRead;
+	fioDevice[ANALOG].fwrite = charWrite;
 	fioDevice[ANALOG].create = stubCr;
 	fioDevice[ANALOG].delete = stubC;
 	fioDevice[ANALOG].rewind = stubI;
@@ -136,24 +163,35 @@ FioErrno fioInit(void) {
 	fioDevice[TOUCH_SENSOR].fputc = tsPutc;
 	fioDevice[TOUCH_SENSOR].fputs = stubPuts;
 	fioDevice[TOUCH_SENSOR].fgets = stubGets;
+	fioDevice[TOUCH_SENSOR].fread = charRead;
+	fioDevice[TOUCH_SENSOR].fwrite = charWrite;
 	fioDevice[TOUCH_SENSOR].create = stubCr;
 	fioDevice[TOUCH_SENSOR].delete = stubC;
 	fioDevice[TOUCH_SENSOR].rewind = stubI;
 	fioDevice[TOUCH_SENSOR].purge = stubC;
 
-	/* init inode table */
-
-	/* set all inodes starting from the last reserved entry free; */
-	/* the last free points to invalid FIO_MAX_FILES index */
-	firstFreeInode = LAST_RESERVED_TYPE + 1;
-	unsigned short i = firstFreeInode;
-	for (; i < FIO_MAX_FILES; i++) {
-		inode[i].nextFreeIdx = i + 1;
+	/* PIPE file */
+	if (pipeInit() == -1) {
+		return FIO_INIT_FAILED;
 	}
+	fioDevice[PIPE].type = PIPE;
+	fioDevice[PIPE].fopen = pipeOpen;
+	fioDevice[PIPE].fclose = pipeClose;
+	fioDevice[PIPE].fgetc = pipeGetc;
+	fioDevice[PIPE].fputc = pipePutc;
+	fioDevice[PIPE].fputs = pipePuts;
+	fioDevice[PIPE].fgets = pipeGets;
+	fioDevice[PIPE].fread = pipeFread;
+	fioDevice[PIPE].fwrite = pipeFwrite;
+	fioDevice[PIPE].create = stubCr;
+	fioDevice[PIPE].delete = stubC;
+	fioDevice[PIPE].rewind = stubI;
+	fioDevice[PIPE].purge = stubC;
 
 	/*init hw nodes*/
+	unsigned short i;
 	for (i = HW_DEV; i <= LAST_RESERVED_TYPE; i++) {
-		inode[i].accessCount = USHRT_MAX;
+		INODE(i).accessCount = USHRT_MAX;
 	}
 
 	/* init stream table: */
@@ -203,11 +241,14 @@ myFILE myfopen(char *name_p, char *mode_p) {
  * returns -1 if not successful
  */
 int myfclose(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
 	if (fi <= HW_DEV) {
+		if (pipeOfStream_p(fi) != NULL) {
+			return pipeClose(fi); /* the stream goes back to the UART */
+		}
 		 return fileRewind(fi); /* reserved streams always stay open */
 	}
 
@@ -234,7 +275,7 @@ int myfclose(myFILE fi) {
  * returns the int that corresponds to the char written
  */
 int myfputc(int c, myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -262,7 +303,7 @@ int myfputc(int c, myFILE fi) {
  * returns -1 if fails
  */
 int myrewind(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -289,7 +330,7 @@ int myrewind(myFILE fi) {
  * returns a char read converted to an int
  */
 int myfgetc(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -312,7 +353,7 @@ int myfgetc(myFILE fi) {
 }
 
 int myfputs(char *s_p, myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)) {
+	if ((fi < 0) || (fi >= pcbNumStreams())) {
 		return -1;
 	}
 
@@ -335,7 +376,7 @@ int myfputs(char *s_p, myFILE fi) {
 }
 
 int myfgets(char *s_p, int len, myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)) {
+	if ((fi < 0) || (fi >= pcbNumStreams())) {
 		return -1;
 	}
 
@@ -357,6 +398,51 @@ int myfgets(char *s_p, int len, myFILE fi) {
 	return sts;
 }
 
+/* writes len bytes from buf_p to a file, in as few copies as the device
+ * allows; returns the number of bytes written, or -1 if fails
+ */
+int myfwrite(const void *buf_p, int len, myFILE fi) {
+	if ((fi < 0) || (fi >= pcbNumStreams())) {
+		return -1;
+	}
+
+	int type;
+	uint8_t streamIdx = fi;
+	ProcessControlBlock *pcb_p = getCurrentPCB();
+	if (!pcb_p) {
+		return -1;
+	}
+	if (pcb_p->stream[streamIdx].device_p == NULL) {
+		return -1; /* stream not allocated */
+	}
+	type = pcb_p->stream[streamIdx].device_p->type;
+
+	return (*(fioDevice[type].fwrite))(buf_p, len, streamIdx);
+}
+
+/* reads up to len bytes of a file into buf_p, in as few copies as the device
+ * allows; returns the number of bytes read, 0 at the end of file, or -1 if
+ * fails
+ */
+int myfread(void *buf_p, int len, myFILE fi) {
+	if ((fi < 0) || (fi >= pcbNumStreams())) {
+		return -1;
+	}
+
+	int type;
+	uint8_t streamIdx = fi;
+	ProcessControlBlock *pcb_p = getCurrentPCB();
+	if (!pcb_p) {
+		return -1;
+	}
+	if (pcb_p->stream[streamIdx].device_p == NULL) {
+		return -1; /* stream not allocated */
+	}
+	type = pcb_p->stream[streamIdx].device_p->type;
+
+	return (*(fioDevice[type].fread))(buf_p, len, streamIdx);
+}
+
 /* deletes a file - erases and frees the inode entry
  * takes in the file pathname
  * returns -1 if fails
@@ -421,6 +507,15 @@ int mypurge(char *name_p) {
 
 	return sts;
 }
+
+/* takes a snapshot of the file system statistics; returns -1 if fails */
+int fioGetStats(FioStats *stats_p) {
+	if (stats_p == NULL) {
+		return -1;
+	}
+	*stats_p = fioStats;
+	return 0;
+}
 /****************************************************************************/
 
 /* utils  to list dir files */
@@ -483,7 +578,7 @@ int myopendir(char *id_p) {
 		return -1;
 	}
 
-	if (inode[inodeIdx].type != DIR_FILE){
+	if (INODE(inodeIdx).type != DIR_FILE){
 		return -1;
 	}
 
@@ -491,7 +586,7 @@ int myopendir(char *id_p) {
 	uint8_t streamIdx;
 
 	bool match;
-	for (streamIdx = 0, match = false; (streamIdx < FIO_MAX_STREAMS) && !match;
+	for (streamIdx = 0, match = false; (streamIdx < pcb_p->numStreams) && !match;
 			streamIdx++) {
 		/* stream entries that are not used have device_p = NULL; skip those */
 		if ((pcb_p->stream[streamIdx].device_p != NULL)
@@ -511,7 +606,7 @@ int myopendir(char *id_p) {
 	}
 
 	/* don't need to update inode entry */
-	inode[inodeIdx].accessCount++;
+	INODE(inodeIdx).accessCount++;
 
 	return ((int) streamIdx);
 }
@@ -569,7 +664,7 @@ char *getDirRecord(uint8_t streamIdx, char *fileName_p) {
 
 			/* check for the end of file: last block and offset at the last position */
 			if ((block_p->next_p == NULL)
-					&& ((inode[inodeIdx].size % FIO_BLOCK_SIZE)
+					&& ((INODE(inodeIdx).size % FIO_BLOCK_SIZE)
 							<= pcb_p->stream[streamIdx].position.offset)){
 				eof = true;
 			} else if ((FIO_BLOCK_SIZE - pcb_p->stream[streamIdx].position.offset)
@@ -636,11 +731,23 @@ int getPresetDev(char *id_p) {
 /*the following two functions are for the uart only.
  * They are meant to get the commands and print out the results if possible
  * They come with their own supervisor calls
+ * a process whose STDOUT (STDIN) is bound to a pipe, a stage of a pipeline,
+ * prints into (gets from) the pipe instead; input from a pipe is not echoed
  */
 void printStr(char *str){
+	if (pipeOfStream_p(STDOUT) != NULL) {
+		pipePuts(str, STDOUT);
+		return;
+	}
+	di();
 	putsIntoBuffer(str);
+	ei();
 }
 char getChar(bool echo){
+	if (pipeOfStream_p(STDIN) != NULL) {
+		int c = pipeGetc(STDIN);
+		return (c == -1) ? CHAR_EOF : (char) c; /* the end of the pipe reads as a Control-D */
+	}
 	di();
 	char c = getcharFromBuffer();
 	if (echo) {
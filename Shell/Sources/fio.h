@@ -13,15 +13,26 @@
 #include <errno.h>
 #include "utl.h"
 #include "usr.h"
+#include "pool.h"
 
 /* constants */
 
 #define FIO_MAX_FILES    64000 //increase max files to specified values in PS 3
 #define FIO_MAX_STREAMS  UINT8_MAX /*UCHAR_MAX*/
+#define FIO_INODE_CHUNK_SHIFT 10
+#define FIO_INODES_PER_CHUNK (1 << FIO_INODE_CHUNK_SHIFT) /* inodes allocated at once as the inode table grows */
+#define FIO_INODE_CHUNKS ((FIO_MAX_FILES + FIO_INODES_PER_CHUNK - 1) / FIO_INODES_PER_CHUNK)
 #define FIO_MAX_FILE_NAME 14 /* to fulfill the requirement for the support of at least 64K files; */
 /* 4.5.2, p. 324 */
 #define FIO_MAX_PATH_NAME UCHAR_MAX
 #define FIO_BLOCK_SIZE (512*2)
+#define FIO_BLOCKS_PER_CHUNK 16 /* blocks reserved at once when the block pools grow */
+#define FIO_DIR_INDEX_MIN 16 /* records a dir holds before its records get a hash index */
+#define FIO_DIR_BUCKETS 16 /* buckets of a new dir index; a power of 2, doubled as it fills */
+#define FIO_DIR_ENTRIES_PER_CHUNK 32 /* dir index entries reserved at once when their pool grows */
+#define FIO_PATH_CACHE_SIZE 32 /* path names whose inodes are remembered; the least recently used goes first */
+#define FIO_PATH_CACHE_BUCKETS 16 /* a power of 2 */
+#define FIO_PATH_CACHE_NAME 63 /* longer path names are not remembered */
 #define FIO_MAX_MODE 2
 #define FIO_LOG_FILE "/security.log"
 #define FIO_LOG_LINE 255
@@ -77,13 +88,15 @@ typedef enum {
 } FileType;
 
 typedef enum {
-	STD, RAM, LED, PUSH_BUTTON, ANALOG, TWR_LCD, TOUCH_SENSOR, FIO_DEV_MAX
+	STD, RAM, LED, PUSH_BUTTON, ANALOG, TWR_LCD, TOUCH_SENSOR, PIPE, FIO_DEV_MAX
 } DevType;
 
 /* type definitions */
 
 typedef int myFILE; /* index into stream table */
 
+struct Pipe_s; /* pipe.h */
+
 typedef struct {
 	DevType type;
 	char *id_p;
@@ -97,6 +110,8 @@ typedef struct {
 	int (*fputc)(int c, myFILE fi);
 	int (*fgets)(char *s_p, int len, myFILE fi);
 	int (*fputs)(char *s_p, myFILE fi);
+	int (*fread)(void *buf_p, int len, myFILE fi);  /* block transfers; return the bytes moved */
+	int (*fwrite)(const void *buf_p, int len, myFILE fi);
 	int (*create)(char *id_p, char *permSpec_p);
 	int (*delete) (char *id_p);
 	int (*rewind)(myFILE fi);
@@ -134,6 +149,15 @@ typedef struct {
 	unsigned short inodeIdx;
 } DirRecord;
 
+/* entry of a dir index: a record of the dir, chained in the bucket its name
+ * hashes to, or an erased record slot, chained on the free list
+ */
+typedef struct dirEntry_s {
+	DirRecord *drec_p;
+	uint32_t hash; /* FNV-1a of the name of the record */
+	struct dirEntry_s *next_p;
+} DirEntry;
+
 typedef struct block_s {
 	char *data_p;
 	struct block_s *next_p;
@@ -145,6 +169,17 @@ typedef struct {
 	unsigned short offset;
 } Position;
 
+/* hash index of the records of a dir, so a name is found without scanning
+ * them; the slots of erased records are kept on a free list to be reused
+ */
+typedef struct {
+	DirEntry **bucket_p;
+	unsigned numBuckets; /* a power of 2 */
+	unsigned numEntries;
+	DirEntry *free_p;    /* erased record slots */
+	Position end;        /* right after the last record: where the next one is added */
+} DirIndex;
+
 /* to list inodes: all existing files system wide */
 typedef struct inode_s {
 	usr_t *user_p;
@@ -156,6 +191,7 @@ typedef struct inode_s {
 	uint8_t type; /* FileType: dir/reg file */
 	unsigned short numRec; /* if dir - num subdir records */
 	unsigned short numFreeRec; /* num erased but not removed records ready to be over written with new data */
+	DirIndex *dirIndex_p; /* if dir - hash index of its records; NULL until the dir has FIO_DIR_INDEX_MIN */
 	bool lock;
 	AccessTime accessTime; /* !!not used at this time */
 	unsigned short accessCount; /* how many streams(opened/active instances) are associated with this file; !!not used at this time*/
@@ -163,7 +199,7 @@ typedef struct inode_s {
 	UtlAddress_t size; /* total number of bytes written to this file; number of chars in Block.data_p chain */
 	unsigned short nextFreeIdx; /* next free entry on inode array; only a free inode entry has a valid index */
 	/* the last free inode will point to max size of array
-	 * of inode; used together with firstFreeInode global;
+	 * of inode (the next chunk is then allocated); used together with firstFreeInode global;
 	 * every time an inode is freed it will becomde new firstFreeInode and point to what was
 	 * previously firstFreeInode */
 } INode;
@@ -171,7 +207,29 @@ typedef struct inode_s {
 typedef struct {
 	int self;
 	int parent;
+	char *name_p; /* name of the final node, within the path name */
+	unsigned short len;
 } FNode;
+/* path lookup cache entry: a path name found from a dir, and what findFile
+ * found for it; entries that share a bucket are chained by index
+ */
+typedef struct {
+	int start; /* inode of the dir the path name starts from; -1 if the entry is free */
+	uint32_t hash; /* FNV-1a of the path name */
+	uint32_t lastUsed;
+	FNode fn;
+	unsigned short nameOffset; /* of the final node in name; fn.name_p points into the caller's path name */
+	short next; /* next entry in the bucket; -1 if none */
+	char name[FIO_PATH_CACHE_NAME + 1];
+} PathCacheEntry;
+
+/* file system statistics */
+typedef struct {
+	unsigned pathHits; /* path names found in the cache */
+	unsigned pathMisses; /* path names looked up dir by dir */
+	unsigned pathEntries; /* path names in the cache */
+} FioStats;
+
 /* FILE * or  index into stream table ???
  * to list all streams - per process
  * more than one caller-per-process (and more than one process)  can be pointing to the same inode */
@@ -179,7 +237,10 @@ typedef struct {
 	Device *device_p;
 	char id[FIO_MAX_FILE_NAME+1]; /* file name */
 	char mode[FIO_MAX_MODE + 1]; /* AccessMode; "r","r+","w","w+","a","a+","x" */
-	Position position; /* current position */
+	union {
+		Position position; /* current position */
+		struct Pipe_s *pipe_p; /* pipe the stream is an end of, if the device is a PIPE */
+	};
 	unsigned short inodeIdx; /* index into inode array */
 	unsigned short nextFreeIdx; /* next free entry on stream array; only a free stream entry has a valid index; */
 	/* the last free stream will point to max size of array
@@ -218,9 +279,20 @@ const HwDevice hwDevice[] = {{STD, "STDIN"},
 #define EXTERN_
 #endif  /* ALLOCATE_ */
 
-EXTERN_ INode *inode;
+/* the inode table: a table of chunks of FIO_INODES_PER_CHUNK inodes each, which
+ * are allocated as files are created; an inode index picks a chunk with its top
+ * bits. the chunk of an index must have been allocated before it is used
+ */
+#define INODE(idx) (inodeChunk[(idx) >> FIO_INODE_CHUNK_SHIFT][(idx) & (FIO_INODES_PER_CHUNK - 1)])
+
+EXTERN_ INode *inodeChunk[FIO_INODE_CHUNKS];
+EXTERN_ unsigned numInodeChunks;
 EXTERN_ int firstFreeInode;
 EXTERN_ Device fioDevice[FIO_DEV_MAX]; /* device table */
+EXTERN_ Pool fioBlockPool; /* Block links */
+EXTERN_ Pool fioDataPool;  /* FIO_BLOCK_SIZE data buffers */
+EXTERN_ Pool fioDirEntryPool; /* dir index entries */
+EXTERN_ FioStats fioStats;
 
 /* function declarations */
 
@@ -238,7 +310,10 @@ char *getDirRecord(uint8_t streamIdx, char *fileName_p);
 int getPresetDev(char *id_p);
 int myfputs(char *s_p, myFILE fi);
 int myfgets(char *s_p, int len, myFILE fi);
+int myfread(void *buf_p, int len, myFILE fi);
+int myfwrite(const void *buf_p, int len, myFILE fi);
 int mypurge(char *name_p);
+int fioGetStats(FioStats *stats_p);
 
 void printStr(char *str);
 char getChar(bool echo);
@@ -19,6 +19,7 @@
 #include "intSerialIO.h"
 #include "tm.h"
 #include "rtc.h"
+#include "pipe.h"
 
 /* external mem functions; */
 /* are not declared in mem.h, since to be used by OS only */
@@ -45,12 +46,42 @@ int stubCr(char* str, char* spec) {
 	return 0;
 }
 
+/* block transfers of the devices that only move a char at a time: len chars
+ * are put (got) one by one. charWrite returns the number of chars written, or
+ * -1 if none could be; charRead the number read, up to the first that fails
+ */
+int charWrite(const void *buf_p, int len, myFILE fi) {
+	const char *s_p = buf_p;
+	int n;
+
+	for (n = 0; n < len; n++) {
+		if (myfputc(s_p[n], fi) == -1) {
+			break;
+		}
+	}
+	return ((n == 0) && (len > 0)) ? -1 : n;
+}
+
+int charRead(void *buf_p, int len, myFILE fi) {
+	char *s_p = buf_p;
+	int c;
+	int n;
+
+	for (n = 0; n < len; n++) {
+		if ((c = myfgetc(fi)) == -1) {
+			break;
+		}
+		s_p[n] = (char) c;
+	}
+	return n;
+}
+
 /* a helper function to close a file.
  * takes in the stream index;
  * returns -1 if fails.
  */
 int fileClose(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -61,7 +92,7 @@ int fileClose(myFILE fi) {
 	}
 
 	/* update inode entry */
-	inode[pcb_p->stream[streamIdx].inodeIdx].accessCount--;
+	INODE(pcb_p->stream[streamIdx].inodeIdx).accessCount--;
 	pcbReleaseStreamIdx(streamIdx);
 
 	return (0);
@@ -130,12 +161,12 @@ int fileDelete(char *id_p) {
 	}
 
 	/* check access count */
-	if (inode[inodeIdx].accessCount > 0){
+	if (INODE(inodeIdx).accessCount > 0){
 		/* open connections exist */
 		return -1;
 	}
 
-	if ((inode[inodeIdx].type == DIR_FILE) && (inode[inodeIdx].numRec > 0)){
+	if ((INODE(inodeIdx).type == DIR_FILE) && (INODE(inodeIdx).numRec > 0)){
 		/* file type is dir, and it is not empty */
 		return 0;
 	}
@@ -146,7 +177,7 @@ int fileDelete(char *id_p) {
 	}
 
 	/* erase from parent dir record */
-	eraseDirRec(inodeIdx, fn.parent);
+	eraseDirRec(fn.name_p, fn.len, inodeIdx, fn.parent);
 
 	/* free allocated blocks, and release inode entry */
 	releaseInodeIdx(inodeIdx);
@@ -198,7 +229,7 @@ int filePurge(char *id_p) {
 		return 0;
 	}
 
-	if (inode[inodeIdx].type == DIR_FILE) {
+	if (INODE(inodeIdx).type == DIR_FILE) {
 		/* file type is dir, it doesn't get purged */
 		return 0;
 	}
@@ -281,17 +312,17 @@ int stdCreate(int std) {
 		return -1;
 	}
 
-	inode[std].type = STD_FILE;
-	inode[std].lock = false;
-	inode[std].accessCount = 0;
-	inode[std].size = 0;
+	INODE(std).type = STD_FILE;
+	INODE(std).lock = false;
+	INODE(std).accessCount = 0;
+	INODE(std).size = 0;
 
 	return (std);
 }
 
 /* writes char to a file = c => (stream=>inode=>file of std device type) */
 int stdPutc(int c, myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -306,7 +337,7 @@ int stdPutc(int c, myFILE fi) {
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != STD_FILE){
+	if (INODE(inodeIdx).type != STD_FILE){
 		return -1;
 	}
 
@@ -334,7 +365,7 @@ int stdPutc(int c, myFILE fi) {
 
 /* reads char from a file = c <= (stream=>inode=>file of std device type) */
 int stdGetc(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -349,7 +380,7 @@ int stdGetc(myFILE fi) {
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != STD_FILE){
+	if (INODE(inodeIdx).type != STD_FILE){
 		return -1;
 	}
 
@@ -380,6 +411,8 @@ int stdGetc(myFILE fi) {
  * ramOpen
  *    dirCreate  (if root dir)
  *    findFile (process node in pathname)
+ *      pathCacheFind
+ *      findNode (if not cached)
  *      getNodeName
  *      searchDir (if final node)
  *      ramCreate (if final node)
@@ -451,7 +484,7 @@ int ramOpen(char * id_p, char *mode_p) {
 		return -1; /* not found and could not be created */
 	}
 
-	if (inode[inodeIdx].type == DIR_FILE){
+	if (INODE(inodeIdx).type == DIR_FILE){
 		return ROOT_DIR; /* stream entry dedicated to all dir nodes */
 	}
 	/* symbolic, since directories don't need streams associate with them */
@@ -466,7 +499,7 @@ int ramOpen(char * id_p, char *mode_p) {
 	uint8_t streamIdx;
 
 	bool match;
-	for (streamIdx = 0, match = false; (streamIdx < FIO_MAX_STREAMS) && !match;
+	for (streamIdx = 0, match = false; (streamIdx < pcb_p->numStreams) && !match;
 			streamIdx++) {
 		/* stream entries that are not used have device_p = NULL; skip those */
 		if ((pcb_p->stream[streamIdx].device_p != NULL)
@@ -488,17 +521,43 @@ int ramOpen(char * id_p, char *mode_p) {
 	}
 
 	/* update inode entry */
-	inode[inodeIdx].accessCount++;
+	INODE(inodeIdx).accessCount++;
 
 	return ((int) streamIdx);
 
 }
 
+/* finds (or creates) the file of a path name: a path name found before from
+ * the same dir is taken from the path lookup cache, else it is looked up dir
+ * by dir and, if found, remembered.
+ *
+ * findFile
+ *    pathCacheFind
+ *    findNode (if not cached)
+ *    pathCacheAdd (if found)
+ *
+ * takes in file pathname, the inode index of the dir it starts from, a flag
+ * indicating if the file should be created if not found, and its permissions.
+ * return the inode index or -1 if not successful
+ */
+FNode findFile(char *name_p, int parentInode, bool create, char *permSpec_p){
+	FNode fn;
+
+	if (pathCacheFind(name_p, parentInode, &fn)) {
+		return fn;
+	}
+	fn = findNode(name_p, parentInode, create, permSpec_p);
+	if (fn.self != -1) {
+		pathCacheAdd(name_p, parentInode, fn);
+	}
+	return fn;
+}
+
 /* recursive function: check for the existence of each dir node in the path name in its parent
  * directory; if any intermediate node does not exist the function fails, else finds or creates
  * the final node (reg file or dir) in its parent dir
  *
- * findFile
+ * findNode
  *    getNodeName
  *    searchDir (if final node)
  *    ramCreate (if final node)
@@ -507,14 +566,14 @@ int ramOpen(char * id_p, char *mode_p) {
  *       regCreate  (if reg file)
  *          ramInodeSet
  *       writeDirRec  (update parent dir record)
- *    findFile (if intermediate node)
+ *    findNode (if intermediate node)
  *
  * takes in file pathname, the inode index of the parent (directory in which the
  * file resides) and a flag indicating if the file should be created if not found.
  * return the inode index or -1 if not successful
  */
-FNode findFile(char *name_p, int parentInode, bool create, char *permSpec_p){
-	FNode fn = { -1, -1 };
+FNode findNode(char *name_p, int parentInode, bool create, char *permSpec_p){
+	FNode fn = { -1, -1, NULL, 0 };
 
 	int inodeIdx = -1;
 	int len = utlStrLen(name_p);
@@ -541,6 +600,8 @@ FNode findFile(char *name_p, int parentInode, bool create, char *permSpec_p){
 
 		fn.self = inodeIdx;
 		fn.parent = parentInode;
+		fn.name_p = name_p;
+		fn.len = nodeNameLen;
 		return fn;
 	} else if (nodeNameLen == (len - 1)){
 		/* end node: dir to be opened - the last char is '/' */
@@ -552,6 +613,8 @@ FNode findFile(char *name_p, int parentInode, bool create, char *permSpec_p){
 		}
 		fn.self = inodeIdx;
 		fn.parent = parentInode;
+		fn.name_p = name_p;
+		fn.len = nodeNameLen;
 		return fn;
 	} else {
 		/* intermediate node: directory to be found */
@@ -564,7 +627,7 @@ FNode findFile(char *name_p, int parentInode, bool create, char *permSpec_p){
 			return fn;
 		} /* directory in the path name does not exist */
 
-		if (inode[inodeIdx].type == REG_FILE) {
+		if (INODE(inodeIdx).type == REG_FILE) {
 			fn.self = -1;
 			return fn;
 		} /* directory in the path name does not exist */
@@ -572,7 +635,7 @@ FNode findFile(char *name_p, int parentInode, bool create, char *permSpec_p){
 
 		parentInode = inodeIdx;
 		name_p = name_p + nodeNameLen + 1; /* skip over '/' */
-		return (findFile(name_p, parentInode, create, permSpec_p));
+		return (findNode(name_p, parentInode, create, permSpec_p));
 
 	}
 
@@ -636,122 +699,156 @@ int writeDirRec(char *name_p, unsigned short len, int inodeIdx, int parentInode,
 		return 0;
 	}
 	/* record */
-	DirRecord *drec_p;
+	DirRecord *drec_p = NULL;
+	DirIndex *index_p = INODE(parentInode).dirIndex_p;
+	DirEntry *entry_p = NULL;
 
 	/* check if there are freed record slots from previous files being deleted */
-	/* if so, find the first free record slot and updated with current node info */
-	bool updated = false;
-	if (inode[parentInode].numFreeRec > 0) {
+	/* if so, take one off the free list of the index, or find the first one */
+	if (index_p != NULL) {
+		if ((entry_p = index_p->free_p) != NULL) {
+			index_p->free_p = entry_p->next_p;
+			drec_p = entry_p->drec_p;
+			INODE(parentInode).numFreeRec--;
+		}
+	} else if (INODE(parentInode).numFreeRec > 0) {
 		unsigned short size = 0;
-		Block *block_p = inode[parentInode].firstBlock_p;
-		drec_p = (DirRecord *) block_p->data_p;
-		while (!updated && drec_p != NULL) {
-			if (drec_p->inodeIdx == USHRT_MAX) {
-				utlStrMCpy(drec_p->fileName, name_p, len, FIO_MAX_FILE_NAME);
-				drec_p->inodeIdx = inodeIdx;
-				inode[parentInode].numFreeRec--;
-				updated = true;
+		Block *block_p = INODE(parentInode).firstBlock_p;
+		DirRecord *slot_p = (DirRecord *) block_p->data_p;
+		while ((drec_p == NULL) && (slot_p != NULL)) {
+			if (slot_p->inodeIdx == USHRT_MAX) {
+				drec_p = slot_p;
+				INODE(parentInode).numFreeRec--;
 			} else {
 				size += sizeof(DirRecord);
 				if ((FIO_BLOCK_SIZE - size) < sizeof(DirRecord)) {
 					block_p = block_p->next_p;
+					size = 0;
 					if (!block_p) {
-						drec_p = NULL;
+						slot_p = NULL;
 					} else {
-						drec_p = (DirRecord *) block_p->data_p;
+						slot_p = (DirRecord *) block_p->data_p;
 					}
 				} else {
-					drec_p++;
+					slot_p++;
 				}
 			}
 		}
-		/* if not updated (couldn't find free slot - bug), continue as if nothing happened :) */
+		/* if not found (couldn't find free slot - bug), continue as if nothing happened :) */
 	}
 
-	if (!updated) {
+	if (drec_p == NULL) {
 		/* check if there is room in the current block, which was found during the search of the parent dir */
 		/* if not, create and link a new block */
 		if ((FIO_BLOCK_SIZE - position.offset) < sizeof(DirRecord)){
 			/* get a new block */
-			Block *block_p = memAlloc(sizeof(Block), -1);
+			Block *block_p = poolGet(&fioBlockPool);
 			if (!block_p){
 				return -1;
 			}
-			position.currBlock_p->next_p = block_p;
-			block_p->next_p = NULL;
-			block_p->prev_p = position.currBlock_p;
-			block_p->data_p = memAlloc(FIO_BLOCK_SIZE, -1);
+			block_p->data_p = poolGet(&fioDataPool);
 			if (!block_p->data_p){
+				poolPut(&fioBlockPool, block_p);
 				return -1;
 			}
-			if (memSet(block_p->data_p, 0, FIO_BLOCK_SIZE, false) != MEM_NO_ERROR){
-				return -1;
-			}
+			memset(block_p->data_p, 0, FIO_BLOCK_SIZE);
+			block_p->next_p = NULL;
+			block_p->prev_p = position.currBlock_p;
+			position.currBlock_p->next_p = block_p;
 			position.currBlock_p = block_p;
 			position.offset = 0;
 		}
 
 		drec_p = (DirRecord *) (position.currBlock_p->data_p + position.offset);
-		utlStrMCpy(drec_p->fileName, name_p, len, FIO_MAX_FILE_NAME);
-		drec_p->inodeIdx = inodeIdx;
 
-		inode[parentInode].size = inode[parentInode].size + sizeof(DirRecord);
+		INODE(parentInode).size = INODE(parentInode).size + sizeof(DirRecord);
+		if (index_p != NULL) {
+			index_p->end.currBlock_p = position.currBlock_p;
+			index_p->end.offset = position.offset + sizeof(DirRecord);
+		}
+	}
+	utlStrMCpy(drec_p->fileName, name_p, len, FIO_MAX_FILE_NAME);
+	drec_p->inodeIdx = inodeIdx;
+	INODE(parentInode).numRec++;
+
+	if (index_p != NULL) {
+		if (entry_p != NULL) {
+			dirIndexInsert(index_p, entry_p);
+		} else if (dirIndexAdd(index_p, drec_p) == -1) {
+			/* an index missing a record would hide it; scan instead */
+			dirIndexFree(parentInode);
+		}
+	} else if ((INODE(parentInode).size / sizeof(DirRecord)) >= FIO_DIR_INDEX_MIN) {
+		dirIndexBuild(parentInode);
 	}
-	inode[parentInode].numRec++;
 	return 0;
 
 }
 
 /* removes the record from dir data
- * takes in the inode index of the file to be erased and the inode index
- * of the dir from which the file is to be erased;
+ * takes in the node name of the file to be erased and its length, the inode
+ * index of the file and the inode index of the dir from which the file is to
+ * be erased; the slot of the record is left to be reused.
  * returns -1 if fails
  */
-int eraseDirRec(int inodeIdx, int parentInode) {
+int eraseDirRec(char *name_p, unsigned short len, int inodeIdx, int parentInode) {
 	/* record */
 	DirRecord *drec_p;
 	bool updated = false;
 
-	if (inode[parentInode].numRec <= 0){
-		return -1;
-	}
-
-	unsigned short size = 0;
-
-	Block *block_p = inode[parentInode].firstBlock_p;
-	if (!block_p){
-		return -1;
-	}
-	drec_p = (DirRecord *) block_p->data_p;
-	if (!drec_p){
+	if (INODE(parentInode).numRec <= 0){
 		return -1;
 	}
 
-	while (!updated && (drec_p != NULL)) {
-		if (drec_p->inodeIdx == inodeIdx) {
+	if (INODE(parentInode).dirIndex_p != NULL) {
+		drec_p = dirIndexRemove_p(INODE(parentInode).dirIndex_p, name_p, len,
+				inodeIdx);
+		if (drec_p == NULL) {
+			return -1;
+		}
+		updated = true;
+	} else {
+		unsigned short size = 0;
 
-			drec_p->inodeIdx = USHRT_MAX;
+		Block *block_p = INODE(parentInode).firstBlock_p;
+		if (!block_p){
+			return -1;
+		}
+		drec_p = (DirRecord *) block_p->data_p;
+		if (!drec_p){
+			return -1;
+		}
 
-			memSet(drec_p->fileName, '\0', FIO_MAX_FILE_NAME, false);
+		while (!updated && (drec_p != NULL)) {
+			if (drec_p->inodeIdx == inodeIdx) {
+				updated = true;
+			} else {
+				size += sizeof(DirRecord);
+				if ((FIO_BLOCK_SIZE - size) < sizeof(DirRecord)) {
+					block_p = block_p->next_p;
+					size = 0;
+					if (!block_p) {
+						drec_p = NULL;
+					} else {
+						drec_p = (DirRecord *) block_p->data_p;
+					}
 
-			inode[parentInode].numFreeRec++;
-			inode[parentInode].numRec--;
-			updated = true;
-		} else {
-			size += sizeof(DirRecord);
-			if ((FIO_BLOCK_SIZE - size) < sizeof(DirRecord)) {
-				block_p = block_p->next_p;
-				if (!block_p) {
-					drec_p = NULL;
 				} else {
-					drec_p = (DirRecord *) block_p->data_p;
+					drec_p++;
 				}
-
-			} else {
-				drec_p++;
 			}
 		}
 	}
+
+	if (updated) {
+		pathCacheInvalidate(inodeIdx);
+		drec_p->inodeIdx = USHRT_MAX;
+
+		memset(drec_p->fileName, '\0', FIO_MAX_FILE_NAME);
+
+		INODE(parentInode).numFreeRec++;
+		INODE(parentInode).numRec--;
+	}
 	return 0;
 }
 
@@ -782,16 +879,16 @@ int dirCreate(int parentIdx) {
 	DirRecord *drec_p;
 
 	/* self */
-	drec_p = (DirRecord *) inode[inodeIdx].firstBlock_p->data_p;
+	drec_p = (DirRecord *) INODE(inodeIdx).firstBlock_p->data_p;
 	utlStrMCpy(drec_p->fileName, ".", 1, FIO_MAX_FILE_NAME);
 	drec_p->inodeIdx = inodeIdx;
-	inode[inodeIdx].size += sizeof(DirRecord);
+	INODE(inodeIdx).size += sizeof(DirRecord);
 
 	/* parent */
 	drec_p++;
 	utlStrMCpy(drec_p->fileName, "..", 2, FIO_MAX_FILE_NAME);
 	drec_p->inodeIdx = parentIdx;
-	inode[inodeIdx].size += sizeof(DirRecord);
+	INODE(inodeIdx).size += sizeof(DirRecord);
 
 	return ((int) inodeIdx);
 }
@@ -806,16 +903,16 @@ int dirDevCreate(int parentIdx, int inodeIdx) {
 	DirRecord *drec_p;
 
 	/* self */
-	drec_p = (DirRecord *) inode[inodeIdx].firstBlock_p->data_p;
+	drec_p = (DirRecord *) INODE(inodeIdx).firstBlock_p->data_p;
 	utlStrMCpy(drec_p->fileName, ".", 1, FIO_MAX_FILE_NAME);
 	drec_p->inodeIdx = inodeIdx;
-	inode[inodeIdx].size += sizeof(DirRecord);
+	INODE(inodeIdx).size += sizeof(DirRecord);
 
 	/* parent */
 	drec_p++;
 	utlStrMCpy(drec_p->fileName, "..", 2, FIO_MAX_FILE_NAME);
 	drec_p->inodeIdx = parentIdx;
-	inode[inodeIdx].size += sizeof(DirRecord);
+	INODE(inodeIdx).size += sizeof(DirRecord);
 
 	return inodeIdx;
 }
@@ -843,28 +940,26 @@ int regCreate(void) {
  * returns -1 if fails
  */
 int ramInodeSet(unsigned short inodeIdx, FileType type) {
-	inode[inodeIdx].type = type;
-	inode[inodeIdx].lock = false;
-	inode[inodeIdx].accessCount = 0;
-	inode[inodeIdx].size = 0;
+	INODE(inodeIdx).type = type;
+	INODE(inodeIdx).lock = false;
+	INODE(inodeIdx).accessCount = 0;
+	INODE(inodeIdx).size = 0;
+	INODE(inodeIdx).dirIndex_p = NULL;
 
 	/* init start block */
-	inode[inodeIdx].firstBlock_p = memAlloc(sizeof(Block), -1);
-	if (inode[inodeIdx].firstBlock_p == NULL){
+	INODE(inodeIdx).firstBlock_p = poolGet(&fioBlockPool);
+	if (INODE(inodeIdx).firstBlock_p == NULL){
 		return (-1);
 	}
 
-	inode[inodeIdx].firstBlock_p->next_p = NULL;
-	inode[inodeIdx].firstBlock_p->prev_p = NULL;
+	INODE(inodeIdx).firstBlock_p->next_p = NULL;
+	INODE(inodeIdx).firstBlock_p->prev_p = NULL;
 
-	inode[inodeIdx].firstBlock_p->data_p = memAlloc(FIO_BLOCK_SIZE, -1);
-	if (inode[inodeIdx].firstBlock_p->data_p == NULL){
+	INODE(inodeIdx).firstBlock_p->data_p = poolGet(&fioDataPool);
+	if (INODE(inodeIdx).firstBlock_p->data_p == NULL){
 		return (FIO_INIT_FAILED);
 	}
-	if (memSet(inode[inodeIdx].firstBlock_p->data_p, 0, FIO_BLOCK_SIZE, false)
-			!= MEM_NO_ERROR){
-		return -1;
-	}
+	memset(INODE(inodeIdx).firstBlock_p->data_p, 0, FIO_BLOCK_SIZE);
 
 	return inodeIdx;
 }
@@ -919,17 +1014,17 @@ uint8_t ramStreamSet(char *id_p, unsigned short inodeIdx, char *mode_p) {
 
 	if (*mode_p == 'a') {
 		/* append; start access at the end of the file */
-		Block *block_p = inode[inodeIdx].firstBlock_p;
+		Block *block_p = INODE(inodeIdx).firstBlock_p;
 		while (block_p->next_p != NULL)
 			block_p = block_p->next_p;
 		pcb_p->stream[streamIdx].position.currBlock_p = block_p;
 
-		pcb_p->stream[streamIdx].position.offset = (inode[inodeIdx].size
+		pcb_p->stream[streamIdx].position.offset = (INODE(inodeIdx).size
 				% FIO_BLOCK_SIZE);
 	} else {
 		/* start access from the beginning */
 		pcb_p->stream[streamIdx].position.currBlock_p =
-				inode[inodeIdx].firstBlock_p;
+				INODE(inodeIdx).firstBlock_p;
 		pcb_p->stream[streamIdx].position.offset = 0;
 	}
 
@@ -953,16 +1048,26 @@ int searchDir(char *nodeName_p, unsigned short len, int parentInode,
 		return -1;
 	}
 
-	if (inode[parentInode].size == 0){
+	if (INODE(parentInode).size == 0){
+		return -1;
+	}
+
+	DirIndex *index_p = INODE(parentInode).dirIndex_p;
+	if (index_p != NULL) {
+		DirEntry *entry_p = dirIndexFind_p(index_p, nodeName_p, len);
+		if (entry_p != NULL) {
+			return entry_p->drec_p->inodeIdx;
+		}
+		*position_p = index_p->end;
 		return -1;
 	}
 
 	int inodeIdx = -1;
-	int numRecords = inode[parentInode].size / sizeof(DirRecord);
+	int numRecords = INODE(parentInode).size / sizeof(DirRecord);
 	int numRecordsPerBlock = FIO_BLOCK_SIZE / sizeof(DirRecord);
 
 	int i, j;
-	Block *block_p = inode[parentInode].firstBlock_p;
+	Block *block_p = INODE(parentInode).firstBlock_p;
 	bool found = false;
 
 	j = 0;
@@ -990,84 +1095,323 @@ int searchDir(char *nodeName_p, unsigned short len, int parentInode,
 	return inodeIdx;
 }
 
-/* writes char to a RAM file
- * takes in int for a character to be written, and file stream index;
- * returns an int = written character or -1 if fails
+/* the dir index functions: a dir that grows to FIO_DIR_INDEX_MIN records gets
+ * a hash index of them, so searchDir finds a name in a chain of its bucket
+ * rather than by scanning every record. writeDirRec and eraseDirRec keep it in
+ * step, and the slots of erased records wait on its free list to be reused.
+ * without an index (a small dir, or no memory for one) the records are scanned
  */
-int ramPutc(int c, myFILE fi){
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
-		return -1;
-	}
 
-	uint8_t streamIdx = fi;
-	ProcessControlBlock *pcb_p = getCurrentPCB();
-	if (!pcb_p) {
-		return -1;
+/* FNV-1a hash of a node name of up to len chars */
+uint32_t dirHash(char *name_p, unsigned short len) {
+	uint32_t hash = 2166136261u;
+	unsigned short i;
+
+	for (i = 0; (i < len) && (name_p[i] != '\0'); i++) {
+		hash ^= (unsigned char) name_p[i];
+		hash *= 16777619u;
 	}
-	if (pcb_p->stream[streamIdx].device_p == NULL){
-		/* stream not allocated */
+	return hash;
+}
+
+/* builds the index of a dir from its records; returns -1 if fails, in which
+ * case the dir is left to be scanned
+ */
+int dirIndexBuild(int dirInode) {
+	DirIndex *index_p = memAlloc(sizeof(DirIndex), -1);
+	if (index_p == NULL) {
 		return -1;
 	}
-	if (pcb_p->stream[streamIdx].device_p->type != RAM){
+	index_p->bucket_p = memAlloc(FIO_DIR_BUCKETS * sizeof(DirEntry *), -1);
+	if (index_p->bucket_p == NULL) {
+		myFreeErrorCode(index_p, 0);
 		return -1;
 	}
+	memset(index_p->bucket_p, 0, FIO_DIR_BUCKETS * sizeof(DirEntry *));
+	index_p->numBuckets = FIO_DIR_BUCKETS;
+	index_p->numEntries = 0;
+	index_p->free_p = NULL;
+	INODE(dirInode).dirIndex_p = index_p;
 
-	if ((pcb_p->stream[streamIdx].mode[0] != 'w')
-			&& (pcb_p->stream[streamIdx].mode[1] != '+')
-			&& (pcb_p->stream[streamIdx].mode[0] != 'a')) {
-		logWrite(FIO_INVREQ_WRITE, pcb_p->stream[streamIdx].id, NULL);
-		return -1;
+	int numRecords = INODE(dirInode).size / sizeof(DirRecord);
+	int numRecordsPerBlock = FIO_BLOCK_SIZE / sizeof(DirRecord);
+	Block *block_p = INODE(dirInode).firstBlock_p;
+	int i, j;
+
+	j = 0;
+	while ((block_p != NULL) && (j < numRecords)) {
+		DirRecord *drec_p = (DirRecord *) block_p->data_p;
+
+		for (i = 0; (i < numRecordsPerBlock) && (j < numRecords);
+				i++, j++, drec_p++) {
+			if (drec_p->inodeIdx == USHRT_MAX) {
+				/* erased; a slot to be reused */
+				DirEntry *entry_p = poolGet(&fioDirEntryPool);
+				if (entry_p == NULL) {
+					dirIndexFree(dirInode);
+					return -1;
+				}
+				entry_p->drec_p = drec_p;
+				entry_p->next_p = index_p->free_p;
+				index_p->free_p = entry_p;
+			} else if (dirIndexAdd(index_p, drec_p) == -1) {
+				dirIndexFree(dirInode);
+				return -1;
+			}
+		}
+		index_p->end.currBlock_p = block_p;
+		index_p->end.offset = i * sizeof(DirRecord);
+		block_p = block_p->next_p;
 	}
+	return 0;
+}
 
-	int inodeIdx = pcb_p->stream[streamIdx].inodeIdx;
+/* gives the entries of the index of a dir back to their pool, and the index
+ * back to the heap
+ */
+void dirIndexFree(int dirInode) {
+	DirIndex *index_p = INODE(dirInode).dirIndex_p;
+	DirEntry *entry_p;
+	unsigned i;
 
-	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
-		return -1;
+	if (index_p == NULL) {
+		return;
 	}
-	if (inode[inodeIdx].type != REG_FILE){
+	INODE(dirInode).dirIndex_p = NULL;
+
+	for (i = 0; i < index_p->numBuckets; i++) {
+		while ((entry_p = index_p->bucket_p[i]) != NULL) {
+			index_p->bucket_p[i] = entry_p->next_p;
+			poolPut(&fioDirEntryPool, entry_p);
+		}
+	}
+	while ((entry_p = index_p->free_p) != NULL) {
+		index_p->free_p = entry_p->next_p;
+		poolPut(&fioDirEntryPool, entry_p);
+	}
+	myFreeErrorCode(index_p->bucket_p, 0);
+	myFreeErrorCode(index_p, 0);
+}
+
+/* adds a record to the index of a dir; returns -1 if there is no entry for it */
+int dirIndexAdd(DirIndex *index_p, DirRecord *drec_p) {
+	DirEntry *entry_p = poolGet(&fioDirEntryPool);
+
+	if (entry_p == NULL) {
 		return -1;
 	}
+	entry_p->drec_p = drec_p;
+	dirIndexInsert(index_p, entry_p);
+	return 0;
+}
 
-	if (pcb_p->stream[streamIdx].position.offset == FIO_BLOCK_SIZE) {
-		Block *block_p = pcb_p->stream[streamIdx].position.currBlock_p;
-		if (block_p->next_p == NULL){
-			/* allocate new block */
-			block_p->next_p = memAlloc(sizeof(Block), -1);
-			if (!block_p->next_p){
-				return -1;
-			}
+/* chains the entry of a record in the bucket its name hashes to; the buckets
+ * are doubled once there are twice as many entries, if the memory is there
+ */
+void dirIndexInsert(DirIndex *index_p, DirEntry *entry_p) {
+	entry_p->hash = dirHash(entry_p->drec_p->fileName, FIO_MAX_FILE_NAME);
 
-			pcb_p->stream[streamIdx].position.currBlock_p = block_p->next_p;
-			pcb_p->stream[streamIdx].position.currBlock_p->prev_p = block_p;
-			pcb_p->stream[streamIdx].position.currBlock_p->next_p = NULL;
+	if (index_p->numEntries >= (2 * index_p->numBuckets)) {
+		unsigned numBuckets = 2 * index_p->numBuckets;
+		DirEntry **bucket_p = memAlloc(numBuckets * sizeof(DirEntry *), -1);
 
-			pcb_p->stream[streamIdx].position.currBlock_p->data_p = memAlloc(
-					FIO_BLOCK_SIZE, -1);
-			if (pcb_p->stream[streamIdx].position.currBlock_p->data_p == NULL){
-				return -1;
-			}
-			if (memSet(pcb_p->stream[streamIdx].position.currBlock_p->data_p, 0,
-					FIO_BLOCK_SIZE, false) != MEM_NO_ERROR) {
-				return -1;
+		if (bucket_p != NULL) {
+			unsigned i;
+
+			memset(bucket_p, 0, numBuckets * sizeof(DirEntry *));
+			for (i = 0; i < index_p->numBuckets; i++) {
+				DirEntry *next_p;
+				DirEntry *moved_p;
+
+				for (moved_p = index_p->bucket_p[i]; moved_p != NULL; moved_p = next_p) {
+					next_p = moved_p->next_p;
+					moved_p->next_p = bucket_p[moved_p->hash & (numBuckets - 1)];
+					bucket_p[moved_p->hash & (numBuckets - 1)] = moved_p;
+				}
 			}
-			pcb_p->stream[streamIdx].position.offset = 0;
+			myFreeErrorCode(index_p->bucket_p, 0);
+			index_p->bucket_p = bucket_p;
+			index_p->numBuckets = numBuckets;
+		}
+	}
 
-		} else {
-			pcb_p->stream[streamIdx].position.currBlock_p =
-					pcb_p->stream[streamIdx].position.currBlock_p->next_p;
-			pcb_p->stream[streamIdx].position.offset = 0;
+	DirEntry **head_p = &index_p->bucket_p[entry_p->hash & (index_p->numBuckets - 1)];
+	entry_p->next_p = *head_p;
+	*head_p = entry_p;
+	index_p->numEntries++;
+}
+
+/* finds the entry of a node name of len chars in the index of a dir; returns
+ * NULL if there is none
+ */
+DirEntry *dirIndexFind_p(DirIndex *index_p, char *name_p, unsigned short len) {
+	uint32_t hash = dirHash(name_p, len);
+	DirEntry *entry_p = index_p->bucket_p[hash & (index_p->numBuckets - 1)];
+
+	while (entry_p != NULL) {
+		if ((entry_p->hash == hash)
+				&& utlStrMCmp(entry_p->drec_p->fileName, name_p, len,
+						FIO_MAX_FILE_NAME)) {
+			return entry_p;
+		}
+		entry_p = entry_p->next_p;
+	}
+	return NULL;
+}
+
+/* takes the entry of a node name of len chars for inode inodeIdx out of its
+ * bucket, onto the free list; returns its record, or NULL if there is none
+ */
+DirRecord *dirIndexRemove_p(DirIndex *index_p, char *name_p,
+		unsigned short len, int inodeIdx) {
+	uint32_t hash = dirHash(name_p, len);
+	DirEntry **link_p = &index_p->bucket_p[hash & (index_p->numBuckets - 1)];
+	DirEntry *entry_p;
+
+	while ((entry_p = *link_p) != NULL) {
+		if ((entry_p->hash == hash) && (entry_p->drec_p->inodeIdx == inodeIdx)
+				&& utlStrMCmp(entry_p->drec_p->fileName, name_p, len,
+						FIO_MAX_FILE_NAME)) {
+			*link_p = entry_p->next_p;
+			index_p->numEntries--;
+			entry_p->next_p = index_p->free_p;
+			index_p->free_p = entry_p;
+			return entry_p->drec_p;
+		}
+		link_p = &entry_p->next_p;
+	}
+	return NULL;
+}
+
+/* the path lookup cache: the path names findFile found, each with the dir it
+ * started from (ROOT_DIR or the current dir of the process), so opening the same
+ * file again skips the walk down its dirs. it holds FIO_PATH_CACHE_SIZE path
+ * names; a new one takes the place of the one used least recently. an entry
+ * is dropped when the file it found is erased from its dir or its inode is
+ * released. files not found are not remembered, since they may be created
+ */
+
+PathCacheEntry pathCache[FIO_PATH_CACHE_SIZE];
+short pathCacheBucket[FIO_PATH_CACHE_BUCKETS]; /* first entry of each bucket; -1 if none */
+uint32_t pathCacheClock; /* stamps the entries as they are used */
+
+/* empties the path lookup cache; called by fioInit */
+void pathCacheInit(void) {
+	int i;
+
+	for (i = 0; i < FIO_PATH_CACHE_SIZE; i++) {
+		pathCache[i].start = -1;
+		pathCache[i].lastUsed = 0;
+	}
+	for (i = 0; i < FIO_PATH_CACHE_BUCKETS; i++) {
+		pathCacheBucket[i] = -1;
+	}
+	pathCacheClock = 0;
+	fioStats.pathHits = 0;
+	fioStats.pathMisses = 0;
+	fioStats.pathEntries = 0;
+}
+
+/* looks for a path name found from dir start in the cache; if it is there,
+ * sets what was found and returns true
+ */
+bool pathCacheFind(char *name_p, int start, FNode *fn_p) {
+	uint32_t hash = dirHash(name_p, FIO_MAX_PATH_NAME);
+	short i = pathCacheBucket[(hash ^ start) & (FIO_PATH_CACHE_BUCKETS - 1)];
+
+	for (; i != -1; i = pathCache[i].next) {
+		if ((pathCache[i].start == start) && (pathCache[i].hash == hash)
+				&& utlStrCmp(pathCache[i].name, name_p)) {
+			pathCache[i].lastUsed = ++pathCacheClock;
+			*fn_p = pathCache[i].fn;
+			fn_p->name_p = name_p + pathCache[i].nameOffset;
+			fioStats.pathHits++;
+			return true;
 		}
+	}
+	fioStats.pathMisses++;
+	return false;
+}
+
+/* remembers what was found for a path name from dir start, in place of the
+ * least recently used entry
+ */
+void pathCacheAdd(char *name_p, int start, FNode fn) {
+	int len = utlStrLen(name_p);
+	int i, oldest;
 
+	if ((len > FIO_PATH_CACHE_NAME) || (fn.name_p == NULL)) {
+		return;
 	}
 
-	char *data_p = pcb_p->stream[streamIdx].position.currBlock_p->data_p
-			+ pcb_p->stream[streamIdx].position.offset;
+	for (i = 1, oldest = 0; i < FIO_PATH_CACHE_SIZE; i++) {
+		if (pathCache[i].lastUsed < pathCache[oldest].lastUsed) {
+			oldest = i;
+		}
+	}
+	if (pathCache[oldest].start != -1) {
+		pathCacheDrop(oldest);
+	}
 
-	*data_p = (unsigned char) c;
-	pcb_p->stream[streamIdx].position.offset++;
+	PathCacheEntry *entry_p = &pathCache[oldest];
+	short *bucket_p;
 
-	inode[inodeIdx].size++;
+	entry_p->start = start;
+	entry_p->hash = dirHash(name_p, FIO_MAX_PATH_NAME);
+	entry_p->lastUsed = ++pathCacheClock;
+	entry_p->fn = fn;
+	entry_p->fn.name_p = NULL;
+	entry_p->nameOffset = fn.name_p - name_p;
+	utlStrCpy(entry_p->name, name_p);
+
+	bucket_p = &pathCacheBucket[(entry_p->hash ^ start) & (FIO_PATH_CACHE_BUCKETS - 1)];
+	entry_p->next = *bucket_p;
+	*bucket_p = oldest;
+	fioStats.pathEntries++;
+}
+
+/* drops the entries of the cache that found a file, once it is erased from its
+ * dir or its inode is released
+ */
+void pathCacheInvalidate(int inodeIdx) {
+	int i;
 
+	for (i = 0; i < FIO_PATH_CACHE_SIZE; i++) {
+		if ((pathCache[i].start != -1) && (pathCache[i].fn.self == inodeIdx)) {
+			pathCacheDrop(i);
+		}
+	}
+}
+
+/* takes an entry out of its bucket; it is the first to be reused */
+void pathCacheDrop(int i) {
+	short *link_p = &pathCacheBucket[(pathCache[i].hash ^ pathCache[i].start)
+			& (FIO_PATH_CACHE_BUCKETS - 1)];
+
+	while (*link_p != -1) {
+		if (*link_p == i) {
+			*link_p = pathCache[i].next;
+			break;
+		}
+		link_p = &pathCache[*link_p].next;
+	}
+	pathCache[i].start = -1;
+	pathCache[i].lastUsed = 0;
+	fioStats.pathEntries--;
+}
+
+/* writes char to a RAM file
+ * takes in int for a character to be written, and file stream index;
+ * returns an int = written character or -1 if fails
+ */
+int ramPutc(int c, myFILE fi){
+	int inodeIdx;
+	Stream *stream_p = ramStream_p(fi, true, &inodeIdx);
+	char ch = (char) c;
+
+	if ((stream_p == NULL) || (ramCopyIn(stream_p, inodeIdx, &ch, 1) != 1)) {
+		return -1;
+	}
 	return c;
 }
 
@@ -1076,7 +1420,7 @@ int ramPutc(int c, myFILE fi){
  * returns -1 if fails
  */
 int fileRewind(myFILE fi){
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 	uint8_t streamIdx = fi;
@@ -1101,7 +1445,7 @@ int fileRewind(myFILE fi){
 		return -1;
 	}
 
-	pcb_p->stream[streamIdx].position.currBlock_p = inode[inodeIdx].firstBlock_p;
+	pcb_p->stream[streamIdx].position.currBlock_p = INODE(inodeIdx).firstBlock_p;
 	pcb_p->stream[streamIdx].position.offset = 0;
 
 	return 0;
@@ -1112,152 +1456,242 @@ int fileRewind(myFILE fi){
  * returns an int = read character or -1 if fails
  */
 int ramGetc(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
-		return -1;
-	}
-	uint8_t streamIdx = fi;
-	ProcessControlBlock *pcb_p = getCurrentPCB();
-	if (!pcb_p) {
-		return -1;
-	}
-	if (!pcb_p->stream[streamIdx].device_p) {
-		/* stream not allocated */
-		return -1;
+	int inodeIdx;
+	Stream *stream_p = ramStream_p(fi, false, &inodeIdx);
+	char c;
+
+	if ((stream_p == NULL) || (ramCopyOut(stream_p, inodeIdx, &c, 1, false) != 1)) {
+		return -1; /* or end of file */
 	}
-	if (pcb_p->stream[fi].device_p->type != RAM){
+	return (int) (unsigned char) c;
+}
+
+int ramPuts(char *str_p, myFILE fi) {
+	if (!str_p) {
 		return -1;
 	}
 
-	if ((pcb_p->stream[streamIdx].mode[0] != 'r')
-			&& (pcb_p->stream[streamIdx].mode[1] != '+')) {
-		logWrite(FIO_INVREQ_READ, pcb_p->stream[streamIdx].id, NULL);
+	int inodeIdx;
+	Stream *stream_p = ramStream_p(fi, true, &inodeIdx);
+	if (stream_p == NULL) {
 		return -1;
 	}
 
-	int inodeIdx = pcb_p->stream[streamIdx].inodeIdx;
-	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
+	ramCopyIn(stream_p, inodeIdx, str_p, strlen(str_p));
+	return (0);
+}
+
+/* adapted with modifications from The C Programming Language by B.Kernighan, D.Ritchie
+ * str_p must be len+1 long, since it will be terminated by '\0';
+ * New line ('\n'), end of file, or len argument (whichever reached first),
+ * determine the lenth of the output string pointed by str_p
+ */
+int ramGets(char *str_p, int len, myFILE fi) {
+	if (!str_p) {
 		return -1;
 	}
-	if (inode[inodeIdx].type != REG_FILE){
+
+	int inodeIdx;
+	Stream *stream_p = ramStream_p(fi, false, &inodeIdx);
+	if (stream_p == NULL) {
 		return -1;
 	}
 
-	Block *block_p;
-
-	if (pcb_p->stream[streamIdx].position.offset == FIO_BLOCK_SIZE) {
-		block_p = pcb_p->stream[streamIdx].position.currBlock_p->next_p;
-		pcb_p->stream[streamIdx].position.offset = 0;
-		pcb_p->stream[streamIdx].position.currBlock_p = block_p;
-	} else {
-		block_p = pcb_p->stream[streamIdx].position.currBlock_p;
+	int n = 0;
+	if (len > 1) {
+		n = ramCopyOut(stream_p, inodeIdx, str_p, len - 1, true);
 	}
+	str_p[(n > 0) ? n : 0] = '\0';
 
-	if (block_p == NULL) {
-		return -1; /*?? EOF late */
-	}
+	return (0);
+}
 
-	/* check for the end of file: last block and offset at the last position */
-	if ((block_p->next_p == NULL)
-			&& ((inode[inodeIdx].size % FIO_BLOCK_SIZE)
-					<= pcb_p->stream[fi].position.offset)){
+/* writes len bytes from buf_p to a RAM file, a block span at a time
+ * returns the number of bytes written, or -1 if none could be
+ */
+int ramWrite(const void *buf_p, int len, myFILE fi) {
+	if ((!buf_p) || (len < 0)) {
 		return -1;
 	}
 
-	char *data_p = block_p->data_p + pcb_p->stream[streamIdx].position.offset;
-
-	if (data_p == NULL){
+	int inodeIdx;
+	Stream *stream_p = ramStream_p(fi, true, &inodeIdx);
+	if (stream_p == NULL) {
 		return -1;
 	}
 
-	unsigned char c = *data_p;
-	pcb_p->stream[streamIdx].position.offset++;
-
-	return (int) c;
+	int n = ramCopyIn(stream_p, inodeIdx, buf_p, len);
+	return ((n == 0) && (len > 0)) ? -1 : n;
 }
 
-int ramPuts(char *str_p, myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)) {
+/* reads up to len bytes of a RAM file into buf_p, a block span at a time
+ * returns the number of bytes read, 0 at the end of file, or -1 if fails
+ */
+int ramRead(void *buf_p, int len, myFILE fi) {
+	if ((!buf_p) || (len < 0)) {
 		return -1;
 	}
-	if (!str_p) {
+
+	int inodeIdx;
+	Stream *stream_p = ramStream_p(fi, false, &inodeIdx);
+	if (stream_p == NULL) {
 		return -1;
 	}
 
+	return ramCopyOut(stream_p, inodeIdx, buf_p, len, false);
+}
+
+/* the stream of the current process a RAM file is read (!write) or written
+ * through, once it is checked to be open for it; sets the inode index of the
+ * file. a refused access is logged, but for the log file itself.
+ * returns NULL if fails
+ */
+Stream *ramStream_p(myFILE fi, bool write, int *inodeIdx_p) {
+	if ((fi < 0) || (fi >= pcbNumStreams())) {
+		return NULL;
+	}
+
 	uint8_t streamIdx = fi;
 	ProcessControlBlock *pcb_p = getCurrentPCB();
-	if (!pcb_p)
-		return -1;
-	if (pcb_p->stream[streamIdx].device_p == NULL) {
+	if (!pcb_p) {
+		return NULL;
+	}
+	Stream *stream_p = &pcb_p->stream[streamIdx];
+	if (stream_p->device_p == NULL) {
 		/* stream not allocated */
-		return -1;
+		return NULL;
 	}
-	if (pcb_p->stream[streamIdx].device_p->type != RAM) {
-		return -1;
+	if (stream_p->device_p->type != RAM) {
+		return NULL;
 	}
 
-	if ((pcb_p->stream[streamIdx].mode[0] != 'w')
-			&& (pcb_p->stream[streamIdx].mode[1] != '+')
-			&& (pcb_p->stream[streamIdx].mode[0] != 'a')) {
-		if (fi != pcb_p->fiLog) {
-			logWrite(FIO_INVREQ_WRITE, pcb_p->stream[streamIdx].id, NULL);
+	if (write) {
+		if ((stream_p->mode[0] != 'w') && (stream_p->mode[1] != '+')
+				&& (stream_p->mode[0] != 'a')) {
+			if (fi != pcb_p->fiLog) {
+				logWrite(FIO_INVREQ_WRITE, stream_p->id, NULL);
+			}
+			return NULL;
+		}
+	} else {
+		if ((stream_p->mode[0] != 'r') && (stream_p->mode[1] != '+')) {
+			logWrite(FIO_INVREQ_READ, stream_p->id, NULL);
+			return NULL;
 		}
-		return -1;
 	}
 
-	int c = 0;
-	while ((*str_p != '\0') && (c != -1)) {
-		c = ramPutc(*str_p, fi);
-		str_p++;
+	int inodeIdx = stream_p->inodeIdx;
+	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)) {
+		return NULL;
 	}
-	return (0);
+	if (INODE(inodeIdx).type != REG_FILE) {
+		return NULL;
+	}
+
+	*inodeIdx_p = inodeIdx;
+	return stream_p;
 }
 
-/* adapted with modifications from The C Programming Language by B.Kernighan, D.Ritchie
- * str_p must be len+1 long, since it will be terminated by '\0';
- * New line ('\n'), end of file, or len argument (whichever reached first),
- * determine the lenth of the output string pointed by str_p
+/* copies len bytes into a RAM file at the position of a checked stream, as
+ * many at a time as the current block holds, and moves on to the next block,
+ * allocated if there is none; the size of the file grows by the bytes written.
+ * returns the number of bytes written
  */
-int ramGets(char *str_p, int len, myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)) {
-		return -1;
-	}
-	if (!str_p) {
-		return -1;
-	}
-
-	uint8_t streamIdx = fi;
-	ProcessControlBlock *pcb_p = getCurrentPCB();
-	if (!pcb_p)
-		return -1;
-	if (!pcb_p->stream[streamIdx].device_p) {
-		/* stream not allocated */
-		return -1;
-	}
-	if (pcb_p->stream[fi].device_p->type != RAM) {
-		return -1;
-	}
+int ramCopyIn(Stream *stream_p, int inodeIdx, const char *src_p, int len) {
+	Position *position_p = &stream_p->position;
+	int done = 0;
+	int n;
+
+	while (done < len) {
+		if (position_p->offset == FIO_BLOCK_SIZE) {
+			Block *block_p = position_p->currBlock_p;
+			if (block_p->next_p == NULL) {
+				/* allocate new block */
+				Block *next_p = poolGet(&fioBlockPool);
+				if (!next_p) {
+					break;
+				}
+				next_p->data_p = poolGet(&fioDataPool);
+				if (next_p->data_p == NULL) {
+					poolPut(&fioBlockPool, next_p);
+					break;
+				}
+				memset(next_p->data_p, 0, FIO_BLOCK_SIZE);
+				next_p->prev_p = block_p;
+				next_p->next_p = NULL;
+				block_p->next_p = next_p;
+			}
+			position_p->currBlock_p = block_p->next_p;
+			position_p->offset = 0;
+		}
 
-	if ((pcb_p->stream[streamIdx].mode[0] != 'r')
-			&& (pcb_p->stream[streamIdx].mode[1] != '+')) {
-		logWrite(FIO_INVREQ_READ, pcb_p->stream[streamIdx].id, NULL);
-		return -1;
+		n = FIO_BLOCK_SIZE - position_p->offset;
+		if (n > len - done) {
+			n = len - done;
+		}
+		memcpy(position_p->currBlock_p->data_p + position_p->offset, src_p + done, n);
+		position_p->offset += n;
+		INODE(inodeIdx).size += n;
+		done += n;
 	}
 
-	int c;
-	int n = len;
+	return done;
+}
 
-	*str_p = '\0';
+/* copies up to len bytes out of a RAM file from the position of a checked
+ * stream, as many at a time as the current block holds, up to the end of file;
+ * stops after a new line if line is set. returns the number of bytes read
+ */
+int ramCopyOut(Stream *stream_p, int inodeIdx, char *dst_p, int len, bool line) {
+	Position *position_p = &stream_p->position;
+	Block *block_p;
+	char *nl_p;
+	int done = 0;
+	int n;
 
-	while ((--n > 0) && ((c = ramGetc(fi)) != -1) && (c != -1)) {
-		*str_p = (char) c;
-		str_p++;
-		if (c == '\n') {
+	while (done < len) {
+		block_p = position_p->currBlock_p;
+		if (block_p == NULL) {
 			break;
 		}
+		if (position_p->offset == FIO_BLOCK_SIZE) {
+			if (block_p->next_p == NULL) {
+				break;
+			}
+			block_p = position_p->currBlock_p = block_p->next_p;
+			position_p->offset = 0;
+		}
+
+		n = ramBlockEnd(inodeIdx, block_p) - position_p->offset;
+		if (n <= 0) {
+			break; /* end of file */
+		}
+		if (n > len - done) {
+			n = len - done;
+		}
+		if (line && ((nl_p = memchr(block_p->data_p + position_p->offset, '\n', n)) != NULL)) {
+			n = nl_p - (block_p->data_p + position_p->offset) + 1;
+			len = done + n;
+		}
+		memcpy(dst_p + done, block_p->data_p + position_p->offset, n);
+		position_p->offset += n;
+		done += n;
 	}
-	*str_p = '\0';
 
-	return (0);
+	return done;
+}
+
+/* the offset just past the data of a block of a RAM file: the blocks before
+ * the last one are full, and the last one holds what is left of the size
+ */
+int ramBlockEnd(int inodeIdx, Block *block_p) {
+	if (block_p->next_p != NULL) {
+		return FIO_BLOCK_SIZE;
+	}
+	if (INODE(inodeIdx).size == 0) {
+		return 0;
+	}
+	return ((INODE(inodeIdx).size - 1) % FIO_BLOCK_SIZE) + 1;
 }
 
 /* open led device file.
@@ -1293,12 +1727,12 @@ int ledOpen(char * id_p, char *mode_p){
 		return (-1);
 	}
 
-	if (inode[inodeIdx].accessCount >= 1){
+	if (INODE(inodeIdx).accessCount >= 1){
 		/* led accessed by another process*/
 		return (-1);
 	}else{
 		/*reserve led for this process process*/
-		inode[inodeIdx].accessCount++;
+		INODE(inodeIdx).accessCount++;
 	}
 
 	pcb_p->stream[led].device_p = &fioDevice[LED];
@@ -1323,14 +1757,14 @@ int ledCreate(int led, char *id_p) {
 		return -1;
 	}
 
-	if (inode[led].accessCount != USHRT_MAX) {
+	if (INODE(led).accessCount != USHRT_MAX) {
 		return led;
 	}
 
-	inode[led].type = LED_DEV;
-	inode[led].lock = false;
-	inode[led].accessCount = 0;
-	inode[led].size = 0;
+	INODE(led).type = LED_DEV;
+	INODE(led).lock = false;
+	INODE(led).accessCount = 0;
+	INODE(led).size = 0;
 
 	int sts;
 	sts = writeDirDevRec(id_p, led, LED_DIR);
@@ -1348,7 +1782,7 @@ int ledCreate(int led, char *id_p) {
  * a 1 or a 0, then nothing happens.
  */
 int ledPutc(int c, myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -1369,7 +1803,7 @@ int ledPutc(int c, myFILE fi) {
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != LED_DEV){
+	if (INODE(inodeIdx).type != LED_DEV){
 		return -1;
 	}
 
@@ -1406,7 +1840,7 @@ int ledPutc(int c, myFILE fi) {
 	return 0;
 }
 int ledGetc(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -1427,7 +1861,7 @@ int ledGetc(myFILE fi) {
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != LED_DEV){
+	if (INODE(inodeIdx).type != LED_DEV){
 		return -1;
 	}
 
@@ -1486,12 +1920,12 @@ int pbOpen(char * id_p, char *mode_p){
 		return (-1);
 	}
 
-	if (inode[inodeIdx].accessCount >= 1){
+	if (INODE(inodeIdx).accessCount >= 1){
 		/* led accessed by another process*/
 		return (-1);
 	}else{
 		/*reserve led for this process process*/
-		inode[inodeIdx].accessCount++;
+		INODE(inodeIdx).accessCount++;
 	}
 
 	pcb_p->stream[pb].device_p = &fioDevice[PUSH_BUTTON];
@@ -1515,14 +1949,14 @@ int pbCreate(int pb, char *id_p) {
 	if (pb == -1)
 		return -1;
 
-	if (inode[pb].accessCount != USHRT_MAX) {
+	if (INODE(pb).accessCount != USHRT_MAX) {
 		return pb;
 	}
 
-	inode[pb].type = PUSH_BUTTON_DEV;
-	inode[pb].lock = false;
-	inode[pb].accessCount = 0;
-	inode[pb].size = 0;
+	INODE(pb).type = PUSH_BUTTON_DEV;
+	INODE(pb).lock = false;
+	INODE(pb).accessCount = 0;
+	INODE(pb).size = 0;
 
     int sts;
 	sts = writeDirDevRec(id_p, pb, PB_DIR);
@@ -1540,7 +1974,7 @@ int pbPutc(int c, myFILE fi) {
 	return 0;
 }
 int pbGetc(myFILE fi) {
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -1561,7 +1995,7 @@ int pbGetc(myFILE fi) {
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != PUSH_BUTTON_DEV){
+	if (INODE(inodeIdx).type != PUSH_BUTTON_DEV){
 		return -1;
 	}
 
@@ -1616,12 +2050,12 @@ int lcdOpen(char * id_p, char *mode_p){
 		return (-1);
 	}
 
-	if (inode[inodeIdx].accessCount >= 1){
+	if (INODE(inodeIdx).accessCount >= 1){
 		/* led accessed by another process*/
 		return (-1);
 	}else{
 		/*reserve led for this process process*/
-		inode[inodeIdx].accessCount++;
+		INODE(inodeIdx).accessCount++;
 	}
 
 	pcb_p->stream[lcd].device_p = &fioDevice[TWR_LCD];
@@ -1641,14 +2075,14 @@ int lcdCreate(int lcd, char *id_p){
 		return -1;
 	}
 
-	if (inode[lcd].accessCount != USHRT_MAX) {
+	if (INODE(lcd).accessCount != USHRT_MAX) {
 		return lcd;
 	}
 
-	inode[lcd].type = LCD;
-	inode[lcd].lock = false;
-	inode[lcd].accessCount = 0;
-	inode[lcd].size = 0;
+	INODE(lcd).type = LCD;
+	INODE(lcd).lock = false;
+	INODE(lcd).accessCount = 0;
+	INODE(lcd).size = 0;
 
 	int sts;
 	sts = writeDirDevRec(id_p, lcd, DEV_DIR);
@@ -1660,7 +2094,7 @@ int lcdCreate(int lcd, char *id_p){
 	return (lcd);
 }
 int lcdPutc(int c, myFILE fi){
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -1681,7 +2115,7 @@ int lcdPutc(int c, myFILE fi){
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != LCD){
+	if (INODE(inodeIdx).type != LCD){
 		return -1;
 	}
 
@@ -1734,12 +2168,12 @@ int anlgOpen(char * id_p, char *mode_p){
 		return (-1);
 	}
 
-	if (inode[inodeIdx].accessCount >= 1){
+	if (INODE(inodeIdx).accessCount >= 1){
 		/* led accessed by another process*/
 		return (-1);
 	}else{
 		/*reserve led for this process process*/
-		inode[inodeIdx].accessCount++;
+		INODE(inodeIdx).accessCount++;
 	}
 
 	pcb_p->stream[anlg].device_p = &fioDevice[ANALOG];
@@ -1758,14 +2192,14 @@ int anlgCreate(int anlg, char *id_p){
 		return -1;
 	}
 
-	if (inode[anlg].accessCount != USHRT_MAX) {
+	if (INODE(anlg).accessCount != USHRT_MAX) {
 		return anlg;
 	}
 
-	inode[anlg].type = ANALOG_DEV;
-	inode[anlg].lock = false;
-	inode[anlg].accessCount = 0;
-	inode[anlg].size = 0;
+	INODE(anlg).type = ANALOG_DEV;
+	INODE(anlg).lock = false;
+	INODE(anlg).accessCount = 0;
+	INODE(anlg).size = 0;
 
 	int sts;
 	sts = writeDirDevRec(id_p, anlg, ANALOG_DIR);
@@ -1782,7 +2216,7 @@ int anlgPutc(int c, myFILE fi){
 	return 0;
 }
 int anlgGetc(myFILE fi){
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -1802,7 +2236,7 @@ int anlgGetc(myFILE fi){
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != ANALOG_DEV){
+	if (INODE(inodeIdx).type != ANALOG_DEV){
 		return -1;
 	}
 
@@ -1847,12 +2281,12 @@ int tsOpen(char * id_p, char *mode_p){
 		return (-1);
 	}
 
-	if (inode[inodeIdx].accessCount >= 1){
+	if (INODE(inodeIdx).accessCount >= 1){
 		/* led accessed by another process*/
 		return (-1);
 	}else{
 		/*reserve led for this process process*/
-		inode[inodeIdx].accessCount++;
+		INODE(inodeIdx).accessCount++;
 	}
 
 	pcb_p->stream[ts].device_p = &fioDevice[TOUCH_SENSOR];
@@ -1871,14 +2305,14 @@ int tsCreate(int ts, char *id_p){
 		return -1;
 	}
 
-	if (inode[ts].accessCount != USHRT_MAX) {
+	if (INODE(ts).accessCount != USHRT_MAX) {
 		return ts;
 	}
 
-	inode[ts].type = TOUCH_SENSOR_DEV;
-	inode[ts].lock = false;
-	inode[ts].accessCount = 0;
-	inode[ts].size = 0;
+	INODE(ts).type = TOUCH_SENSOR_DEV;
+	INODE(ts).lock = false;
+	INODE(ts).accessCount = 0;
+	INODE(ts).size = 0;
 
 	int sts;
 	sts = writeDirDevRec(id_p, ts, TS_DIR);
@@ -1894,7 +2328,7 @@ int tsPutc(int c, myFILE fi){
 	return 0;
 }
 int tsGetc(myFILE fi){
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)){
+	if ((fi < 0) || (fi >= pcbNumStreams())){
 		return -1;
 	}
 
@@ -1915,7 +2349,7 @@ int tsGetc(myFILE fi){
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)){
 		return -1;
 	}
-	if (inode[inodeIdx].type != TOUCH_SENSOR_DEV){
+	if (INODE(inodeIdx).type != TOUCH_SENSOR_DEV){
 		return -1;
 	}
 
@@ -2015,29 +2449,71 @@ int fileCreate(char * id_p, char *permSpec_p) {
 
 /* the next two function reserve/release inodes (create/delete files) in the inode table */
 
-/* get the index of the first free inode:
+/* get the index of the first free inode; once there is none, the next chunk
+ * of the inode table is added.
  * takes in no arguments;
  * returns the inode index or FIO_MAX_FILES if there are no free inodes left
  */
 unsigned short getFreeInodeIdx(void) {
+	if (firstFreeInode == FIO_MAX_FILES) {
+		inodeChunkAdd();
+	}
+
 	unsigned short inodeIdx = firstFreeInode;
 
 	if (firstFreeInode != FIO_MAX_FILES) {
 		/* reset pointer to first free inode entry */
-		firstFreeInode = inode[firstFreeInode].nextFreeIdx;
+		firstFreeInode = INODE(firstFreeInode).nextFreeIdx;
 
 		/* reset inode */
-		inode[inodeIdx].type = NONE;
-		inode[inodeIdx].numRec = 0;
-		inode[inodeIdx].numFreeRec = 0;
-		inode[inodeIdx].lock = false;
-		inode[inodeIdx].accessCount = 0;
-		inode[inodeIdx].firstBlock_p = NULL;
-		inode[inodeIdx].size = 0;
+		INODE(inodeIdx).type = NONE;
+		INODE(inodeIdx).numRec = 0;
+		INODE(inodeIdx).numFreeRec = 0;
+		INODE(inodeIdx).dirIndex_p = NULL;
+		INODE(inodeIdx).lock = false;
+		INODE(inodeIdx).accessCount = 0;
+		INODE(inodeIdx).firstBlock_p = NULL;
+		INODE(inodeIdx).size = 0;
 	}
 	return (inodeIdx);
 }
 
+/* allocates the next chunk of the inode table, and puts its inodes (but the
+ * reserved ones) on the free list, in index order.
+ * takes in no arguments;
+ * returns -1 if the table is full, or there is no memory for the chunk
+ */
+int inodeChunkAdd(void) {
+	if (numInodeChunks == FIO_INODE_CHUNKS) {
+		return -1;
+	}
+
+	INode *chunk_p = memAlloc(sizeof(INode) * FIO_INODES_PER_CHUNK, -1);
+	if (!chunk_p) {
+		return -1;
+	}
+
+	unsigned first = numInodeChunks * FIO_INODES_PER_CHUNK;
+	unsigned end = first + FIO_INODES_PER_CHUNK;
+	unsigned i;
+
+	if (end > FIO_MAX_FILES) {
+		end = FIO_MAX_FILES;
+	}
+	inodeChunk[numInodeChunks++] = chunk_p;
+	if (first <= LAST_RESERVED_TYPE) {
+		first = LAST_RESERVED_TYPE + 1;
+	}
+
+	/* chain the new inodes in front of what is left of the free list */
+	for (i = first; i < end - 1; i++) {
+		INODE(i).nextFreeIdx = i + 1;
+	}
+	INODE(end - 1).nextFreeIdx = firstFreeInode;
+	firstFreeInode = first;
+	return 0;
+}
+
 /* frees the inode entry.
  * the new free inode is set to be the first free inode
  * takes in the inode index;
@@ -2049,21 +2525,23 @@ void releaseInodeIdx(unsigned short inodeIdx) {
 		return;
 	}
 
-	myFree(inode[inodeIdx].user_p);
+	myFree(INODE(inodeIdx).user_p);
+	dirIndexFree(inodeIdx);
+	pathCacheInvalidate(inodeIdx);
 
 	/* free allocated blocks */
-	Block *block_p = inode[inodeIdx].firstBlock_p;
+	Block *block_p = INODE(inodeIdx).firstBlock_p;
 	while (block_p != NULL) {
 		Block *next_p = block_p->next_p;
-		myFree(block_p->data_p);
-		myFree(block_p);
+		poolPut(&fioDataPool, block_p->data_p);
+		poolPut(&fioBlockPool, block_p);
 		block_p = next_p;
 	}
 
 	/* reset inode */
-	inode[inodeIdx].processID = -1;
+	INODE(inodeIdx).processID = -1;
 
-	inode[inodeIdx].nextFreeIdx = firstFreeInode;
+	INODE(inodeIdx).nextFreeIdx = firstFreeInode;
 	firstFreeInode = inodeIdx;
 
 }
@@ -2199,19 +2677,23 @@ int writeDirDevRec(char* name_p, int inodeIdx, int parentInode) {
 	/* record */
 	DirRecord *drec_p;
 
+	/* the slot taken may be on the free list of the index of the dir; it is
+	 * built again as the dir grows */
+	dirIndexFree(parentInode);
+
 	/* check if there are freed record slots from previous files being deleted */
 	/* if so, find the first free record slot and updated with current node info */
 	bool updated = false;
 
 	unsigned short size = 0;
-	Block *block_p = inode[parentInode].firstBlock_p;
+	Block *block_p = INODE(parentInode).firstBlock_p;
 	drec_p = (DirRecord *) block_p->data_p;
 	while (!updated && drec_p != NULL) {
 		if (drec_p->fileName[0] == '\0') {
 			utlStrMCpy(drec_p->fileName, name_p, utlStrLen(name_p),
 					FIO_MAX_FILE_NAME);
 			drec_p->inodeIdx = inodeIdx;
-			inode[parentInode].numFreeRec--;
+			INODE(parentInode).numFreeRec--;
 			updated = true;
 		} else {
 			size += sizeof(DirRecord);
@@ -2229,7 +2711,7 @@ int writeDirDevRec(char* name_p, int inodeIdx, int parentInode) {
 	if (!updated)
 		return -1;
 
-	inode[parentInode].numRec++;
+	INODE(parentInode).numRec++;
 	return 0;
 
 }
@@ -2382,25 +2864,25 @@ void purgeInode(unsigned short inodeIdx) {
 	}
 
 	/* keep first block and free all the rest */
-	Block *block_p = inode[inodeIdx].firstBlock_p->next_p;
+	Block *block_p = INODE(inodeIdx).firstBlock_p->next_p;
 	while (block_p != NULL) {
 		Block *next_p = block_p->next_p;
-		myFree(block_p->data_p);
-		myFree(block_p);
+		poolPut(&fioDataPool, block_p->data_p);
+		poolPut(&fioBlockPool, block_p);
 		block_p = next_p;
 	}
 
-	inode[inodeIdx].firstBlock_p->next_p = NULL;
-	memSet(inode[inodeIdx].firstBlock_p->data_p, 0, FIO_BLOCK_SIZE, false);
-	inode[inodeIdx].size = 0;
+	INODE(inodeIdx).firstBlock_p->next_p = NULL;
+	memset(INODE(inodeIdx).firstBlock_p->data_p, 0, FIO_BLOCK_SIZE);
+	INODE(inodeIdx).size = 0;
 }
 
 void setUser(int inodeIdx) {
 	if ((inodeIdx < 0) || (inodeIdx > FIO_MAX_FILES)) {
 		return;
 	}
-	inode[inodeIdx].user_p = memAlloc(sizeof(usr_t), false);
-	usrGetCurrent(inode[inodeIdx].user_p);
+	INODE(inodeIdx).user_p = memAlloc(sizeof(usr_t), false);
+	usrGetCurrent(INODE(inodeIdx).user_p);
 }
 
 /* permissions mask: 9 bits:
@@ -2412,18 +2894,18 @@ void setPermissions(int inodeIdx, char *permSpec_p) {
 		return;
 	}
 
-	inode[inodeIdx].perm.mask = 0;
+	INODE(inodeIdx).perm.mask = 0;
 
 	if (!permSpec_p) {
-		inode[inodeIdx].perm.bit.oR = 1;
-		inode[inodeIdx].perm.bit.oW = 1;
-		inode[inodeIdx].perm.bit.oX = 1;
+		INODE(inodeIdx).perm.bit.oR = 1;
+		INODE(inodeIdx).perm.bit.oW = 1;
+		INODE(inodeIdx).perm.bit.oX = 1;
 
-		inode[inodeIdx].perm.bit.gR = 1;
-		inode[inodeIdx].perm.bit.gW = 1;
+		INODE(inodeIdx).perm.bit.gR = 1;
+		INODE(inodeIdx).perm.bit.gW = 1;
 
-		inode[inodeIdx].perm.bit.wR = 1;
-		inode[inodeIdx].perm.bit.wW = 1;
+		INODE(inodeIdx).perm.bit.wR = 1;
+		INODE(inodeIdx).perm.bit.wW = 1;
 
 	}
 
@@ -2431,33 +2913,33 @@ void setPermissions(int inodeIdx, char *permSpec_p) {
 		unsigned len = utlStrLen(permSpec_p);
 
 		if ((len >= 1) && (permSpec_p[0] != '-')) {
-			inode[inodeIdx].perm.bit.oR = 1;
+			INODE(inodeIdx).perm.bit.oR = 1;
 		}
 		if ((len >= 2) && (permSpec_p[1] != '-')) {
-			inode[inodeIdx].perm.bit.oW = 1;
+			INODE(inodeIdx).perm.bit.oW = 1;
 		}
 		if ((len >= 3) && (permSpec_p[2] != '-')) {
-			inode[inodeIdx].perm.bit.oX = 1;
+			INODE(inodeIdx).perm.bit.oX = 1;
 		}
 
 		if ((len >= 1) && (permSpec_p[3] != '-')) {
-			inode[inodeIdx].perm.bit.gR = 1;
+			INODE(inodeIdx).perm.bit.gR = 1;
 		}
 		if ((len >= 2) && (permSpec_p[4] != '-')) {
-			inode[inodeIdx].perm.bit.gW = 1;
+			INODE(inodeIdx).perm.bit.gW = 1;
 		}
 		if ((len >= 3) && (permSpec_p[5] != '-')) {
-			inode[inodeIdx].perm.bit.gX = 1;
+			INODE(inodeIdx).perm.bit.gX = 1;
 		}
 
 		if ((len >= 1) && (permSpec_p[6] != '-')) {
-			inode[inodeIdx].perm.bit.wR = 1;
+			INODE(inodeIdx).perm.bit.wR = 1;
 		}
 		if ((len >= 2) && (permSpec_p[7] != '-')) {
-			inode[inodeIdx].perm.bit.wW = 1;
+			INODE(inodeIdx).perm.bit.wW = 1;
 		}
 		if ((len >= 3) && (permSpec_p[8] != '-')) {
-			inode[inodeIdx].perm.bit.wX = 1;
+			INODE(inodeIdx).perm.bit.wX = 1;
 		}
 	}
 }
@@ -2471,46 +2953,46 @@ bool getPermission(int inodeIdx, char *access_p) {
 	usrGetCurrent(&user);
 
 	if ((*access_p == 'w') || (*access_p == 'a')) {
-		if (inode[inodeIdx].perm.bit.wW) {
+		if (INODE(inodeIdx).perm.bit.wW) {
 			return true;
 		}
 
-		if (utlStrNCmp(user.name, inode[inodeIdx].user_p->name,
-				USR_MAX_NAME_LEN) && inode[inodeIdx].perm.bit.oW) {
+		if (utlStrNCmp(user.name, INODE(inodeIdx).user_p->name,
+				USR_MAX_NAME_LEN) && INODE(inodeIdx).perm.bit.oW) {
 			return true;
 		}
 
-		if (utlStrNCmp(user.group, inode[inodeIdx].user_p->group,
-				USR_MAX_NAME_LEN) && inode[inodeIdx].perm.bit.gW) {
+		if (utlStrNCmp(user.group, INODE(inodeIdx).user_p->group,
+				USR_MAX_NAME_LEN) && INODE(inodeIdx).perm.bit.gW) {
 			return true;
 		}
 
 	} else if (*access_p == 'r') {
-		if (inode[inodeIdx].perm.bit.wR) {
+		if (INODE(inodeIdx).perm.bit.wR) {
 			return true;
 		}
 
-		if (utlStrNCmp(user.name, inode[inodeIdx].user_p->name,
-				USR_MAX_NAME_LEN) && inode[inodeIdx].perm.bit.oR) {
+		if (utlStrNCmp(user.name, INODE(inodeIdx).user_p->name,
+				USR_MAX_NAME_LEN) && INODE(inodeIdx).perm.bit.oR) {
 			return true;
 		}
 
-		if (utlStrNCmp(user.group, inode[inodeIdx].user_p->group,
-				USR_MAX_NAME_LEN) && inode[inodeIdx].perm.bit.gR) {
+		if (utlStrNCmp(user.group, INODE(inodeIdx).user_p->group,
+				USR_MAX_NAME_LEN) && INODE(inodeIdx).perm.bit.gR) {
 			return true;
 		}
 	} else if (*access_p == 'x') {
-		if (inode[inodeIdx].perm.bit.wX) {
+		if (INODE(inodeIdx).perm.bit.wX) {
 			return true;
 		}
 
-		if (utlStrNCmp(user.name, inode[inodeIdx].user_p->name,
-				USR_MAX_NAME_LEN) && inode[inodeIdx].perm.bit.oX) {
+		if (utlStrNCmp(user.name, INODE(inodeIdx).user_p->name,
+				USR_MAX_NAME_LEN) && INODE(inodeIdx).perm.bit.oX) {
 			return true;
 		}
 
-		if (utlStrNCmp(user.group, inode[inodeIdx].user_p->group,
-				USR_MAX_NAME_LEN) && inode[inodeIdx].perm.bit.gX) {
+		if (utlStrNCmp(user.group, INODE(inodeIdx).user_p->group,
+				USR_MAX_NAME_LEN) && INODE(inodeIdx).perm.bit.gX) {
 			return true;
 		}
 	}
@@ -2662,13 +3144,17 @@ int fileCloseX(myFILE fi, ProcessControlBlock *pcb_p) {
 		pcb_p = getCurrentPCB();
 	}
 
-	if ((fi < 0) || (fi > FIO_MAX_STREAMS)) {
+	if (!pcb_p || (fi < 0) || (fi >= pcb_p->numStreams)) {
 		return -1;
 	}
 	uint8_t streamIdx = (uint8_t) fi;
 
-	/* update inode entry */
-	inode[pcb_p->stream[streamIdx].inodeIdx].accessCount--;
+	/* update inode entry; a pipe has none, the end is closed instead */
+	if (pcb_p->stream[streamIdx].device_p->type == PIPE) {
+		pipeCloseEnd(pcb_p->stream[streamIdx].pipe_p, pcb_p->stream[streamIdx].mode[0] == 'w');
+	} else {
+		INODE(pcb_p->stream[streamIdx].inodeIdx).accessCount--;
+	}
 	pcbReleaseStreamIdxX(streamIdx, pcb_p);
 	return (0);
 }
@@ -54,15 +54,29 @@ int ramGetc(myFILE fi); /* reads char from a file = c <= (stream=>inode=>file of
 
 uint8_t ramStreamSet(char *id_p, unsigned short inodeIdx, char *mode_p);
 FNode findFile(char *name_p, int parentInode, bool create, char *permSpec_p);
+FNode findNode(char *name_p, int parentInode, bool create, char *permSpec_p);
 int writeDirRec(char *name_p, unsigned short len, int inodeIdx, int parentInode,
 		Position position);
-int eraseDirRec(int inodeIdx, int parentInode);
+int eraseDirRec(char *name_p, unsigned short len, int inodeIdx, int parentInode);
 int dirCreate(int parentIdx);
 int dirDevCreate(int parentIdx, int inodeIdx);
 int regCreate(void);
 int ramInodeSet(unsigned short inodeIdx, FileType type);
 int searchDir(char *nodeName_p, unsigned short len, int parentInode,
 		Position *position_p);
+uint32_t dirHash(char *name_p, unsigned short len);
+int dirIndexBuild(int dirInode);
+void dirIndexFree(int dirInode);
+int dirIndexAdd(DirIndex *index_p, DirRecord *drec_p);
+void dirIndexInsert(DirIndex *index_p, DirEntry *entry_p);
+DirEntry *dirIndexFind_p(DirIndex *index_p, char *name_p, unsigned short len);
+DirRecord *dirIndexRemove_p(DirIndex *index_p, char *name_p,
+		unsigned short len, int inodeIdx);
+void pathCacheInit(void);
+bool pathCacheFind(char *name_p, int start, FNode *fn_p);
+void pathCacheAdd(char *name_p, int start, FNode fn);
+void pathCacheInvalidate(int inodeIdx);
+void pathCacheDrop(int i);
 
 int ledOpen(char * id_p, char *mode_p);
 int ledCreate(int led, char *id_p);
@@ -92,6 +106,7 @@ int tsGetc(myFILE fi);
 /* helper functions */
 unsigned short getFreeInodeIdx(void);
 void releaseInodeIdx(unsigned short inodeIdx);
+int inodeChunkAdd(void);
 int getHwType(char *id_p);
 int getPresetIdx(char *id_p, unsigned short len);
 bool validNodeName(char *name_p, unsigned short len);
@@ -108,6 +123,12 @@ int getTsStream(char *id_p);
 
 int ramPuts(char *str, myFILE fi);
 int ramGets(char *str_p, int len, myFILE fi);
+int ramWrite(const void *buf_p, int len, myFILE fi);
+int ramRead(void *buf_p, int len, myFILE fi);
+Stream *ramStream_p(myFILE fi, bool write, int *inodeIdx_p);
+int ramCopyIn(Stream *stream_p, int inodeIdx, const char *src_p, int len);
+int ramCopyOut(Stream *stream_p, int inodeIdx, char *dst_p, int len, bool line);
+int ramBlockEnd(int inodeIdx, Block *block_p);
 
 int logWrite(FioErrno error, char *str1_p, char *str2_p);
 int logRead(char *str_p, int len);
@@ -124,6 +145,8 @@ int stubI(int num);
 int stubC(char* str);
 int stubPuts(char *str, myFILE fi);
 int stubGets(char *str, int len, myFILE fi);
+int charWrite(const void *buf_p, int len, myFILE fi);
+int charRead(void *buf_p, int len, myFILE fi);
 int stubCr(char* str, char* spec);
 
 int fileCloseX(myFILE fi, ProcessControlBlock *pcb_p);
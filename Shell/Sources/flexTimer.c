@@ -17,9 +17,25 @@
 #include "derivative.h"
 #include "nvic.h"
 #include "flexTimer.h"
+#include "wheel.h"
+#include "pcb.h"
+#include "utl.h"
 
 uint64_t clockInMill;
 
+/* while the idle process runs, the modulo register is set for the time up to
+ * the next wheel deadline rather than for 1 ms, so the processor is not woken
+ * every ms; the interrupt then counts all the ms of the period at once.
+ * flexTimerMsCount is the modulo count of a ms; flexTimerPeriodMs the ms the
+ * next overflow counts; flexTimerCountedMs the ms of the period counted before
+ * it is over, as the idle process gave way
+ */
+uint16_t flexTimerMsCount;
+volatile uint32_t flexTimerPeriodMs = 1;
+volatile uint32_t flexTimerCountedMs = 0;
+
+void flexTimer0SetModulo(uint32_t modulo);
+
 /* For an overall description of the FlexTimer, see 43.4 on labeled
  * page 1251 (PDF page 1258) of the K70 Sub-Family Reference Manual,
  * Rev. 4, Oct 2015 (see 44.4 on page 1275 of the K70 Sub-Family
@@ -120,6 +136,9 @@ void flexTimer0Init(uint16_t count) {
 
   /* Load timer count (16-bit value) into the modulo register */
   FTM0_MOD = count;
+  flexTimerMsCount = count;
+  flexTimerPeriodMs = 1;
+  flexTimerCountedMs = 0;
 
   /* Enable interrupts from FTM0 and set its interrupt priority */
   NVICEnableIRQ(FTM0_IRQ_NUMBER, FTM0_INTERRUPT_PRIORITY);
@@ -185,12 +204,83 @@ void flexTimer0Isr(void) {
     FTM_SC_CLKS(FTM_SC_CLKS_SYSTEM_CLOCK) |
     FTM_SC_PS(FTM_SC_PS_DIVIDE_BY_32);
 
+  /* a stretched period is over: back to a period of 1 ms; the scheduler
+   * stretches it again if the idle process still runs */
+  uint32_t ms = flexTimerPeriodMs;
+  if (FTM0_MOD != flexTimerMsCount) {
+    flexTimer0SetModulo(flexTimerMsCount);
+    flexTimerPeriodMs = 1;
+  }
+  flexTimerCountedMs = 0;
+
   /* Perform the user's action */
-  flexTimer0Action();
+  flexTimer0Action(ms);
+  if (ms > 1) {
+    yield();
+  }
+}
+
+/* set the modulo register; the counter is stopped meanwhile, so the value is
+ * taken at once rather than at the next overflow, and keeps its count
+ */
+void flexTimer0SetModulo(uint32_t modulo) {
+  FTM0_SC = FTM_SC_TOIE_MASK |
+    FTM_SC_CLKS(FTM_SC_CLKS_NO_CLOCK) |
+    FTM_SC_PS(FTM_SC_PS_DIVIDE_BY_32);
+  FTM0_MOD = modulo;
+  FTM0_SC = FTM_SC_TOIE_MASK |
+    FTM_SC_CLKS(FTM_SC_CLKS_SYSTEM_CLOCK) |
+    FTM_SC_PS(FTM_SC_PS_DIVIDE_BY_32);
+}
+
+/* have the next overflow come ms ms from the last ms counted, as far as the
+ * 16-bit counter goes (34 ms from the last overflow); called by the scheduler
+ * as the idle process is picked, with the time up to the next wheel deadline.
+ * nothing is changed if an overflow is pending already
+ */
+void flexTimer0Stretch(uint32_t ms) {
+  uint32_t maxMs = (FTM_MOD_MOD_MASK + 1) / (flexTimerMsCount + 1);
+
+  di();
+  if (ms > (maxMs - flexTimerCountedMs)) {
+    ms = maxMs - flexTimerCountedMs;
+  }
+  if ((ms > flexTimerPeriodMs) && !(FTM0_SC & FTM_SC_TOF_MASK)) {
+    /* the counter is within the ms after those counted */
+    flexTimer0SetModulo(((flexTimerCountedMs + ms) * (flexTimerMsCount + 1)) - 1);
+    flexTimerPeriodMs = ms;
+  }
+  ei();
+}
+
+/* count the ms of a stretched period that have gone by, and end it at the next
+ * ms; called by the scheduler as the idle process gives way, so that the wheel
+ * is caught up before it is advanced. if the period is over already, the
+ * interrupt pending counts it
+ */
+void flexTimer0Resume(void) {
+  uint32_t ms;
+
+  if (flexTimerPeriodMs == 1) {
+    return;
+  }
+
+  di();
+  if (!(FTM0_SC & FTM_SC_TOF_MASK)) {
+    ms = FTM0_CNT / (flexTimerMsCount + 1);
+    flexTimer0SetModulo(((ms + 1) * (flexTimerMsCount + 1)) - 1);
+    flexTimerPeriodMs = 1;
+    if (ms > flexTimerCountedMs) {
+      flexTimer0Action(ms - flexTimerCountedMs);
+      flexTimerCountedMs = ms;
+    }
+  }
+  ei();
 }
 
-void flexTimer0Action(){
-	clockInMill += 1;
+void flexTimer0Action(uint32_t ms){
+	clockInMill += ms;
+	wheelTick(ms);
 }
 
 void flexTimerSetClock(uint32_t hi32, uint32_t low32){
@@ -87,7 +87,11 @@ void flexTimer0Stop(void);
 
 void flexTimer0Isr(void);
 
-void flexTimer0Action(void);
+void flexTimer0Action(uint32_t ms);
+
+void flexTimer0Stretch(uint32_t ms);
+
+void flexTimer0Resume(void);
 
 void flexTimerSetClock(uint32_t hi32, uint32_t low32);
 uint32_t flexTimerGetClockHi();
@@ -16,6 +16,8 @@
 #define HELP_MALLOC "\r\n malloc:\tallocate a certain number of bytes (specified by user). To execute type `malloc <# of bytes>`\r\n"
 #define HELP_FREE "\r\n free:\t\tdeallocate a region of memory. Address of target region is given by user. To execute type\r\n\t\t`free <address>`\r\n"
 #define HELP_MEMMAP "\r\n memorymap:\toutput the map of both allocated and free memory regions. To execute type 'memorymap'\r\n"
+#define HELP_MEMSTAT "\r\n memstat:\toutput the allocator statistics: bytes free and in use (in total and per PID), largest free\r\n\t\tregion, number of allocations and frees, and free regions per size class. To execute type 'memstat'\r\n"
+#define HELP_MEMTRACE "\r\n memtrace:\toutput the recorded allocations, frees and process exits, one per line, for replay on the host\r\n\t\twith memreplay (only recorded if built with MEM_TRACE). To execute type 'memtrace dump'\r\n"
 #define HELP_MEMSET "\r\n memset:\ttakes in a memory region, value to which each byte in the specified region will be set,\r\n\t\tand the length (in bytes) of the memory region. To execute, type \r\n\t\t`memset <address> <value> <# of bytes>`\r\n"
 #define HELP_MEMCHK "\r\n memchk:\ttakes in a memory region, value to which each byte in the specified region should contain,\r\n\t\tand the length (in bytes) of the memory region. To execute, type \r\n\t\t`memchk <address> <value> <# of bytes>`\r\n"
 #define HELP_DEPOSIT "\r\n deposit:\t deposit a series of bytes to be stored in successive locations in memory starting at a\r\n\t\tparticular location. To execute, type `deposit <first location in memory> <list of the values of\r\n\t\tbytes to be stored in successive locations in memory>`\r\n"
@@ -32,6 +34,7 @@
 #define HELP_FPUTC "\r\n fputc:\t\tput a character in a file. Must have open stream in correct mode. To execute type \r\n\t\t'fputc <char> <stream id>'\r\n"
 #define HELP_FGETC "\r\n fgetc:\t\tget the current character being pointed to in a file. Must have open stream in correct\r\n\t\tmode. To execute, type `fgetc <stream id>`\r\n"
 #define HELP_PRINT "\r\n ls:\t\tprint the files in a directory. To execute, type `ls /<dir path>/`\r\n"
+#define HELP_FSSTAT "\r\n fsstat:\tprint how many path names were found in the path lookup cache, how many were looked up\r\n\t\tdir by dir, and how many the cache holds. To execute type 'fsstat'\r\n"
 #define HELP_FPUR "\r\n purge:\t\tpurge the contents of a file. To execute, type `purge <file name>`\r\n"
 
 #define HELP_SER2LCD "\r\n ser2lcd:\t continuously copy characters from serial input to LCD. Ends on a ^D (control-D) input \r\n\t\tcharacter. To execute type `ser2lcd'\r\n"
@@ -44,7 +47,11 @@
 #define HELP_FLASHGB_START "\r\n spawnFlashGB:\t spawns a process to alternate the flashing of the green and blue LEDs. Can\r\n\t\tonly be run by admin. To execute, type `spawnFlashGB`\r\n"
 #define HELP_FLASHGB_STOP "\r\n killFlashGB:\t kills the process that alternates the flashing of the green and blue LEDs. Can\r\n\t\tonly be run by admin. To execute, type `killFlashGB`\r\n"
 
-#define HELP_SPAWN "\r\n spawn:\t\tspawns a new process that either runs flashled, touch2led, or pb2led. Can also be used to\r\n\t\tspawn a process that runs the flashing blue and green LEDs (requires killFlashGB to terminate).\r\n\t\tCan only be run by admin. To execute, type `spawn <command>` or `spawn flashGB`\r\n"
+#define HELP_SPAWN "\r\n spawn:\t\tspawns a new process that either runs flashled, touch2led, or pb2led. Can also be used to\r\n\t\tspawn a process that runs the flashing blue and green LEDs (requires killFlashGB to terminate).\r\n\t\tCan only be run by admin. To execute, type `spawn <command> [quota [priority]]` or\r\n\t\t`spawn flashGB [quota [priority]]`, where quota is the number of bytes the process may allocate,\r\n\t\tstack included (0 or not given for no limit), and priority is from 0 (highest) to 31 (default 16)\r\n"
+#define HELP_PS "\r\n ps:\t\toutput the processes with their state, priority, share of the processor and time run, how\r\n\t\tdeep their stack was used, and the memory they hold against their quota, and the time the\r\n\t\tprocessor was idle. To execute type 'ps'\r\n"
+#define HELP_QUANTUM "\r\n quantum:\tset the quantum of a process: the ms it runs before a process of the same priority gets\r\n\t\ta turn, from 1 to 139 (default 20). Can only be run by admin. To execute, type\r\n\t\t`quantum <pid> <ms>`\r\n"
+#define HELP_PRIORITY "\r\n priority:\tset the priority of a process, from 0 (highest) to 31. Can only be run by admin. To execute,\r\n\t\ttype `priority <pid> <priority>`\r\n"
+#define HELP_MASKTIME "\r\n masktime:\toutput the longest time interrupts were disabled and the scheduler was locked. To execute\r\n\t\ttype 'masktime', or 'masktime reset' to start the measurement over\r\n"
 #define HELP_USR_ADD "\r\n adduser:\t add a new user or get list of users. To execute type 'adduser <user name> <group> <password>'\r\n\t\tor 'adduser'\r\n"
 #define HELP_USR_RM "\r\n remuser:\t remove a user. To execute type 'remuser <user name>'\r\n"
 #define HELP_LOG_OUT "\r\n logout:\t logout of, but not exit, the shell. To execute, type `logout`\r\n"
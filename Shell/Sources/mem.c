@@ -4,15 +4,42 @@
  * this module also contains aditional functions and globals that are specificaly used
  * as helper functions and are therefore only accessible here.
  *
- * the memory management for allocation/deallocation uses two linked lists: 
- *  1. list of allocated segments, sorted by address
- *  2. list of free segments sorted by size
+ * the lists are protected by the scheduler lock rather than by disabling interrupts: no other
+ * process can get at them while they are changed, but device interrupts are still taken, so
+ * the time a list operation takes does not add to the interrupt latency.
  *
- * given that,  'first fit' = 'best fit'  method to determine allocation is optimal.
+ * the memory management for allocation/deallocation uses:
+ *  1. boundary tags: every segment, allocated or free, starts with a header and ends with a footer,
+ *     both carrying a tag for the state of the segment and its size
+ *  2. segregated lists of free segments, one per size class, indexed by a two level bitmap
  *
- * both lists - for allocated memory and free memory - are double linked; making free list link contain a pointer
- * to the prev link, does not waste memory (since the free link size is not larger than the alloc link size), and
- * it makes removing the link and merging address-adjacent free links easy and fast.
+ * with the tags, validating an address passed in by the caller, and finding the address-adjacent
+ * segments to merge with when freeing, take constant time; walking the heap from segment to segment
+ * replaces the list of allocated segments where all of them need to be visited (memoryMap).
+ *
+ * allocated segments are also linked into the list of the process that owns them; owner records
+ * are kept in a small table hashed by pid. when a process exits, only its own segments are visited,
+ * and they are released in bulk, merging each run of address-adjacent segments once.
+ *
+ * every process may be given a quota in its PCB; the owner record keeps a pointer to the PCB,
+ * so the bytes a process holds are charged and credited, and an allocation that would take it
+ * over its quota is turned down before any free list is searched, in constant time.
+ *
+ * statistics (bytes free and in use, per process as well, number of free segments per size class,
+ * number of allocations and releases) are updated along with the lists, so memGetStats only has
+ * to copy them and look up the largest free segment through the bitmap.
+ *
+ * when built with MEM_TRACE, every allocation, release, hand over and process exit is also recorded in a ring
+ * buffer at the top of SDRAM; 'memtrace dump' prints it, and Shell/Tools/memreplay.c replays a dump
+ * against this allocator on the host.
+ *
+ * a free segment goes to the head of the list for its size class; allocation rounds the request up to the
+ * next class boundary, so the head of any non-empty class found through the bitmap is large enough ('good fit').
+ * both inserting and finding a free segment take constant time, regardless of the number of free segments.
+ *
+ * free lists are double linked; the free link is stored in the space of the header of the segment,
+ * which is sized for the larger of the two links, so it does not add to the overhead, and it makes
+ * removing the link when merging address-adjacent free segments easy and fast.
  *
  *
  *
@@ -20,9 +47,15 @@
  *		myMalloc(): allocate some memory of a given size for use
  *		myFree(): deallocate memory for future use
  *		myFreeErrorCode(): deallocate memory for future use; returns error status
+ *		memGive(): hand allocated memory over to another owner, without copying it
  *		memoryMap(): print a table of free and used memory
  *		myMemset(): assigns a value to a certain region of memory
+ *		myRealloc(): change the size of allocated memory, in place if possible
+ *		myCalloc(): allocate memory set to 0
+ *		myMemalign(): allocate memory at an aligned address
  *		myMemchk(): check to see if a certain value is stored in a particular region of memory
+ *		memGetStats(): take a snapshot of the allocator statistics
+ *		memTraceDump(): print the allocation trace
  */
 
 /* sys include files */
@@ -37,33 +70,68 @@
 #include "sdram.h"
 #include "lcdc.h"
 #include "svc.h"
+#include "flexTimer.h"
 
 /* globals - not shared with other modules */
 static char *mem_p = NULL;
 static char *memLastAddress_p;
-static MemAllocHeader memAllocHeader;
-static MemFreeHeader memFreeHeader;
+static MemFreeIndex memFreeIndex;
 static unsigned memAllocLinkSize;
+static unsigned memFooterSize;
+static MemOwner memOwner[MEM_MAX_OWNERS];
+static MemOwner *memOwnerBucket[MEM_OWNER_BUCKETS];
+static MemOwner *memFirstFreeOwner_p;
+static MemStats memStats; /* owner entries are only filled in the snapshot */
+#ifdef MEM_TRACE
+static MemTraceRecord *memTrace_p = (MemTraceRecord *) MEM_TRACE_START;
+static unsigned memTraceCount; /* number of events recorded; the ring holds the last MEM_TRACE_RECORDS */
+static bool memTraceOn;
+#endif /* MEM_TRACE */
 
 /* internal function declarations - to be used by mem utility only */
 unsigned memModDouble(unsigned size);
 void memInit(void);
 void memFreeListInit(void);
 void memAllocListInit(void);
-MemAllocLink *memFindAllocPrev_p(MemAllocLink *alloc_p);
+void memOwnerInit(void);
+MemOwner *memFindOwner_p(pid_t pId);
+MemOwner *memAddOwner_p(pid_t pId);
+ProcessControlBlock *memOwnerPCB_p(pid_t pId);
+void memCharge(MemOwner *owner_p, unsigned bytes);
+bool memOverQuota(MemOwner *owner_p, unsigned bytes);
+void memRemoveOwner(MemOwner *owner_p);
+void memLinkOwner(MemOwner *owner_p, MemAllocLink *alloc_p);
+void memUnlinkOwner(MemAllocLink *alloc_p);
+void memBulkFree(MemOwner *owner_p);
+void memReleaseAlloc(MemAllocLink *alloc_p);
+void memCountResize(MemAllocLink *alloc_p, unsigned oldSize);
+void memShrinkAlloc(MemAllocLink *alloc_p, unsigned size);
+bool memGrowAlloc(MemAllocLink *alloc_p, unsigned size);
+MemFooter *memFooter_p(char *address_p, unsigned size);
+void memSetFooter(char *address_p, unsigned size, unsigned tag);
 bool memMatchAlloc(MemAllocLink *alloc_p);
 MemAllocLink *memInsertAllocLink_p(char *address_p, unsigned size);
 void memRemoveAllocLink(MemAllocLink *alloc_p);
+void memMapSize(unsigned size, unsigned *fl_p, unsigned *sl_p);
 MemFreeLink *memFindSufficientFree(unsigned size);
-MemFreeLink *memFindFreePrev_p(MemFreeLink *free_p, MemFreeLink *start_p);
 bool memMatchFree_p(MemFreeLink *free_p);
-MemFreeLink *memInsertFreeLink_p(char *address_p, unsigned size,
-		MemFreeLink *freeFirst_p);
+MemFreeLink *memInsertFreeLink_p(char *address_p, unsigned size);
 void memRemoveFreeLink(MemFreeLink *free_p);
 void memMergeFree(char *address_p, unsigned size, MemFreeLink *adjPrior_p,
 		MemFreeLink *adjPost_p);
-unsigned int memCheckAddress(void *address_p);
+void memFill(char *dst_p, uint8_t val, unsigned nbytes);
+bool memCheckFill(const char *src_p, uint8_t val, unsigned nbytes);
+void memCopy(char *dst_p, const char *src_p, unsigned nbytes);
 void *memAlloc(unsigned size, int pId);
+void *memAllocSegment_p(unsigned size, pid_t pId);
+void memTraceEvent(MemTraceEvent event, pid_t pId, unsigned size,
+		void *address_p, void *previous_p, void *caller_p);
+
+#ifdef MEM_TRACE
+#define MEM_TRACE_EVENT(E,P,S,A,O) memTraceEvent((E), (P), (S), (A), (O), __builtin_return_address(0))
+#else
+#define MEM_TRACE_EVENT(E,P,S,A,O)
+#endif /* MEM_TRACE */
 MemErrno memSet(void *address_p, int val, unsigned nbytes, bool checkPID);
 
 /* function definitions */
@@ -75,36 +143,75 @@ void *myMalloc(unsigned size) {
 	return (memAlloc(size, 0));
 }
 void *memAlloc(unsigned size, int pId) {
+	void *address_p;
 
-	if ((size < 0) || (size > (MEM_MAX_SIZE - memAllocLinkSize)))
+	if (mem_p == NULL)
+		memInit();
+
+	if (pId == 0){
+		pId = pid();
+	}else if (pId == -1){
+		pId = NO_PID;
+	}
+
+	address_p = memAllocSegment_p(size, pId);
+	MEM_TRACE_EVENT(MEM_TRACE_ALLOC, pId, size, address_p, NULL);
+
+	return (address_p);
+}
+
+/* find a free segment for the allocation and split it; pId is the owner of the segment */
+void *memAllocSegment_p(unsigned size, pid_t pId) {
+	if ((size < 0)
+			|| (size > (MEM_MAX_SIZE - memAllocLinkSize - memFooterSize))) {
+		memStats.numFailed++;
 		MEM_RETURN(MEM_INV_SIZE, NULL);
+	}
 
 	memErrno = MEM_NO_ERROR;
 	if (size == 0)
 		return NULL;
 
-	if (mem_p == NULL)
-		memInit();
-
 	/* ensure an 8-byte allignment*/
 	size = memModDouble(size);
-	unsigned requiredSize = size + memAllocLinkSize;
+	unsigned requiredSize = size + memAllocLinkSize + memFooterSize;
 
 	MemFreeLink *free_p;
 	MemAllocLink *alloc_p = NULL;
-	void *address_p = NULL;
+	MemOwner *owner_p;
+	char *address_p = NULL;
+
+	schedLock();
+	owner_p = memAddOwner_p(pId);
+	if (owner_p == NULL) {
+		memStats.numFailed++;
+		schedUnlock();
+		MEM_RETURN(MEM_ALLOC_FAILED, NULL);
+	}
+
+	if (memOverQuota(owner_p, size)) {
+		if (owner_p->first_p == NULL) {
+			memRemoveOwner(owner_p);
+		}
+		memStats.numFailed++;
+		schedUnlock();
+		MEM_RETURN(MEM_QUOTA_EXCEEDED, NULL);
+	}
 
-	di();
 	free_p = memFindSufficientFree(requiredSize);
 	if (free_p == NULL) {
-		ei();
+		if (owner_p->first_p == NULL) {
+			memRemoveOwner(owner_p);
+		}
+		memStats.numFailed++;
+		schedUnlock();
 		MEM_RETURN(MEM_ALLOC_FAILED, NULL);
 	}
 
 	/* check if unused space is to small for future allocations */
 	unsigned leftSize = free_p->size - requiredSize;
 
-	if (leftSize <= memAllocLinkSize) {
+	if (leftSize <= (memAllocLinkSize + memFooterSize)) {
 		/* leftover space too small to be allocate later; add to space being reserved - to reduce fragmentation */
 		size += leftSize;
 		requiredSize += leftSize;
@@ -115,39 +222,31 @@ void *memAlloc(unsigned size, int pId) {
 
 	/* removed used free link */
 	memRemoveFreeLink(free_p);
-	ei();
 
 	/* insert new alloc link */
 	alloc_p = memInsertAllocLink_p(address_p, size);
 	if (alloc_p == NULL) {
+		memStats.numFailed++;
+		schedUnlock();
 		MEM_RETURN(MEM_ALLOC_FAILED, NULL);
 	}
 
-	if (pId == 0){
-		alloc_p->processID = pid();
-	}else if (pId == -1){
-		alloc_p->processID = NO_PID;
-	}else{
-		alloc_p->processID = pId;
+	alloc_p->processID = pId;
+	memLinkOwner(owner_p, alloc_p);
+
+	memCharge(owner_p, size);
+	if (memStats.usedBytes > memStats.peakUsedBytes) {
+		memStats.peakUsedBytes = memStats.usedBytes;
 	}
+	memStats.numAllocs++;
 
-	/* if unused space left, create new free link */
+	/* if unused space left, create new free link; the segment it was split from
+	 * was already merged with its neighbours, so there is nothing to merge with
+	 */
 	if (leftSize > 0) {
-		di();
-		char *newFree_p = (address_p + requiredSize);
-		char *endFree_p = newFree_p + leftSize;
-		MemFreeLink *adjPrior_p = NULL;
-		MemFreeLink *adjPost_p = NULL;
-
-		if ((alloc_p->next_p == NULL)
-				|| (endFree_p < (char *) alloc_p->next_p)) {
-			adjPost_p = (MemFreeLink *) endFree_p;
-		}
-
-		/* merge and insert new free link */
-		memMergeFree(newFree_p, leftSize, adjPrior_p, adjPost_p);
-		ei();
+		memInsertFreeLink_p(address_p + requiredSize, leftSize);
 	}
+	schedUnlock();
 
 	address_p += memAllocLinkSize;
 
@@ -173,58 +272,65 @@ MemErrno myFreeErrorCode(void *address_p, int pId) {
 	char *startAddress_p = (char*) address_p - memAllocLinkSize;
 	MemAllocLink *alloc_p = (MemAllocLink *) startAddress_p;
 
+	if (pId <= 0){
+		pId = pid();
+	}
+
+	schedLock();
 	if (!memMatchAlloc(alloc_p)) {
 		/* was not allocated */
+		schedUnlock();
 		return (MEM_NOT_ALLOCATED);
 	}
-	if (pId <= 0){
-		pId = pid();
-	}
 	if ((alloc_p->processID != NO_PID) && (alloc_p->processID != pId)){
+		schedUnlock();
 		return (MEM_NOT_OWNED);
 	}
 
-	unsigned size = alloc_p->size + memAllocLinkSize;
+	MEM_TRACE_EVENT(MEM_TRACE_FREE, alloc_p->processID, alloc_p->size, address_p, NULL);
+	memReleaseAlloc(alloc_p);
+	schedUnlock();
 
-	/* check if there adjacent free sections  */
-	char *endAlloc_p;
-	char *endFree_p;
+	return (MEM_NO_ERROR);
+}
 
+/* release a validated allocated segment; takes it off the list of its owner and
+ * merges it with any address adjacent free segments. to be called with the
+ * scheduler locked
+ */
+void memReleaseAlloc(MemAllocLink *alloc_p) {
+	char *startAddress_p = (char *) alloc_p;
+	unsigned size = alloc_p->size + memAllocLinkSize + memFooterSize;
+
+	/* check if there adjacent free sections; the footer of the prior segment
+	 * ends right before this header, the header of the next one starts right
+	 * after this footer
+	 */
 	MemFreeLink *adjPrior_p = NULL;
 	MemFreeLink *adjPost_p = NULL;
+	char *endAlloc_p = startAddress_p + size;
 
-	di();
-	if (alloc_p->prev_p == NULL) {
-		if (startAddress_p != mem_p) {
-			adjPrior_p = (MemFreeLink *) mem_p;
-		} else {
-			adjPrior_p = NULL;
-		}
-	} else {
-		endAlloc_p = ((char *) alloc_p->prev_p) + alloc_p->prev_p->size
-				+ memAllocLinkSize;
-		if (endAlloc_p < (char *) alloc_p) {
-			adjPrior_p = (MemFreeLink *) endAlloc_p;
-		} else {
-			adjPrior_p = NULL;
+	if (startAddress_p > mem_p) {
+		MemFooter *footer_p = (MemFooter *) (startAddress_p - memFooterSize);
+		if (footer_p->tag == MEM_TAG_FREE) {
+			adjPrior_p = (MemFreeLink *) (startAddress_p - footer_p->size);
 		}
 	}
 
-	endFree_p = startAddress_p + size;
-	if ((alloc_p->next_p == NULL) || (endFree_p < (char *) alloc_p->next_p)){
-		adjPost_p = (MemFreeLink *) endFree_p;
-	}else{
-		adjPost_p = NULL;
+	if ((endAlloc_p < memLastAddress_p)
+			&& (((MemFreeLink *) endAlloc_p)->tag == MEM_TAG_FREE)) {
+		adjPost_p = (MemFreeLink *) endAlloc_p;
 	}
 
+	memCharge(memFindOwner_p(alloc_p->processID), -alloc_p->size);
+	memStats.numFrees++;
+
 	/* remove alloc link */
+	memUnlinkOwner(alloc_p);
 	memRemoveAllocLink(alloc_p);
 
 	/* merge if necessary and insert new free link */
 	memMergeFree(startAddress_p, size, adjPrior_p, adjPost_p);
-	ei();
-
-	return (MEM_NO_ERROR);
 }
 
 /* frees up memory. simply calles myFreeErrorCode, but it won't pass the error status */
@@ -232,6 +338,239 @@ void myFree(void *address_p) {
 	myFreeErrorCode(address_p, 0);
 }
 
+/* hand an allocated section of memory owned by from over to to, without copying
+ * it: the owner pid in its header is rewritten, the segment moves to the list of
+ * its new owner, and the bytes are credited to the one and charged to the other.
+ * either may be NO_PID, the kernel. fails if from does not own the section, or
+ * it would take to over its quota
+ */
+MemErrno memGive(void *address_p, pid_t from, pid_t to) {
+	MemAllocLink *alloc_p;
+	MemOwner *owner_p;
+
+	if ((mem_p == NULL) || (address_p < (void *) (mem_p + memAllocLinkSize))
+			|| (address_p >= (void *) (memLastAddress_p - memAllocLinkSize))) {
+		return (MEM_NOT_ALLOCATED);
+	}
+	alloc_p = (MemAllocLink *) ((char *) address_p - memAllocLinkSize);
+
+	schedLock();
+	if (!memMatchAlloc(alloc_p)) {
+		schedUnlock();
+		return (MEM_NOT_ALLOCATED);
+	}
+	if (alloc_p->processID != from) {
+		schedUnlock();
+		return (MEM_NOT_OWNED);
+	}
+	if (from == to) {
+		schedUnlock();
+		return (MEM_NO_ERROR);
+	}
+
+	owner_p = memAddOwner_p(to);
+	if (owner_p == NULL) {
+		schedUnlock();
+		return (MEM_ALLOC_FAILED);
+	}
+	if (memOverQuota(owner_p, alloc_p->size)) {
+		if (owner_p->first_p == NULL) {
+			memRemoveOwner(owner_p);
+		}
+		schedUnlock();
+		return (MEM_QUOTA_EXCEEDED);
+	}
+
+	MEM_TRACE_EVENT(MEM_TRACE_GIVE, to, alloc_p->size, address_p, NULL);
+	memCharge(memFindOwner_p(from), -alloc_p->size);
+	memUnlinkOwner(alloc_p);
+	alloc_p->processID = to;
+	memLinkOwner(owner_p, alloc_p);
+	memCharge(owner_p, alloc_p->size);
+	schedUnlock();
+
+	return (MEM_NO_ERROR);
+}
+
+/* change the size of an allocated section of memory, keeping its content. the section
+ * is shrunk, or grown into the free segment following it, in place; only if that is not
+ * possible, a new section is allocated, the content copied, and the old section freed.
+ * a NULL address allocates, a size of 0 frees. returns the address of the section, or
+ * NULL if it could not be resized, in which case the old section is left as it was.
+ */
+void *myRealloc(void *address_p, unsigned size) {
+	if (address_p == NULL) {
+		return (memAlloc(size, 0));
+	}
+
+	if (size == 0) {
+		memErrno = myFreeErrorCode(address_p, 0);
+		return NULL;
+	}
+
+	if ((mem_p == NULL) || (address_p < (void *) (mem_p + memAllocLinkSize))
+			|| (address_p >= (void *) (memLastAddress_p - memAllocLinkSize))) {
+		MEM_RETURN(MEM_NOT_ALLOCATED, NULL);
+	}
+
+	if (size > (MEM_MAX_SIZE - memAllocLinkSize - memFooterSize)) {
+		MEM_RETURN(MEM_INV_SIZE, NULL);
+	}
+
+	MemAllocLink *alloc_p = (MemAllocLink *) ((char *) address_p - memAllocLinkSize);
+	char *newAddress_p;
+	unsigned oldSize;
+
+	size = memModDouble(size);
+
+	schedLock();
+	if (!memMatchAlloc(alloc_p)) {
+		schedUnlock();
+		MEM_RETURN(MEM_NOT_ALLOCATED, NULL);
+	}
+	if ((alloc_p->processID != NO_PID) && (alloc_p->processID != pid())) {
+		schedUnlock();
+		MEM_RETURN(MEM_NOT_OWNED, NULL);
+	}
+
+	/* only the growth is charged in place; a section that has to move is charged in
+	 * full until the old one is released, as both are held while the content is copied
+	 */
+	if ((size > alloc_p->size)
+			&& memOverQuota(memFindOwner_p(alloc_p->processID), size - alloc_p->size)) {
+		memStats.numFailed++;
+		schedUnlock();
+		MEM_RETURN(MEM_QUOTA_EXCEEDED, NULL);
+	}
+
+	memErrno = MEM_NO_ERROR;
+	if ((size <= alloc_p->size) || memGrowAlloc(alloc_p, size)) {
+		memShrinkAlloc(alloc_p, size);
+		if (memStats.usedBytes > memStats.peakUsedBytes) {
+			memStats.peakUsedBytes = memStats.usedBytes;
+		}
+		MEM_TRACE_EVENT(MEM_TRACE_REALLOC, alloc_p->processID, size, address_p, address_p);
+		schedUnlock();
+		return (address_p);
+	}
+
+	/* move; the old section is owned by the caller, so it stays put while
+	 * the content is copied with the scheduler unlocked
+	 */
+	newAddress_p = memAllocSegment_p(size, alloc_p->processID);
+	schedUnlock();
+	if (newAddress_p == NULL) {
+		return NULL;
+	}
+
+	oldSize = alloc_p->size;
+	memCopy(newAddress_p, (char *) address_p, oldSize);
+
+	schedLock();
+	MEM_TRACE_EVENT(MEM_TRACE_REALLOC,
+			((MemAllocLink *) (newAddress_p - memAllocLinkSize))->processID, size, newAddress_p, address_p);
+	memReleaseAlloc(alloc_p);
+	schedUnlock();
+
+	return (newAddress_p);
+}
+
+/* allocate memory for an array of nmemb elements of the given size, set to 0 */
+void *myCalloc(unsigned nmemb, unsigned size) {
+	if ((size != 0) && (nmemb > (UINT_MAX / size))) {
+		if (mem_p != NULL) {
+			memStats.numFailed++;
+		}
+		MEM_RETURN(MEM_INV_SIZE, NULL);
+	}
+
+	char *address_p = memAlloc(nmemb * size, 0);
+	if (address_p != NULL) {
+		memFill(address_p, 0, nmemb * size);
+	}
+
+	return (address_p);
+}
+
+/* allocate memory starting at an address that is a multiple of alignment, a power of
+ * two. a section large enough to hold the request at any alignment is taken, and the
+ * space in front of the aligned address and past the requested size is given back.
+ */
+void *myMemalign(unsigned alignment, unsigned size) {
+	if ((alignment == 0) || (alignment & (alignment - 1))) {
+		MEM_RETURN(MEM_INV_VAL, NULL);
+	}
+
+	if (alignment <= DWORD) {
+		/* every section is double-word aligned */
+		return (memAlloc(size, 0));
+	}
+
+	if (mem_p == NULL) {
+		memInit();
+	}
+
+	unsigned overhead = memAllocLinkSize + memFooterSize;
+
+	/* checked in this order, so none of the terms can wrap around */
+	if ((alignment > MEM_MAX_SIZE / 2) || (alignment > (MEM_MAX_SIZE - 2 * overhead))
+			|| (size > (MEM_MAX_SIZE - 2 * overhead - alignment))) {
+		memStats.numFailed++;
+		MEM_RETURN(MEM_INV_SIZE, NULL);
+	}
+
+	memErrno = MEM_NO_ERROR;
+	if (size == 0) {
+		return NULL;
+	}
+
+	size = memModDouble(size);
+	pid_t pId = pid();
+	char *address_p;
+	char *aligned_p;
+	MemAllocLink *alloc_p;
+
+	schedLock();
+	/* the space in front of the aligned address has to hold a free segment, so
+	 * it is either empty or larger than the overhead: up to alignment + overhead.
+	 * the quota of the process has to allow for that space as well
+	 */
+	address_p = memAllocSegment_p(size + alignment + overhead, pId);
+	if (address_p == NULL) {
+		schedUnlock();
+		return NULL;
+	}
+
+	aligned_p = address_p + ((alignment - (((UtlAddress_t) address_p) % alignment)) % alignment);
+	while ((aligned_p != address_p) && ((unsigned) (aligned_p - address_p) <= overhead)) {
+		aligned_p += alignment;
+	}
+
+	alloc_p = (MemAllocLink *) (address_p - memAllocLinkSize);
+	if (aligned_p != address_p) {
+		/* move the header up to the aligned address; the section was split off the
+		 * front of a free segment, which had been merged with its neighbours, so
+		 * the space given back has no free segment to merge with
+		 */
+		unsigned lead = aligned_p - address_p;
+		unsigned oldSize = alloc_p->size;
+
+		memUnlinkOwner(alloc_p);
+		memRemoveAllocLink(alloc_p);
+		memInsertFreeLink_p((char *) alloc_p, lead);
+
+		alloc_p = memInsertAllocLink_p(aligned_p - memAllocLinkSize, oldSize - lead);
+		alloc_p->processID = pId;
+		memLinkOwner(memFindOwner_p(pId), alloc_p);
+		memCountResize(alloc_p, oldSize);
+	}
+	memShrinkAlloc(alloc_p, size);
+	MEM_TRACE_EVENT(MEM_TRACE_ALLOC, pId, size, aligned_p, NULL);
+	schedUnlock();
+
+	return (aligned_p);
+}
+
 /* initialize utl global variables. ensures the double-word alignment
  * of the first possible address
  */
@@ -243,8 +582,15 @@ void memInit(void) {
 	mem_p = (char *) MEM_START;
 	memLastAddress_p = (char *) MEM_END;
 
-	memFreeListInit();
+	memset(&memStats, 0, sizeof(memStats));
+#ifdef MEM_TRACE
+	memTraceCount = 0;
+	memTraceOn = true;
+#endif /* MEM_TRACE */
+
 	memAllocListInit();
+	memFreeListInit();
+	memOwnerInit();
 
 }
 
@@ -259,129 +605,258 @@ unsigned memModDouble(unsigned size) {
 	return size;
 }
 
-/* initialize the linked list representing free space; initially there will be a single
+/* initialize the size class lists representing free space; initially there will be a single
  * link present that will represent all 128M bytes of free space.
  */
 void memFreeListInit(void) {
-	memFreeHeader.first_p = (MemFreeLink *) mem_p;
-	memFreeHeader.last_p = (MemFreeLink *) mem_p;
+	memset(&memFreeIndex, 0, sizeof(memFreeIndex));
 
 	/* set first free link */
-	MemFreeLink *free_p;
-	free_p = memFreeHeader.first_p;
-	free_p->size = MEM_MAX_SIZE;
-	free_p->prev_p = NULL;
-	free_p->next_p = NULL;
+	memInsertFreeLink_p(mem_p, MEM_MAX_SIZE);
 }
 
 /* alloc link structure will be stored in mod double-word bytes; the
  * requested size to be allocated will also be rounded up to mod
  * double-word to ensure that allocated space starts at mod double-word
- * address
+ * address. the header space is shared by the alloc and the free link,
+ * so it is sized for the larger of the two.
  */
 void memAllocListInit(void) {
-	memAllocHeader.first_p = NULL;
-	memAllocHeader.last_p = NULL;
-	memAllocLinkSize = memModDouble(sizeof(MemAllocLink));
+	unsigned linkSize = sizeof(MemAllocLink);
+	if (sizeof(MemFreeLink) > linkSize) {
+		linkSize = sizeof(MemFreeLink);
+	}
+	memAllocLinkSize = memModDouble(linkSize);
+	memFooterSize = memModDouble(sizeof(MemFooter));
 }
 
-/* find location to insert alloc link into a list sorted by address */
-MemAllocLink *memFindAllocPrev_p(MemAllocLink *alloc_p) {
-	if ((alloc_p) == NULL
-			|| (alloc_p
-					>= (MemAllocLink *) (memLastAddress_p - memAllocLinkSize))) {
+/* get the footer of the segment of a given size (header and footer included) */
+MemFooter *memFooter_p(char *address_p, unsigned size) {
+	return ((MemFooter *) (address_p + size - memFooterSize));
+}
+
+/* tag the footer of a segment, and record the size of the segment so
+ * that the segment following it can find its header
+ */
+void memSetFooter(char *address_p, unsigned size, unsigned tag) {
+	MemFooter *footer_p = memFooter_p(address_p, size);
+	footer_p->tag = tag;
+	footer_p->size = size;
+}
+
+/* initialize the table of owner records; all records are chained as free */
+void memOwnerInit(void) {
+	int i;
+	for (i = 0; i < MEM_OWNER_BUCKETS; i++) {
+		memOwnerBucket[i] = NULL;
+	}
+	for (i = 0; i < MEM_MAX_OWNERS; i++) {
+		memOwner[i].processID = NO_PID;
+		memOwner[i].first_p = NULL;
+		memOwner[i].bytes = 0;
+		memOwner[i].pcb_p = NULL;
+		memOwner[i].next_p = (i + 1 < MEM_MAX_OWNERS) ? &memOwner[i + 1] : NULL;
+	}
+	memFirstFreeOwner_p = memOwner;
+}
+
+/* find the owner record of a process; NULL if the process owns no memory */
+MemOwner *memFindOwner_p(pid_t pId) {
+	MemOwner *owner_p;
+
+	for (owner_p = memOwnerBucket[MEM_OWNER_HASH(pId)];
+			(owner_p != NULL) && (owner_p->processID != pId);
+			owner_p = owner_p->next_p) {
+		;
+	}
+	return owner_p;
+}
+
+/* find the owner record of a process, adding one if there is none yet;
+ * returns NULL if the table is full
+ */
+MemOwner *memAddOwner_p(pid_t pId) {
+	MemOwner *owner_p = memFindOwner_p(pId);
+
+	if ((owner_p == NULL) && (memFirstFreeOwner_p != NULL)) {
+		owner_p = memFirstFreeOwner_p;
+		memFirstFreeOwner_p = owner_p->next_p;
+
+		owner_p->processID = pId;
+		owner_p->first_p = NULL;
+		owner_p->bytes = 0;
+		owner_p->pcb_p = memOwnerPCB_p(pId);
+		owner_p->next_p = memOwnerBucket[MEM_OWNER_HASH(pId)];
+		memOwnerBucket[MEM_OWNER_HASH(pId)] = owner_p;
+	}
+	return owner_p;
+}
+
+/* find the PCB of a process, to be charged for its memory; the kernel (NO_PID) has none */
+ProcessControlBlock *memOwnerPCB_p(pid_t pId) {
+	if (pId == NO_PID) {
 		return NULL;
 	}
+	if (pId == pid()) {
+		return getCurrentPCB();
+	}
+	return ((shPcbLink_p != NULL) ? findPCB(pId) : NULL);
+}
+
+/* charge bytes to an owner and to its process; unsigned arithmetic wraps,
+ * so passing the negated number of bytes credits them
+ */
+void memCharge(MemOwner *owner_p, unsigned bytes) {
+	if (owner_p != NULL) {
+		owner_p->bytes += bytes;
+		if (owner_p->pcb_p != NULL) {
+			owner_p->pcb_p->memUsed += bytes;
+		}
+	}
+	memStats.usedBytes += bytes;
+}
+
+/* check if charging bytes more would take the owner over the quota of its process */
+bool memOverQuota(MemOwner *owner_p, unsigned bytes) {
+	if ((owner_p == NULL) || (owner_p->pcb_p == NULL)
+			|| (owner_p->pcb_p->memQuota == 0)) {
+		return false;
+	}
+	return ((owner_p->bytes > owner_p->pcb_p->memQuota)
+			|| (bytes > (owner_p->pcb_p->memQuota - owner_p->bytes)));
+}
 
-	MemAllocLink *prev_p;
-	for (prev_p = memAllocHeader.first_p;
-			(prev_p != NULL) && (prev_p < alloc_p); prev_p = prev_p->next_p) {
+/* take the owner record out of its bucket and put it back on the free chain */
+void memRemoveOwner(MemOwner *owner_p) {
+	MemOwner **link_pp = &memOwnerBucket[MEM_OWNER_HASH(owner_p->processID)];
+
+	for (; (*link_pp != NULL) && (*link_pp != owner_p); link_pp = &(*link_pp)->next_p) {
 		;
 	}
+	if (*link_pp != NULL) {
+		*link_pp = owner_p->next_p;
+	}
+
+	owner_p->processID = NO_PID;
+	owner_p->first_p = NULL;
+	owner_p->bytes = 0;
+	owner_p->pcb_p = NULL;
+	owner_p->next_p = memFirstFreeOwner_p;
+	memFirstFreeOwner_p = owner_p;
+}
 
-	if (prev_p == alloc_p) {
-		/* address was already allocated */
-		MEM_EXIT("memFindAllocPrev_p");
+/* add an allocated segment at the head of the list of its owner */
+void memLinkOwner(MemOwner *owner_p, MemAllocLink *alloc_p) {
+	alloc_p->prev_p = NULL;
+	alloc_p->next_p = owner_p->first_p;
+	if (alloc_p->next_p != NULL) {
+		alloc_p->next_p->prev_p = alloc_p;
 	}
+	owner_p->first_p = alloc_p;
+}
 
-	if (prev_p == NULL) {
-		return memAllocHeader.last_p;
+/* take an allocated segment off the list of its owner */
+void memUnlinkOwner(MemAllocLink *alloc_p) {
+	if (alloc_p->prev_p != NULL) {
+		alloc_p->prev_p->next_p = alloc_p->next_p;
 	} else {
-		return prev_p->prev_p;
+		/* first segment of the owner */
+		MemOwner *owner_p = memFindOwner_p(alloc_p->processID);
+		if (owner_p != NULL) {
+			owner_p->first_p = alloc_p->next_p;
+		}
+	}
+
+	if (alloc_p->next_p != NULL) {
+		alloc_p->next_p->prev_p = alloc_p->prev_p;
 	}
 }
 
-/* find alloc link entry on the list */
+/* check that the alloc link is the header of a live allocated segment:
+ * both header and footer have to be tagged as allocated and agree on the size
+ */
 bool memMatchAlloc(MemAllocLink *alloc_p) {
-	if ((alloc_p == NULL)
+	if ((alloc_p == NULL) || (alloc_p < (MemAllocLink *) mem_p)
 			|| (alloc_p
-					>= (MemAllocLink *) (memLastAddress_p - memAllocLinkSize))) {
+					>= (MemAllocLink *) (memLastAddress_p - memAllocLinkSize
+							- memFooterSize))
+			|| (((UtlAddress_t) alloc_p) % DWORD)) {
 		return false;
 	}
 
-	MemAllocLink *allocLink_p;
-
-	for (allocLink_p = memAllocHeader.first_p;
-			(allocLink_p != NULL) && (allocLink_p < alloc_p); allocLink_p =
-					allocLink_p->next_p)
-		;
+	if (alloc_p->tag != MEM_TAG_ALLOC) {
+		return false;
+	}
 
-	if (alloc_p != allocLink_p) {
+	unsigned maxSize = (memLastAddress_p - (char *) alloc_p);
+	if ((alloc_p->size % DWORD)
+			|| (alloc_p->size > (maxSize - memAllocLinkSize - memFooterSize))) {
 		return false;
-	} else {
-		return true;
 	}
 
+	unsigned size = alloc_p->size + memAllocLinkSize + memFooterSize;
+	MemFooter *footer_p = memFooter_p((char *) alloc_p, size);
+
+	return ((footer_p->tag == MEM_TAG_ALLOC) && (footer_p->size == size));
 }
 
-/* implements first fit algorithm to find space in memory that is big
- * enough for the desired allocation; fast and efficient approach, given
- * two separate free/alloc linked list for keeping track of memory usage.
+/* map the size of a free segment to its first and second level size class */
+void memMapSize(unsigned size, unsigned *fl_p, unsigned *sl_p) {
+	if (size < MEM_SMALL_SIZE) {
+		*fl_p = 0;
+		*sl_p = size / (MEM_SMALL_SIZE / MEM_SL_COUNT);
+	} else {
+		unsigned msb = MEM_MSB(size);
+		*fl_p = msb - MEM_FL_SHIFT + 1;
+		*sl_p = (size >> (msb - MEM_SL_LOG2)) - MEM_SL_COUNT;
+	}
+}
+
+/* implements good fit algorithm to find space in memory that is big enough for the
+ * desired allocation; the size is rounded up to the next size class, so the first
+ * segment of the smallest non-empty class at or above it always fits. only when
+ * no such class exists, the class the size itself maps to is searched, so that a
+ * request close to the largest free segment does not fail.
  */
 MemFreeLink *memFindSufficientFree(unsigned size) {
 	if ((size <= 0) || (size > MEM_MAX_SIZE)) {
 		return (NULL);
 	}
 
+	unsigned fl, sl;
+	unsigned roundSize = size;
+	uint32_t map;
 	MemFreeLink *free_p;
 
-	for (free_p = memFreeHeader.first_p;
-			(free_p != NULL) && (free_p->size < size); free_p =
-					free_p->next_p) {
-		;
-	}
-	return free_p;
-
-}
-
-/* find location for insertion of a 'free' link into a list sorted by
- * size, starting from a known position
- */
-MemFreeLink *memFindFreePrev_p(MemFreeLink *free_p, MemFreeLink *start_p) {
-	if ((free_p == NULL)
-			|| (free_p >= (MemFreeLink*) (memLastAddress_p - memAllocLinkSize))) {
-		return NULL;
+	if (size >= MEM_SMALL_SIZE) {
+		roundSize += (1 << (MEM_MSB(size) - MEM_SL_LOG2)) - 1;
 	}
+	memMapSize(roundSize, &fl, &sl);
 
-	MemFreeLink *prev_p;
-	for (prev_p = start_p; (prev_p != NULL) && (prev_p->size < free_p->size);
-			prev_p = prev_p->next_p) {
-		;
+	map = (fl < MEM_FL_COUNT) ? (memFreeIndex.slBitmap[fl] & (~0U << sl)) : 0;
+	if (map == 0) {
+		/* no segment in this first level class; look for next larger non-empty one */
+		map = ((fl + 1) < MEM_FL_COUNT) ? (memFreeIndex.flBitmap & (~0U << (fl + 1))) : 0;
+		if (map != 0) {
+			fl = MEM_LSB(map);
+			map = memFreeIndex.slBitmap[fl];
+		}
 	}
 
-	if (prev_p == free_p) {
-		/* address was already free - BUG */
-		MEM_EXIT("memFindFreePrev_p");
+	if (map != 0) {
+		return memFreeIndex.list_p[fl][MEM_LSB(map)];
 	}
 
-	if (prev_p == NULL) {
-		return memFreeHeader.last_p;
-	} else {
-		return prev_p->prev_p;
+	/* nothing in the rounded up classes; try the segments sharing the class of the exact size */
+	memMapSize(size, &fl, &sl);
+	for (free_p = memFreeIndex.list_p[fl][sl];
+			(free_p != NULL) && (free_p->size < size); free_p = free_p->next_p) {
+		;
 	}
+	return free_p;
 }
 
-/* find free link entry on the list */
+/* find free link entry on the list of its size class */
 bool memMatchFree_p(MemFreeLink *free_p) {
 
 	if ((free_p == NULL)
@@ -390,13 +865,11 @@ bool memMatchFree_p(MemFreeLink *free_p) {
 	}
 
 	MemFreeLink *freeLink_p;
+	unsigned fl, sl;
 	bool match = false;
 
-	if (free_p == NULL) {
-		return false;
-	}
-
-	for (freeLink_p = memFreeHeader.first_p; (freeLink_p != NULL) && !match;
+	memMapSize(free_p->size, &fl, &sl);
+	for (freeLink_p = memFreeIndex.list_p[fl][sl]; (freeLink_p != NULL) && !match;
 			freeLink_p = freeLink_p->next_p) {
 		if (freeLink_p == free_p) {
 			match = true;
@@ -407,9 +880,9 @@ bool memMatchFree_p(MemFreeLink *free_p) {
 
 }
 
-/* insert allocated link */
+/* insert allocated link; tags the header and the footer of the segment */
 MemAllocLink *memInsertAllocLink_p(char *address_p, unsigned size) {
-	if ((address_p < mem_p)
+	if ((mem_p == NULL) || (address_p == NULL) || (address_p < mem_p)
 			|| (address_p >= (memLastAddress_p - memAllocLinkSize))) {
 		MEM_RETURN(MEM_INV_ADDRESS, NULL);
 	}
@@ -420,50 +893,19 @@ MemAllocLink *memInsertAllocLink_p(char *address_p, unsigned size) {
 
 	memErrno = MEM_NO_ERROR;
 
-	/*  it is the first alloc link to be set */
-	if ((mem_p == NULL) && (address_p == NULL)) {
-		memInit();
-		address_p = mem_p;
-	} else if ((mem_p == NULL) || (address_p == NULL)) {
-		MEM_RETURN(MEM_INV_ADDRESS, NULL);
-	}
-
 	MemAllocLink *alloc_p;
 	alloc_p = (MemAllocLink *) address_p;
+	alloc_p->tag = MEM_TAG_ALLOC;
 	alloc_p->size = size;
-
-	/* find location to insert link in list of allocated spaces sorted by address  */
-	MemAllocLink *prev_p = memFindAllocPrev_p(alloc_p);
-
-	if (memAllocHeader.first_p == NULL) {
-		/* this is the only reserved mem */
-		alloc_p->prev_p = NULL;
-		alloc_p->next_p = NULL;
-		memAllocHeader.first_p = alloc_p;
-		memAllocHeader.last_p = alloc_p;
-	} else if (prev_p == NULL) {
-		/* this is new first reserved mem */
-		alloc_p->prev_p = NULL;
-		alloc_p->next_p = memAllocHeader.first_p;
-		memAllocHeader.first_p->prev_p = alloc_p;
-		memAllocHeader.first_p = alloc_p;
-	} else {
-		alloc_p->prev_p = prev_p;
-		alloc_p->next_p = prev_p->next_p;
-		prev_p->next_p = alloc_p;
-
-		if (alloc_p->next_p != NULL) {
-			alloc_p->next_p->prev_p = alloc_p;
-		} else {
-			/* this is new last free mem */
-			memAllocHeader.last_p = alloc_p;
-		}
-	}
+	memSetFooter(address_p, size + memAllocLinkSize + memFooterSize,
+			MEM_TAG_ALLOC);
 
 	return (alloc_p);
 }
 
-/* remove allocated link */
+/* remove allocated link; clears the tags, so that a stale pointer to the
+ * segment is not taken for a live one once the segment is merged away
+ */
 void memRemoveAllocLink(MemAllocLink *alloc_p) {
 	if (mem_p == NULL) {
 		MEM_VRETURN(MEM_NOT_INITIALIZED);
@@ -477,26 +919,13 @@ void memRemoveAllocLink(MemAllocLink *alloc_p) {
 
 	memErrno = MEM_NO_ERROR;
 
-	if (alloc_p->prev_p != NULL) {
-		alloc_p->prev_p->next_p = alloc_p->next_p;
-	} else {
-		/* the first alloc mem link on the list to be removed */
-		memAllocHeader.first_p = alloc_p->next_p;
-	}
-
-	if (alloc_p->next_p != NULL) {
-		alloc_p->next_p->prev_p = alloc_p->prev_p;
-	} else {
-		/* the last alloc mem link on the list to be removed */
-		memAllocHeader.last_p = alloc_p->prev_p;
-	}
+	memFooter_p((char *) alloc_p,
+			alloc_p->size + memAllocLinkSize + memFooterSize)->tag = MEM_TAG_NONE;
+	alloc_p->tag = MEM_TAG_NONE;
 }
 
-/* insert a free link into a list sorted by size; searches for appropriate
- * location from a starting position
- */
-MemFreeLink *memInsertFreeLink_p(char *address_p, unsigned size,
-		MemFreeLink *freeFirst_p) {
+/* insert a free link at the head of the list of its size class */
+MemFreeLink *memInsertFreeLink_p(char *address_p, unsigned size) {
 	if ((address_p == NULL) || (address_p < mem_p)
 			|| (address_p >= (memLastAddress_p - memAllocLinkSize)))
 		MEM_RETURN(MEM_INV_ADDRESS, NULL);
@@ -505,51 +934,28 @@ MemFreeLink *memInsertFreeLink_p(char *address_p, unsigned size,
 
 	memErrno = MEM_NO_ERROR;
 
-	/* this is the first free link to be set */
-	if (mem_p == NULL) {
-		memInit();
-		return (memFreeHeader.first_p);
-	}
-
 	MemFreeLink *free_p;
+	unsigned fl, sl;
 
 	free_p = (MemFreeLink *) address_p;
+	free_p->tag = MEM_TAG_FREE;
 	free_p->size = size;
+	memSetFooter(address_p, size, MEM_TAG_FREE);
+	memMapSize(size, &fl, &sl);
 
-	/* insert new link */
-	if (freeFirst_p == NULL) {
-		freeFirst_p = memFreeHeader.first_p;
-	}
-
-	/* find prev alloc link in sorted by address list of allocated spaces starting from freeFirst_p */
-	di();
-	MemFreeLink *prev_p = memFindFreePrev_p(free_p, freeFirst_p);
-
-	if (memFreeHeader.first_p == NULL) {
-		/* this is the only free mem */
-		free_p->prev_p = NULL;
-		free_p->next_p = NULL;
-		memFreeHeader.first_p = free_p;
-		memFreeHeader.last_p = free_p;
-	} else if (prev_p == NULL) {
-		/* this is new first free  mem */
-		free_p->prev_p = NULL;
-		free_p->next_p = memFreeHeader.first_p;
-		memFreeHeader.first_p->prev_p = free_p;
-		memFreeHeader.first_p = free_p;
-	} else {
-		free_p->prev_p = prev_p;
-		free_p->next_p = prev_p->next_p;
-		prev_p->next_p = free_p;
-
-		if (free_p->next_p != NULL) {
-			free_p->next_p->prev_p = free_p;
-		} else {
-			/* this is new last free mem */
-			memFreeHeader.last_p = free_p;
-		}
+	schedLock();
+	free_p->prev_p = NULL;
+	free_p->next_p = memFreeIndex.list_p[fl][sl];
+	if (free_p->next_p != NULL) {
+		free_p->next_p->prev_p = free_p;
 	}
-	ei();
+	memFreeIndex.list_p[fl][sl] = free_p;
+	memFreeIndex.flBitmap |= (1U << fl);
+	memFreeIndex.slBitmap[fl] |= (1U << sl);
+	memStats.freeBytes += size;
+	memStats.numFree++;
+	memStats.freeHist[fl]++;
+	schedUnlock();
 
 	return (free_p);
 }
@@ -565,20 +971,30 @@ void memRemoveFreeLink(MemFreeLink *free_p) {
 		MEM_VRETURN(MEM_INV_ADDRESS);
 	}
 
+	unsigned fl, sl;
+	memMapSize(free_p->size, &fl, &sl);
+
 	if (free_p->prev_p != NULL) {
 		free_p->prev_p->next_p = free_p->next_p;
 	} else {
-		/* the first free mem link on the list to be removed */
-		memFreeHeader.first_p = free_p->next_p;
+		/* the first free mem link of the size class to be removed */
+		memFreeIndex.list_p[fl][sl] = free_p->next_p;
+		if (free_p->next_p == NULL) {
+			/* size class is now empty */
+			memFreeIndex.slBitmap[fl] &= ~(1U << sl);
+			if (memFreeIndex.slBitmap[fl] == 0) {
+				memFreeIndex.flBitmap &= ~(1U << fl);
+			}
+		}
 	}
 
 	if (free_p->next_p != NULL) {
 		free_p->next_p->prev_p = free_p->prev_p;
-	} else {
-		/* the last free mem link on the list to be removed */
-		memFreeHeader.last_p = free_p->prev_p;
 	}
 
+	memStats.freeBytes -= free_p->size;
+	memStats.numFree--;
+	memStats.freeHist[fl]--;
 }
 
 /* check for adjacent free links in memory. If any are found, merge them
@@ -591,12 +1007,9 @@ void memMergeFree(char *address_p, unsigned size, MemFreeLink *adjPrior_p,
 		MEM_VRETURN(MEM_INV_ADDRESS);
 	}
 
-	MemFreeLink *freePrev_p = NULL;
-
 	if (adjPrior_p != NULL) {
 		address_p = (char *) adjPrior_p;
 		size += adjPrior_p->size;
-		freePrev_p = adjPrior_p->prev_p;
 
 		/* remove adjacent link after merge */
 		memRemoveFreeLink(adjPrior_p);
@@ -605,20 +1018,142 @@ void memMergeFree(char *address_p, unsigned size, MemFreeLink *adjPrior_p,
 	if ((adjPost_p != NULL)
 			&& (adjPost_p != (MemFreeLink *) memLastAddress_p)) {
 		size += adjPost_p->size;
-		if ((freePrev_p == NULL) || (freePrev_p->size < adjPost_p->size)) {
-			freePrev_p = adjPost_p->prev_p;
-		}
 
 		/* remove adjacent link after merge */
 		memRemoveFreeLink(adjPost_p);
+		adjPost_p->tag = MEM_TAG_NONE;
+	}
+
+	memInsertFreeLink_p(address_p, size);
+}
+
+/* account for an allocated segment that changed size from oldSize bytes; the peak
+ * is left to the caller, since a segment may grow by more than it keeps
+ */
+void memCountResize(MemAllocLink *alloc_p, unsigned oldSize) {
+	/* unsigned arithmetic wraps, so this also subtracts when the segment shrank */
+	memCharge(memFindOwner_p(alloc_p->processID), alloc_p->size - oldSize);
+}
+
+/* shrink an allocated segment to size bytes (mod double); the space past it is given back
+ * as a free segment, merged with the one following it if that is free. as in memAlloc, if
+ * the space is too small to be allocated later, it stays with the segment.
+ */
+void memShrinkAlloc(MemAllocLink *alloc_p, unsigned size) {
+	unsigned oldSize = alloc_p->size;
+	unsigned overhead = memAllocLinkSize + memFooterSize;
+
+	if ((size >= oldSize) || ((oldSize - size) <= overhead)) {
+		return;
+	}
+
+	char *tail_p = (char *) alloc_p + size + overhead;
+	char *end_p = (char *) alloc_p + oldSize + overhead;
+	MemFreeLink *adjPost_p = NULL;
+
+	if ((end_p < memLastAddress_p) && (((MemFreeLink *) end_p)->tag == MEM_TAG_FREE)) {
+		adjPost_p = (MemFreeLink *) end_p;
 	}
 
-	memInsertFreeLink_p(address_p, size, freePrev_p);
+	/* the old footer is at the end of the space given back, so it gets
+	 * overwritten by the footer of the free segment
+	 */
+	alloc_p->size = size;
+	memSetFooter((char *) alloc_p, size + overhead, MEM_TAG_ALLOC);
+	memMergeFree(tail_p, oldSize - size, NULL, adjPost_p);
+	memCountResize(alloc_p, oldSize);
+}
+
+/* grow an allocated segment to at least size bytes by taking in the free segment following
+ * it; the segment may end up larger than size. returns false if there is no such free
+ * segment, or if it is too small.
+ */
+bool memGrowAlloc(MemAllocLink *alloc_p, unsigned size) {
+	unsigned oldSize = alloc_p->size;
+	MemFreeLink *post_p = (MemFreeLink *) ((char *) alloc_p + oldSize
+			+ memAllocLinkSize + memFooterSize);
+
+	if ((post_p >= (MemFreeLink *) memLastAddress_p) || (post_p->tag != MEM_TAG_FREE)
+			|| ((oldSize + post_p->size) < size)) {
+		return false;
+	}
+
+	alloc_p->size += post_p->size;
+	memRemoveFreeLink(post_p);
+	post_p->tag = MEM_TAG_NONE;
+	memSetFooter((char *) alloc_p, alloc_p->size + memAllocLinkSize + memFooterSize,
+			MEM_TAG_ALLOC);
+	memCountResize(alloc_p, oldSize);
+
+	return true;
+}
+
+/* free all segments of an owner in one go; the segments are first all
+ * tagged as released, then every run of address-adjacent released or free
+ * segments is merged into a single free segment, so no segment is inserted
+ * into the free lists only to be merged away by the next one. each released
+ * segment is taken off the owner list as soon as it joins a run, before its
+ * header can be reused for the free link.
+ */
+void memBulkFree(MemOwner *owner_p) {
+	MemAllocLink *alloc_p;
+	char *start_p;
+	char *end_p;
+	unsigned size;
+
+	for (alloc_p = owner_p->first_p; alloc_p != NULL; alloc_p = alloc_p->next_p) {
+		size = alloc_p->size + memAllocLinkSize + memFooterSize;
+		alloc_p->tag = MEM_TAG_RELEASED;
+		memFooter_p((char *) alloc_p, size)->tag = MEM_TAG_RELEASED;
+		memStats.numFrees++;
+	}
+	memCharge(owner_p, -owner_p->bytes);
+
+	while ((alloc_p = owner_p->first_p) != NULL) {
+		start_p = (char *) alloc_p;
+		end_p = start_p;
+
+		/* extend the run towards lower addresses */
+		while (start_p > mem_p) {
+			MemFooter *footer_p = (MemFooter *) (start_p - memFooterSize);
+			MemAllocLink *prior_p = (MemAllocLink *) (start_p - footer_p->size);
+			if (footer_p->tag == MEM_TAG_FREE) {
+				memRemoveFreeLink((MemFreeLink *) prior_p);
+			} else if (footer_p->tag == MEM_TAG_RELEASED) {
+				memUnlinkOwner(prior_p);
+			} else {
+				break;
+			}
+			footer_p->tag = MEM_TAG_NONE;
+			prior_p->tag = MEM_TAG_NONE;
+			start_p = (char *) prior_p;
+		}
+
+		/* extend the run towards higher addresses, starting with the segment itself */
+		while (end_p < memLastAddress_p) {
+			MemAllocLink *next_p = (MemAllocLink *) end_p;
+			if (next_p->tag == MEM_TAG_FREE) {
+				size = ((MemFreeLink *) next_p)->size;
+				memRemoveFreeLink((MemFreeLink *) next_p);
+			} else if (next_p->tag == MEM_TAG_RELEASED) {
+				size = next_p->size + memAllocLinkSize + memFooterSize;
+				memUnlinkOwner(next_p);
+			} else {
+				break;
+			}
+			next_p->tag = MEM_TAG_NONE;
+			memFooter_p(end_p, size)->tag = MEM_TAG_NONE;
+			end_p += size;
+		}
+
+		memInsertFreeLink_p(start_p, end_p - start_p);
+	}
 }
 
 /* allocated address = header information + space allocated for the calling
  * process to use; the address returned to the calling process is offset
- * from the beginning of the allocated space * by the size of the 'allocated link'
+ * from the beginning of the allocated space * by the size of the 'allocated link'.
+ * the map is produced by walking the heap from one segment header to the next.
  */
 void memoryMap(void) {
 	if (mem_p == NULL) {
@@ -627,9 +1162,8 @@ void memoryMap(void) {
 
 	char *address_p = mem_p;
 	MemFreeLink *free_p;
-	MemAllocLink *alloc_p = memAllocHeader.first_p;
+	MemAllocLink *alloc_p;
 
-	char *endAddress_p;
 	SVCprintStr(
 			"\r\n_____________________________________________________________\r\n");
 	SVCprintStr(
@@ -638,25 +1172,29 @@ void memoryMap(void) {
 			"_________|__________|_______________________|________________\r\n\n");
 	while ((address_p != NULL) && (address_p < memLastAddress_p)) {
 		char str[shMAX_BUFFERSIZE + 1];
-		if (alloc_p != (MemAllocLink *) address_p) {
+		free_p = (MemFreeLink *) address_p;
+		alloc_p = (MemAllocLink *) address_p;
+		if (free_p->tag == MEM_TAG_FREE) {
 			/* this address is not allocated */
-			free_p = (MemFreeLink *) address_p;
-			endAddress_p = address_p + free_p->size;
 			snprintf(str, shMAX_BUFFERSIZE,
 					"         |   Y      |   %p       | %u\r\n", address_p,
 					free_p->size);
 
-			address_p = endAddress_p++;
+			address_p += free_p->size;
 
-		} else {
-			unsigned size = alloc_p->size + memAllocLinkSize;
-			endAddress_p = address_p + size;
+		} else if (memMatchAlloc(alloc_p)) {
+			unsigned size = alloc_p->size + memAllocLinkSize + memFooterSize;
 			snprintf(str, shMAX_BUFFERSIZE,
 					" %d       |   N      |   %p       | %u\r\n",
 					alloc_p->processID, address_p, alloc_p->size);
 
-			address_p = endAddress_p++;
-			alloc_p = alloc_p->next_p;
+			address_p += size;
+		} else {
+			/* tags were overwritten; cannot find the next segment */
+			snprintf(str, shMAX_BUFFERSIZE,
+					"         |   ?      |   %p       | corrupted\r\n",
+					address_p);
+			address_p = NULL;
 		}
 		SVCprintStr(str);
 	}
@@ -694,9 +1232,7 @@ MemErrno memSet(void *address_p, int val, unsigned nbytes, bool checkPID) {
 	}
 
 	/* set the value */
-	for (; nbytes > 0; nbytes--, address_p++) {
-		*((char *) address_p) = (char) val;
-	}
+	memFill((char *) address_p, (uint8_t) val, nbytes);
 
 	return (MEM_NO_ERROR);
 }
@@ -730,10 +1266,8 @@ MemErrno myMemchk(void *address_p, int val, unsigned nbytes) {
 	}
 
 	/* check to see if the value in question is stored */
-	for (; nbytes > 0; nbytes--, address_p++) {
-		if (*((char *) address_p) != (char) val) {
-			return (MEM_INV_VAL);
-		}
+	if (!memCheckFill((char *) address_p, (uint8_t) val, nbytes)) {
+		return (MEM_INV_VAL);
 	}
 
 	return (MEM_NO_ERROR);
@@ -765,17 +1299,151 @@ MemErrno myMemcpy(void *dst_p, const void *src_p, unsigned nbytes) {
 		return (MEM_NOT_ALLOCATED);
 	}
 
-	int i = 0;
+	memCopy((char *) dst_p, (const char *) src_p, nbytes);
+
+	return (MEM_NO_ERROR);
+}
+
+/* the following kernels move data a word at a time once the destination is
+ * word aligned; on the Cortex-M4 the bulk of it is moved with load/store
+ * multiple bursts of 4 words, elsewhere with a loop unrolled by 4 words.
+ * r7 is left out of the register lists, since gcc uses it as frame pointer.
+ */
+
+/* fill nbytes starting at dst_p with a byte value */
+void memFill(char *dst_p, uint8_t val, unsigned nbytes) {
+	uint32_t word = val * 0x01010101U;
+
+	for (; (nbytes > 0) && (((UtlAddress_t) dst_p) % WORD); nbytes--) {
+		*dst_p++ = (char) val;
+	}
+
+	uint32_t *word_p = (uint32_t *) dst_p;
+	unsigned bursts = nbytes / (4 * WORD);
+	nbytes %= (4 * WORD);
 
-	for (i = 0; i < nbytes; i++){
-		*((char *) dst_p++) = *((char *) src_p++);
+#if defined(__arm__)
+	if (bursts > 0) {
+		__asm volatile("mov r4, %[word]" "\n"
+				"mov r5, %[word]" "\n"
+				"mov r6, %[word]" "\n"
+				"mov r8, %[word]" "\n"
+				"1:" "\n"
+				"stmia %[dst]!, {r4, r5, r6, r8}" "\n"
+				"subs %[n], %[n], #1" "\n"
+				"bne 1b"
+				: [dst] "+r" (word_p), [n] "+r" (bursts)
+				: [word] "r" (word)
+				: "r4", "r5", "r6", "r8", "cc", "memory");
+	}
+#else
+	for (; bursts > 0; bursts--, word_p += 4) {
+		word_p[0] = word;
+		word_p[1] = word;
+		word_p[2] = word;
+		word_p[3] = word;
 	}
+#endif
 
-	return (MEM_NO_ERROR);
+	for (; nbytes >= WORD; nbytes -= WORD) {
+		*word_p++ = word;
+	}
+
+	dst_p = (char *) word_p;
+	for (; nbytes > 0; nbytes--) {
+		*dst_p++ = (char) val;
+	}
 }
 
-/* check if address is within allocated memory segment; if so, returns the number of bytes
- * allocated starting from the given address
+/* check that all nbytes starting at src_p hold a byte value */
+bool memCheckFill(const char *src_p, uint8_t val, unsigned nbytes) {
+	uint32_t word = val * 0x01010101U;
+
+	for (; (nbytes > 0) && (((UtlAddress_t) src_p) % WORD); nbytes--) {
+		if (*src_p++ != (char) val) {
+			return false;
+		}
+	}
+
+	const uint32_t *word_p = (const uint32_t *) src_p;
+
+	for (; nbytes >= (4 * WORD); nbytes -= (4 * WORD), word_p += 4) {
+		if ((word_p[0] != word) || (word_p[1] != word) || (word_p[2] != word)
+				|| (word_p[3] != word)) {
+			return false;
+		}
+	}
+
+	for (; nbytes >= WORD; nbytes -= WORD) {
+		if (*word_p++ != word) {
+			return false;
+		}
+	}
+
+	src_p = (const char *) word_p;
+	for (; nbytes > 0; nbytes--) {
+		if (*src_p++ != (char) val) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* copy nbytes from src_p to dst_p; words are only used when source and
+ * destination can be word aligned together, otherwise bytes are copied
+ */
+void memCopy(char *dst_p, const char *src_p, unsigned nbytes) {
+	if ((((UtlAddress_t) dst_p) ^ ((UtlAddress_t) src_p)) % WORD) {
+		for (; nbytes > 0; nbytes--) {
+			*dst_p++ = *src_p++;
+		}
+		return;
+	}
+
+	for (; (nbytes > 0) && (((UtlAddress_t) dst_p) % WORD); nbytes--) {
+		*dst_p++ = *src_p++;
+	}
+
+	uint32_t *dstWord_p = (uint32_t *) dst_p;
+	const uint32_t *srcWord_p = (const uint32_t *) src_p;
+	unsigned bursts = nbytes / (4 * WORD);
+	nbytes %= (4 * WORD);
+
+#if defined(__arm__)
+	if (bursts > 0) {
+		__asm volatile("1:" "\n"
+				"ldmia %[src]!, {r4, r5, r6, r8}" "\n"
+				"stmia %[dst]!, {r4, r5, r6, r8}" "\n"
+				"subs %[n], %[n], #1" "\n"
+				"bne 1b"
+				: [dst] "+r" (dstWord_p), [src] "+r" (srcWord_p), [n] "+r" (bursts)
+				:
+				: "r4", "r5", "r6", "r8", "cc", "memory");
+	}
+#else
+	for (; bursts > 0; bursts--, dstWord_p += 4, srcWord_p += 4) {
+		dstWord_p[0] = srcWord_p[0];
+		dstWord_p[1] = srcWord_p[1];
+		dstWord_p[2] = srcWord_p[2];
+		dstWord_p[3] = srcWord_p[3];
+	}
+#endif
+
+	for (; nbytes >= WORD; nbytes -= WORD) {
+		*dstWord_p++ = *srcWord_p++;
+	}
+
+	dst_p = (char *) dstWord_p;
+	src_p = (const char *) srcWord_p;
+	for (; nbytes > 0; nbytes--) {
+		*dst_p++ = *src_p++;
+	}
+}
+
+/* check if address is the start of a memory segment allocated by the current process;
+ * if so, returns the number of bytes allocated. only the header in front of the address
+ * is checked, through its boundary tags (constant time); an address inside a segment,
+ * or anywhere else, is rejected without walking the heap
  */
 unsigned int memCheckAddress(void *address_p) {
 	/* check that destination address is not out of bounds of memory */
@@ -785,30 +1453,12 @@ unsigned int memCheckAddress(void *address_p) {
 		return (0);
 	}
 
-	MemAllocLink *allocLink_p;
-	bool found = false;
-	unsigned int nbytesLeft = 0;
-	void *startAddress_p;
-
-	/* since alloc links are sorted by address, no need to search past link with greater starting address */
-	for (allocLink_p = memAllocHeader.first_p;
-			(allocLink_p != NULL)
-					&& (address_p
-							>= (startAddress_p =
-									(void *) (((void *) allocLink_p)
-											+ memAllocLinkSize))) && !found;
-			allocLink_p = allocLink_p->next_p) {
-		if (address_p < (startAddress_p + allocLink_p->size)) {
-			found = true;
-			if (allocLink_p->processID != pid()){
-				nbytesLeft = 0;
-			}else{
-				nbytesLeft = (allocLink_p->size - (address_p - startAddress_p));
-			}
-		}
-	}
+	MemAllocLink *allocLink_p = (MemAllocLink *) ((char *) address_p - memAllocLinkSize);
 
-	return nbytesLeft;
+	if (!memMatchAlloc(allocLink_p) || (allocLink_p->processID != pid())) {
+		return (0);
+	}
+	return (allocLink_p->size);
 }
 
 /* this function frees space that was allocated with the specified pid */
@@ -817,20 +1467,130 @@ void memExit(pid_t pId) {
 		return;
 	}
 
-	MemAllocLink *alloc_p = memAllocHeader.first_p;
-
 	if (pId == NO_PID){
 		pId = pid();
 	}
 
-	di();
-	while (alloc_p != NULL) {
-		MemAllocLink *next_p = alloc_p->next_p;
-		if (alloc_p->processID == pId) {
-			myFreeErrorCode((void *) (((void *) alloc_p) + memAllocLinkSize),
-					pId);
+	schedLock();
+	MEM_TRACE_EVENT(MEM_TRACE_EXIT, pId, 0, NULL, NULL);
+	MemOwner *owner_p = memFindOwner_p(pId);
+	if (owner_p != NULL) {
+		memBulkFree(owner_p);
+		memRemoveOwner(owner_p);
+	}
+	schedUnlock();
+}
+
+/* take a snapshot of the allocator statistics; the largest free segment is
+ * in the highest non-empty size class, so only that class is searched
+ */
+MemErrno memGetStats(MemStats *stats_p) {
+	if (stats_p == NULL) {
+		return (MEM_INV_ADDRESS);
+	}
+
+	if (mem_p == NULL) {
+		memInit();
+	}
+
+	unsigned fl, sl, i;
+	MemFreeLink *free_p;
+	MemOwner *owner_p;
+
+	schedLock();
+	*stats_p = memStats;
+
+	stats_p->largestFree = 0;
+	if (memFreeIndex.flBitmap != 0) {
+		fl = MEM_MSB(memFreeIndex.flBitmap);
+		sl = MEM_MSB(memFreeIndex.slBitmap[fl]);
+		for (free_p = memFreeIndex.list_p[fl][sl]; free_p != NULL;
+				free_p = free_p->next_p) {
+			if (free_p->size > stats_p->largestFree) {
+				stats_p->largestFree = free_p->size;
+			}
+		}
+	}
+
+	stats_p->numOwners = 0;
+	for (i = 0; i < MEM_OWNER_BUCKETS; i++) {
+		for (owner_p = memOwnerBucket[i]; owner_p != NULL; owner_p = owner_p->next_p) {
+			stats_p->owner[stats_p->numOwners].processID = owner_p->processID;
+			stats_p->owner[stats_p->numOwners].bytes = owner_p->bytes;
+			stats_p->numOwners++;
+		}
+	}
+	schedUnlock();
+
+	return (MEM_NO_ERROR);
+}
+
+/* record an event in the trace ring buffer, overwriting the oldest record once it is full */
+void memTraceEvent(MemTraceEvent event, pid_t pId, unsigned size,
+		void *address_p, void *previous_p, void *caller_p) {
+#ifdef MEM_TRACE
+	MemTraceRecord *record_p;
+
+	schedLock();
+	if (memTraceOn) {
+		record_p = &memTrace_p[memTraceCount % MEM_TRACE_RECORDS];
+		record_p->time = flexTimerGetClockLow();
+		record_p->event = event;
+		record_p->processID = pId;
+		record_p->size = size;
+		record_p->address_p = address_p;
+		record_p->previous_p = previous_p;
+		record_p->caller_p = caller_p;
+		memTraceCount++;
+	}
+	schedUnlock();
+#endif /* MEM_TRACE */
+}
+
+/* print the records in the trace ring buffer, oldest first, one per line:
+ *   @<event> <time> <pid> <size> <address> <caller> [<previous address>]
+ * recording is paused while printing, so the dump is a consistent window of
+ * the trace; events in the meantime are not recorded.
+ */
+void memTraceDump(void) {
+#ifdef MEM_TRACE
+	char str[shMAX_BUFFERSIZE + 1];
+	MemTraceRecord *record_p;
+	unsigned i, first;
+
+	if (mem_p == NULL) {
+		memInit();
+	}
+
+	schedLock();
+	memTraceOn = false;
+	schedUnlock();
+
+	first = (memTraceCount > MEM_TRACE_RECORDS) ? (memTraceCount - MEM_TRACE_RECORDS) : 0;
+	snprintf(str, shMAX_BUFFERSIZE, "memtrace: %u records, %u overwritten\r\n",
+			memTraceCount - first, first);
+	SVCprintStr(str);
+
+	for (i = first; i < memTraceCount; i++) {
+		record_p = &memTrace_p[i % MEM_TRACE_RECORDS];
+		if (record_p->event == MEM_TRACE_REALLOC) {
+			snprintf(str, shMAX_BUFFERSIZE, "@%c %u %d %u %p %p %p\r\n",
+					(char) record_p->event, (unsigned) record_p->time,
+					record_p->processID, record_p->size, record_p->address_p,
+					record_p->caller_p, record_p->previous_p);
+		} else {
+			snprintf(str, shMAX_BUFFERSIZE, "@%c %u %d %u %p %p\r\n",
+					(char) record_p->event, (unsigned) record_p->time,
+					record_p->processID, record_p->size, record_p->address_p,
+					record_p->caller_p);
 		}
-		alloc_p = next_p;
+		SVCprintStr(str);
 	}
-	ei();
+
+	schedLock();
+	memTraceOn = true;
+	schedUnlock();
+#else
+	SVCprintStr("memtrace: tracing not enabled; build with MEM_TRACE defined\r\n");
+#endif /* MEM_TRACE */
 }
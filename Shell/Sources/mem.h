@@ -15,17 +15,61 @@
 #include "shell.h"
 #include "sdram.h"
 #include "lcdc.h"
+#include "pcb.h"
 
 /* constants */
 #define WORD 4
 #define DWORD (WORD*2)
 #define KBYTE 1024
 #define MBYTE (KBYTE*KBYTE)
+
+/* allocation tracing; build with MEM_TRACE defined (-DMEM_TRACE) to record every allocation,
+ * release, hand over and process exit in a ring buffer taken from the top of SDRAM
+ */
+#ifdef MEM_TRACE
+#define MEM_TRACE_RECORDS 8192
+#define MEM_TRACE_SIZE (MEM_TRACE_RECORDS * sizeof(MemTraceRecord))
+#else
+#define MEM_TRACE_SIZE 0
+#endif /* MEM_TRACE */
+
 #define MEM_START (SDRAM_START + LCDC_FRAME_BUFFER_SIZE + LCDC_GW_BUFFER_SIZE)
-#define MEM_MAX_SIZE (SDRAM_SIZE-(LCDC_FRAME_BUFFER_SIZE+LCDC_GW_BUFFER_SIZE))
-#define MEM_END (SDRAM_END+1) /*program treats last address as non working so pushing it to the next*/
+#define MEM_MAX_SIZE (SDRAM_SIZE-(LCDC_FRAME_BUFFER_SIZE+LCDC_GW_BUFFER_SIZE)-MEM_TRACE_SIZE)
+#define MEM_END (SDRAM_END+1-MEM_TRACE_SIZE) /*program treats last address as non working so pushing it to the next*/
+#define MEM_TRACE_START MEM_END
+
+/* free segments are kept in segregated size classes: a first level class per power of two,
+ * split linearly into MEM_SL_COUNT second level classes; sizes below MEM_SMALL_SIZE all
+ * fall into first level class 0, in DWORD steps
+ */
+#define MEM_SL_LOG2 3
+#define MEM_SL_COUNT (1 << MEM_SL_LOG2)
+#define MEM_FL_SHIFT (MEM_SL_LOG2 + 3) /* 3 = log2(DWORD) */
+#define MEM_SMALL_SIZE (1 << MEM_FL_SHIFT)
+#define MEM_FL_COUNT (32 - MEM_FL_SHIFT + 1)
+
+/* boundary tags marking the state of a segment in its header and footer */
+#define MEM_TAG_NONE  0
+#define MEM_TAG_ALLOC 0x4D454D41 /* "MEMA" */
+#define MEM_TAG_FREE  0x4D454D46 /* "MEMF" */
+#define MEM_TAG_RELEASED 0x4D454D52 /* "MEMR" - pending bulk free */
+
+/* table of owner records, hashed by pid: one for each PCB slot, one for the
+ * system (NO_PID), and a spare
+ */
+#define MEM_MAX_OWNERS (PCB_MAX_PROCESSES + 2)
+#define MEM_OWNER_BUCKETS 16
+#define MEM_OWNER_HASH(P) (((unsigned) (P)) % MEM_OWNER_BUCKETS)
 
 /* enums */
+typedef enum{
+	MEM_TRACE_ALLOC = 'A',
+	MEM_TRACE_FREE = 'F',
+	MEM_TRACE_REALLOC = 'R',
+	MEM_TRACE_GIVE = 'G',
+	MEM_TRACE_EXIT = 'X'
+} MemTraceEvent;
+
 typedef enum{
 	MEM_NO_ERROR = 0,
 	MEM_NOT_ALLOCATED,
@@ -38,6 +82,7 @@ typedef enum{
 	MEM_BASE_ERROR ,
 	MEM_ALLOC_FAILED,
 	MEM_DEALLOC_FAILED,
+	MEM_QUOTA_EXCEEDED,
 	MEM_FATAL_ERROR,
 	MEM_UNRECOGNIZED_ERROR
 } MemErrno;
@@ -45,27 +90,81 @@ typedef enum{
 /* type definitions */
 
 typedef struct memFreeLink_s{
+	unsigned tag;
 	unsigned size;
 	struct memFreeLink_s *prev_p;
 	struct memFreeLink_s *next_p;
 } MemFreeLink ;
 
 typedef struct{
-	MemFreeLink *first_p;
-	MemFreeLink *last_p;
-} MemFreeHeader ;
+	uint32_t flBitmap;                   /* bit set for each first level class with a non empty list */
+	uint32_t slBitmap[MEM_FL_COUNT];     /* bit set for each non empty second level class */
+	MemFreeLink *list_p[MEM_FL_COUNT][MEM_SL_COUNT];
+} MemFreeIndex ;
 
 typedef struct memAllocLink_s{
+	unsigned tag;
 	pid_t processID ;
 	unsigned size;
-	struct memAllocLink_s *prev_p;
+	struct memAllocLink_s *prev_p; /* list of segments owned by the same process */
 	struct memAllocLink_s *next_p;
 } MemAllocLink ;
 
-typedef struct {
+/* owner record; heads the list of segments allocated by a process. the PCB is looked up
+ * once, when the record is added, so that charging the quota of the process is O(1)
+ */
+typedef struct memOwner_s{
+	pid_t processID;
 	MemAllocLink *first_p;
-	MemAllocLink *last_p;
-} MemAllocHeader ;
+	unsigned bytes;            /* bytes allocated to the process, headers not included */
+	ProcessControlBlock *pcb_p; /* holds the quota; NULL for memory not owned by a process */
+	struct memOwner_s *next_p; /* next record in the hash bucket, or on the free chain */
+} MemOwner ;
+
+/* closes every segment; size is that of the whole segment, header and footer included */
+typedef struct{
+	unsigned tag;
+	unsigned size;
+} MemFooter ;
+
+/* trace record; size and address are those requested and returned by the allocation
+ * (address NULL if it failed), or those of the segment released; a reallocation also
+ * records the address it moved from. caller is the address the allocator was called from.
+ * the number of records is even, so the ring buffer keeps the heap below it aligned
+ */
+typedef struct{
+	uint32_t time;        /* ms since start up */
+	MemTraceEvent event;
+	pid_t processID;
+	unsigned size;
+	void *address_p;
+	void *previous_p;     /* MEM_TRACE_REALLOC only */
+	void *caller_p;
+} MemTraceRecord ;
+
+/* bytes in use by a single process */
+typedef struct{
+	pid_t processID;
+	unsigned bytes;
+} MemOwnerStats ;
+
+/* allocator statistics; the counters are kept up to date by every allocation
+ * and release, so taking a snapshot does not walk the heap. free sizes are
+ * those of whole segments, used sizes those handed out to the processes
+ */
+typedef struct{
+	unsigned freeBytes;
+	unsigned usedBytes;
+	unsigned peakUsedBytes;
+	unsigned largestFree;
+	unsigned numFree;                /* number of free segments */
+	unsigned freeHist[MEM_FL_COUNT]; /* number of free segments per first level size class */
+	unsigned numAllocs;
+	unsigned numFrees;
+	unsigned numFailed;              /* allocations that could not be served */
+	unsigned numOwners;
+	MemOwnerStats owner[MEM_MAX_OWNERS];
+} MemStats ;
 
 /* global variable declarations */
 #ifndef ALLOCATE_
@@ -84,6 +183,7 @@ const char *strErrno[] = {"%s:: error num: %d - successful execution\r\n",
 						  "%s:: error num: %d - erro encoutered\r\n",
 						  "%s:: error num: %d - memory allocation failed\r\n",
 						  "%s:: error num: %d - memory deallocation failed\r\n",
+						  "%s:: error num: %d - memory quota of the process exceeded\r\n",
 						  "%s:: error num: %d - fatal error encountered\r\n",
 						  "%s:: error num: %d - unrecognized error\r\n"};
 
@@ -95,14 +195,23 @@ EXTERN_ MemErrno memErrno;
 void memInit(void);
 void *myMalloc (unsigned int size);
 void myFree (void *address_p);
+void *myRealloc(void *address_p, unsigned size);
+void *myCalloc(unsigned nmemb, unsigned size);
+void *myMemalign(unsigned alignment, unsigned size);
 MemErrno myFreeErrorCode (void *address_p, int pId);
+MemErrno memGive(void *address_p, pid_t from, pid_t to);
+unsigned int memCheckAddress(void *address_p);
 void memoryMap(void);
 MemErrno myMemset (void *address_p, int val, unsigned nbytes);
 MemErrno myMemchk (void *address_p, int val, unsigned nbytes);
 MemErrno myMemcpy(void *dst_p, const void *src_p, unsigned nbytes);
 void memExit(pid_t pid);
+MemErrno memGetStats(MemStats *stats_p);
+void memTraceDump(void);
 
 /* macros */
+#define MEM_MSB(X) (31 - __builtin_clz(X))
+#define MEM_LSB(X) (__builtin_ctz(X))
 #define MEM_ERRNO {if ((memErrno < MEM_NO_ERROR) || (memErrno > MEM_FATAL_ERROR)) memErrno = MEM_FATAL_ERROR;}
 #define MEM_PRINT_SYS_ERROR(F) {SVCprintStr(F); SVCprintStr("::"); SVCprintStr(strerror(errno)); SVCprintStr("\r\n");}
 #define MEM_PRINT_ERROR(F) {char str[shMAX_BUFFERSIZE+1]; snprintf(str, shMAX_BUFFERSIZE,strErrno[memErrno], F, memErrno); SVCprintStr(str);}
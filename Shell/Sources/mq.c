@@ -0,0 +1,310 @@
+/* mq.c contains the message queues processes pass data through: bounded
+ * queues of messages, used through supervisor calls.
+ *
+ * a queue is taken from a pool and named by a handle, as the sync objects are;
+ * its messages are held in a ring of fixed size slots allocated to the kernel.
+ * a sender waits on the wait queue of the senders while the ring is full, a
+ * receiver on that of the receivers while it is empty, for as long as it takes
+ * or, on a timed receive, until its time runs out (wheelSleepOn). every message
+ * put or taken wakes one process on the other side.
+ *
+ * the bytes of a message are copied into the ring and out of it again. a queue
+ * created zero-copy passes memory sections instead: the sender hands over a
+ * section it allocated, the receiver gets its address, and only the owner in
+ * the header of the section is changed (memGive), so the bytes are never copied.
+ * while in the ring, the section is held by the kernel; it no longer goes away
+ * with the sender, and it is released if the queue is destroyed before it is
+ * received.
+ *
+ * when a process is cleaned up, the queues it created are destroyed.
+ *
+ * all the functions are called in the SVC handler, and work with the
+ * scheduler locked.
+ *
+ * Primary functions:
+ *		mqCreate(): create a message queue
+ *		mqDestroy(): destroy it, failing the sends and receives waiting on it
+ *		mqSend(): put a message in a queue, waiting for room
+ *		mqReceive(): take a message out of a queue, waiting for one
+ *		mqExit(): clean up after a process
+ */
+
+/* sys include files */
+#include <stdlib.h>
+#include <string.h>
+
+/* project headers */
+#include "mq.h"
+#include "pcb.h"
+#include "pool.h"
+#include "mem.h"
+#include "wheel.h"
+#include "shell.h"
+#include "utl.h"
+
+extern void *memAlloc(unsigned size, int pId);
+
+Pool mqPool;
+MqQueue *mqTable_p[MQ_MAX_QUEUES];
+int mqTableGen[MQ_MAX_QUEUES];
+int mqNextFree[MQ_MAX_QUEUES];
+int mqFirstFree = 0;
+
+/* internal function declarations - to be used by the message queues only */
+MqQueue *mqFind_p(int handle);
+void mqDestroyQueue(MqQueue *queue_p);
+int mqPut(MqQueue *queue_p, void *msg_p, unsigned size);
+int mqGet(MqQueue *queue_p, void *msg_p, unsigned size);
+
+/* function definitions */
+
+/* create the pool of queues and the handle table; must be called before the
+ * first queue is created. returns -1 if fails
+ */
+int mqInit(void) {
+	int i;
+
+	if (poolCreate(&mqPool, sizeof(MqQueue), MQ_POOL_CHUNK) == -1) {
+		return -1;
+	}
+	for (i = 0; i < MQ_MAX_QUEUES; i++) {
+		mqTable_p[i] = NULL;
+		mqTableGen[i] = 0;
+		mqNextFree[i] = i + 1;
+	}
+	mqFirstFree = 0;
+	return 0;
+}
+
+/* create a queue of capacity messages of up to msgSize bytes; msgSize is not
+ * used by a zero-copy queue (MQ_ZERO_COPY in flags). returns the handle of the
+ * queue, or -1 if fails
+ */
+int mqCreate(unsigned capacity, unsigned msgSize, int flags) {
+	MqQueue *queue_p;
+	int slot;
+
+	if ((capacity == 0) || (capacity > MQ_MAX_CAPACITY) || (flags & ~MQ_ZERO_COPY)) {
+		return -1;
+	}
+	if (flags & MQ_ZERO_COPY) {
+		msgSize = sizeof(void *);
+	} else if ((msgSize == 0) || (msgSize > MQ_MAX_MSG_SIZE)) {
+		return -1;
+	}
+
+	queue_p = poolGet(&mqPool);
+	if (queue_p == NULL) {
+		return -1;
+	}
+	queue_p->flags = flags;
+	queue_p->capacity = capacity;
+	queue_p->msgSize = msgSize;
+	/* the size, then the message, rounded up to keep the slots word aligned */
+	queue_p->slotSize = sizeof(unsigned) + ((msgSize + WORD - 1) & ~(WORD - 1));
+	queue_p->count = 0;
+	queue_p->head = 0;
+	queue_p->ring_p = memAlloc(capacity * queue_p->slotSize, -1);
+	if (queue_p->ring_p == NULL) {
+		poolPut(&mqPool, queue_p);
+		return -1;
+	}
+	pcbWaitQueueInit(&queue_p->senders);
+	pcbWaitQueueInit(&queue_p->receivers);
+
+	schedLock();
+	slot = mqFirstFree;
+	if (slot >= MQ_MAX_QUEUES) {
+		schedUnlock();
+		myFreeErrorCode(queue_p->ring_p, 0);
+		poolPut(&mqPool, queue_p);
+		return -1;
+	}
+	mqFirstFree = mqNextFree[slot];
+
+	queue_p->handle = (mqTableGen[slot] << MQ_SLOT_BITS) | slot;
+	queue_p->owner = pid();
+	mqTable_p[slot] = queue_p;
+	schedUnlock();
+
+	return queue_p->handle;
+}
+
+/* destroy a queue, and the messages left in it; the processes waiting on it
+ * are woken, and their sends and receives fail. returns -1 if there is no
+ * such queue
+ */
+int mqDestroy(int handle) {
+	MqQueue *queue_p;
+
+	schedLock();
+	queue_p = mqFind_p(handle);
+	if (queue_p == NULL) {
+		schedUnlock();
+		return -1;
+	}
+	mqDestroyQueue(queue_p);
+	schedUnlock();
+	return 0;
+}
+
+/* put a message of size bytes in a queue, waiting for room if it is full. on
+ * a zero-copy queue, msg_p is a memory section allocated by the caller, which
+ * is handed over; size is that of the message it holds. returns 0, or -1 if
+ * there is no such queue, it is destroyed meanwhile, the message is too large
+ * (on a zero-copy queue, larger than the section), or the caller does not own
+ * the section
+ */
+int mqSend(int handle, void *msg_p, unsigned size) {
+	MqQueue *queue_p;
+	int success = -1;
+
+	schedLock();
+	while ((queue_p = mqFind_p(handle)) != NULL) {
+		if (!(queue_p->flags & MQ_ZERO_COPY) && (size > queue_p->msgSize)) {
+			break;
+		}
+		if (queue_p->count < queue_p->capacity) {
+			success = mqPut(queue_p, msg_p, size);
+			break;
+		}
+		pcbSleepOn(&queue_p->senders);
+	}
+	schedUnlock();
+	return success;
+}
+
+/* take the oldest message out of a queue into the size bytes at msg_p, waiting
+ * for one for up to ms milliseconds, MQ_WAIT_FOREVER for as long as it takes,
+ * or not at all if ms is 0. on a zero-copy queue, the address of the memory
+ * section holding the message is stored at msg_p, and the section is handed
+ * over to the caller, who frees it. returns the size of the message, or -1 if
+ * there is no such queue, it is destroyed meanwhile, the time runs out, or the
+ * message does not fit (it is then left in the queue)
+ */
+int mqReceive(int handle, void *msg_p, unsigned size, uint32_t ms) {
+	MqQueue *queue_p;
+	int success = -1;
+
+	schedLock();
+	while ((queue_p = mqFind_p(handle)) != NULL) {
+		if (queue_p->count > 0) {
+			success = mqGet(queue_p, msg_p, size);
+			break;
+		}
+		/* woken for another reason, or beaten to the message, the caller waits again */
+		if (ms == MQ_WAIT_FOREVER) {
+			pcbSleepOn(&queue_p->receivers);
+		} else if (wheelSleepOn(&queue_p->receivers, &ms) == -1) {
+			break;
+		}
+	}
+	schedUnlock();
+	return success;
+}
+
+/* clean up after a process: the queues it created are destroyed */
+void mqExit(ProcessControlBlock *pcb_p) {
+	int i;
+
+	schedLock();
+	for (i = 0; i < MQ_MAX_QUEUES; i++) {
+		if ((mqTable_p[i] != NULL) && (mqTable_p[i]->owner == pcb_p->processID)) {
+			mqDestroyQueue(mqTable_p[i]);
+		}
+	}
+	schedUnlock();
+}
+
+/* the queue of a handle */
+MqQueue *mqFind_p(int handle) {
+	MqQueue *queue_p;
+
+	if (handle < 0) {
+		return NULL;
+	}
+	queue_p = mqTable_p[handle & (MQ_MAX_QUEUES - 1)];
+	if ((queue_p == NULL) || (queue_p->handle != handle)) {
+		return NULL;
+	}
+	return queue_p;
+}
+
+/* free the entry of a queue, release the sections of the messages left in a
+ * zero-copy queue and the ring, and give the queue back to the pool; the
+ * waiters find the handle no longer valid as they are woken
+ */
+void mqDestroyQueue(MqQueue *queue_p) {
+	int slot = queue_p->handle & (MQ_MAX_QUEUES - 1);
+	char *slot_p;
+
+	mqTable_p[slot] = NULL;
+	mqTableGen[slot] = (mqTableGen[slot] + 1) & MQ_GEN_MASK;
+	mqNextFree[slot] = mqFirstFree;
+	mqFirstFree = slot;
+
+	if (queue_p->flags & MQ_ZERO_COPY) {
+		for (; queue_p->count > 0; queue_p->count--) {
+			slot_p = queue_p->ring_p + (queue_p->head * queue_p->slotSize);
+			myFreeErrorCode(*(void **) (slot_p + sizeof(unsigned)), 0);
+			queue_p->head = (queue_p->head + 1) % queue_p->capacity;
+		}
+	}
+	myFreeErrorCode(queue_p->ring_p, 0);
+
+	pcbWakeAll(&queue_p->senders);
+	pcbWakeAll(&queue_p->receivers);
+	poolPut(&mqPool, queue_p);
+}
+
+/* put a message in the slot after the last one, and wake a receiver; the
+ * queue is not full. returns -1 if the section of a zero-copy message cannot
+ * be handed over, or is smaller than the size given, which the receiver
+ * would read past its end
+ */
+int mqPut(MqQueue *queue_p, void *msg_p, unsigned size) {
+	char *slot_p = queue_p->ring_p
+			+ (((queue_p->head + queue_p->count) % queue_p->capacity) * queue_p->slotSize);
+
+	if (queue_p->flags & MQ_ZERO_COPY) {
+		/* the bytes allocated to the section, 0 if the caller does not own it */
+		if ((size > memCheckAddress(msg_p))
+				|| (memGive(msg_p, pid(), NO_PID) != MEM_NO_ERROR)) {
+			return -1;
+		}
+		*(void **) (slot_p + sizeof(unsigned)) = msg_p;
+	} else {
+		memcpy(slot_p + sizeof(unsigned), msg_p, size);
+	}
+	*(unsigned *) slot_p = size;
+	queue_p->count++;
+
+	pcbWakeOne(&queue_p->receivers);
+	return 0;
+}
+
+/* take the message in the first slot, and wake a sender; the queue is not
+ * empty. returns the size of the message, or -1 if it is left in the queue
+ */
+int mqGet(MqQueue *queue_p, void *msg_p, unsigned size) {
+	char *slot_p = queue_p->ring_p + (queue_p->head * queue_p->slotSize);
+	unsigned msgSize = *(unsigned *) slot_p;
+
+	if (queue_p->flags & MQ_ZERO_COPY) {
+		void *section_p = *(void **) (slot_p + sizeof(unsigned));
+		if ((size < sizeof(void *)) || (memGive(section_p, NO_PID, pid()) != MEM_NO_ERROR)) {
+			return -1;
+		}
+		*(void **) msg_p = section_p;
+	} else {
+		if (msgSize > size) {
+			return -1;
+		}
+		memcpy(msg_p, slot_p + sizeof(unsigned), msgSize);
+	}
+	queue_p->head = (queue_p->head + 1) % queue_p->capacity;
+	queue_p->count--;
+
+	pcbWakeOne(&queue_p->senders);
+	return msgSize;
+}
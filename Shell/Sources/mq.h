@@ -0,0 +1,58 @@
+#ifndef MQ_
+#define MQ_
+
+/* systtem headers */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local headers */
+#include "pcb.h"
+
+/* constants */
+
+/* a handle is the index of the queue in the handle table, with the generation
+ * of the entry in the bits above, as for the sync objects
+ */
+#define MQ_SLOT_BITS 6
+#define MQ_MAX_QUEUES (1 << MQ_SLOT_BITS)
+#define MQ_GEN_MASK ((1 << (31 - MQ_SLOT_BITS)) - 1)
+#define MQ_POOL_CHUNK 4 /* queues reserved at once when the pool grows */
+#define MQ_MAX_CAPACITY 1024 /* messages a queue holds */
+#define MQ_MAX_MSG_SIZE 4096 /* bytes of a message copied in and out */
+
+/* flags of a queue */
+#define MQ_ZERO_COPY 0x1 /* messages are memory sections handed over, not copied */
+
+#define MQ_WAIT_FOREVER 0xFFFFFFFF /* time limit of a receive that waits as long as it takes */
+
+/* type definitions */
+
+/* bounded queue of messages, held in a ring of slots; a slot is the size of the
+ * message followed by its bytes or, for a zero-copy queue, by the address of the
+ * memory section that holds it. senders wait while the ring is full, receivers
+ * while it is empty
+ */
+typedef struct MqQueue_s {
+	int handle;
+	pid_t owner;          /* process that created it; destroyed when it is cleaned up */
+	int flags;
+	unsigned capacity;    /* slots in the ring */
+	unsigned msgSize;     /* largest message copied; the address of a section if zero-copy */
+	unsigned slotSize;
+	unsigned count;       /* messages in the ring */
+	unsigned head;        /* slot of the oldest message */
+	char *ring_p;
+	PcbWaitQueue senders;
+	PcbWaitQueue receivers;
+} MqQueue;
+
+/* function declarations */
+int mqInit(void);
+int mqCreate(unsigned capacity, unsigned msgSize, int flags);
+int mqDestroy(int handle);
+int mqSend(int handle, void *msg_p, unsigned size);
+int mqReceive(int handle, void *msg_p, unsigned size, uint32_t ms);
+void mqExit(ProcessControlBlock *pcb_p);
+
+#endif /* MQ_ */
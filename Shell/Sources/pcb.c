@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
 
 /* project headers  */
 #include "utl.h"
@@ -22,22 +23,83 @@
 #include "svc.h"
 #include "usr.h"
 #include "fioutl.h"
+#include "sync.h"
+#include "mq.h"
+#include "wheel.h"
+#include "systick.h"
 
 extern void *memAlloc(unsigned size, int pId);
 
 bool pcbInitialized = false;
 ProcessControlBlock *PCB_p = NULL;
-int nextPID = 1;
+Pool pcbLinkPool;   /* PcbLink entries */
+Pool pcbStreamPool; /* per process stream tables */
 
-void end(void);
+/* ready queues, one FIFO per priority; bit (31 - priority) of the map is set while
+ * the queue of that priority is not empty, so the highest priority with a ready
+ * process is the number of leading zeros of the map. the queues and the list of
+ * killed processes are only changed with the scheduler locked, or by the scheduler
+ */
+PcbLink *pcbReadyHead_p[PCB_PRIORITIES];
+PcbLink *pcbReadyTail_p[PCB_PRIORITIES];
+uint32_t pcbReadyMap = 0;
 
-/* returns the next available pid and updates */
-int getNextPID(void){
-	di();
-	int i = nextPID;
-	nextPID++;
-	ei();
-	return i;
+/* killed processes (zombies) are cleaned up by the reaper process, not by the
+ * scheduler, so that a switch does not take longer the more streams and memory
+ * the process held. the reaper sleeps on its queue while there are none
+ */
+PcbLink *pcbKilled_p = NULL;
+PcbWaitQueue pcbReaperQueue = {NULL, NULL};
+
+/* the idle process waits for an interrupt while no other process is ready; it
+ * is on no ready queue, and is picked by the scheduler when they are all empty
+ */
+PcbLink *pcbIdle_p = NULL;
+
+#define PCB_READY_BIT(P) (0x80000000U >> (P))
+
+/* processor time; the DWT cycle counter wraps every 35 seconds, so it is
+ * extended to 64 bits at every switch, which comes at least once a quantum
+ */
+uint64_t pcbCycles = 0;     /* cycles up to the last switch */
+uint32_t pcbLastCycles = 0; /* DWT count at the last switch */
+
+/* slot table, indexed by the low bits of the pid; the bits above are the
+ * generation of the slot, advanced every time the slot is given up, so that
+ * the pid of a process that has ended does not find the next user of its slot.
+ * free slots are chained through pcbNextFreeSlot. the shell takes slot 0 of
+ * generation 0, so its pid is 0, and keeps it
+ */
+PcbLink *pcbSlot_p[PCB_MAX_PROCESSES];
+pid_t pcbSlotGen[PCB_MAX_PROCESSES];
+int pcbNextFreeSlot[PCB_MAX_PROCESSES];
+int pcbFirstFreeSlot = 0;
+
+void end(int status);
+void pcbUnqueue(PcbLink *link_p);
+void pcbWaitQueueRemove(PcbLink *link_p);
+void pcbWaitQueueAppend(PcbLink *link_p, PcbWaitQueue *queue_p);
+int pcbStackUsed(ProcessControlBlock *pcb_p);
+
+/* create the pools for PCB links and stream tables; must be called
+ * before the first pcb link is added
+ * returns -1 if fails
+ */
+int pcbPoolInit(void) {
+	if ((poolCreate(&pcbLinkPool, sizeof(PcbLink), PCB_POOL_CHUNK) == -1)
+			|| (poolCreate(&pcbStreamPool, sizeof(Stream) * PCB_STREAMS_MIN,
+					PCB_POOL_CHUNK) == -1)) {
+		return -1;
+	}
+
+	int i;
+	for (i = 0; i < PCB_MAX_PROCESSES; i++) {
+		pcbSlot_p[i] = NULL;
+		pcbSlotGen[i] = 0;
+		pcbNextFreeSlot[i] = i + 1;
+	}
+	pcbFirstFreeSlot = 0;
+	return 0;
 }
 /* get PID */
 int pid(void) {
@@ -57,25 +119,41 @@ FioErrno pcbInit(ProcessControlBlock *pcb_p, int pId) {
 		PCB_p->processID = pid();
 	}
 
-	/* init preset streams */
-	PCB_p->stream = (Stream *) memAlloc(sizeof(Stream) * FIO_MAX_STREAMS, PCB_p->processID);
+	/* init preset streams; the table starts small, and grows as files are opened */
+	PCB_p->numStreams = 0;
+	PCB_p->stream = (Stream *) poolGet(&pcbStreamPool);
 	if (!PCB_p->stream) {
 		return FIO_INIT_FAILED;
 	}
+	PCB_p->numStreams = PCB_STREAMS_MIN;
 
 	PCB_p->currentDirInode = -1;
 
 	/* init stream table */
 	uint8_t j;
-	for (j = 0; j < FIO_MAX_STREAMS; j++) {
+	for (j = 0; j < PCB_STREAMS_MIN; j++) {
 		PCB_p->stream[j].device_p = NULL;
 		PCB_p->stream[j].nextFreeIdx = j + 1;
 	}
+	PCB_p->stream[PCB_STREAMS_MIN - 1].nextFreeIdx = FIO_MAX_STREAMS;
 
 	/* no stream entries are created for directories, unless openDir is called */
 	/* since LAST_RESERVED_TYPE is ROOT, we can use that entry for reg files */
 	PCB_p->firstFreeStream = LAST_RESERVED_TYPE + 1;
 
+	if (pcbInitialized) {
+		/* the root dir, the dirs of the hw devices and the std files were
+		 * created by the first process; their reserved streams only need
+		 * to be mapped
+		 */
+		pcbMapStream(PCB_p, ROOT_DIR, RAM, "/", "r+");
+		PCB_p->currentDirInode = ROOT_DIR;
+		pcbMapStream(PCB_p, STDIN, STD, "STDIN", "a");
+		pcbMapStream(PCB_p, STDOUT, STD, "STDOUT", "a");
+		pcbMapStream(PCB_p, STDERR, STD, "STDERR", "a");
+		return FIO_NO_ERROR;
+	}
+
 	/* create streams for reserved devices/files */
 
 	myFILE fi;
@@ -117,8 +195,81 @@ FioErrno pcbInit(ProcessControlBlock *pcb_p, int pId) {
 
 }
 
-/* get the index of the first free stream */
+/* sets up the reserved stream fi of a process for the file it is reserved
+ * for, which already exists: the root dir or a std file. the stream holds a
+ * reference to the inode, as an opened one does, since it is closed when the
+ * process exits
+ */
+void pcbMapStream(ProcessControlBlock *pcb_p, myFILE fi, DevType type, char *id_p, char *mode_p) {
+	Stream *stream_p = &pcb_p->stream[fi];
+
+	stream_p->device_p = &fioDevice[type];
+	utlStrNCpy(stream_p->id, id_p, FIO_MAX_FILE_NAME);
+	utlStrCpy(stream_p->mode, mode_p);
+	stream_p->position.currBlock_p = (type == RAM) ? INODE(fi).firstBlock_p : NULL;
+	stream_p->position.offset = 0;
+	stream_p->inodeIdx = (unsigned short) fi; /* note: inodeIdx = fi */
+	if (type == STD) {
+		stream_p->nextFreeIdx = FIO_MAX_FILES; /* marks it open, as stdOpen does */
+	}
+	INODE(fi).accessCount++;
+}
+
+/* number of entries in the stream table of the current process; an index
+ * into it must be below
+ */
+int pcbNumStreams(void) {
+	return (PCB_p != NULL) ? PCB_p->numStreams : 0;
+}
+
+/* doubles the stream table of a process, up to FIO_MAX_STREAMS entries: the
+ * entries are moved to a new table, and the new ones are put on the free list.
+ * to be called once the free list is empty. returns -1 if fails
+ */
+int pcbGrowStreams(ProcessControlBlock *pcb_p) {
+	unsigned numStreams = 2 * pcb_p->numStreams;
+
+	if (pcb_p->numStreams == FIO_MAX_STREAMS) {
+		return -1;
+	}
+	if (numStreams > FIO_MAX_STREAMS) {
+		numStreams = FIO_MAX_STREAMS;
+	}
+
+	/* charged to the process, as the files it opens are */
+	Stream *stream_p = memAlloc(sizeof(Stream) * numStreams, (int) pcb_p->processID);
+	if (stream_p == NULL) {
+		return -1;
+	}
+	memcpy(stream_p, pcb_p->stream, sizeof(Stream) * pcb_p->numStreams);
+
+	unsigned j;
+	for (j = pcb_p->numStreams; j < numStreams; j++) {
+		stream_p[j].device_p = NULL;
+		stream_p[j].nextFreeIdx = j + 1;
+	}
+	stream_p[numStreams - 1].nextFreeIdx = FIO_MAX_STREAMS;
+
+	/* the first table came from the pool, the others from the heap */
+	if (pcb_p->numStreams == PCB_STREAMS_MIN) {
+		poolPut(&pcbStreamPool, pcb_p->stream);
+	} else {
+		myFreeErrorCode(pcb_p->stream, (int) pcb_p->processID);
+	}
+	pcb_p->firstFreeStream = pcb_p->numStreams;
+	pcb_p->stream = stream_p;
+	pcb_p->numStreams = numStreams;
+	return 0;
+}
+
+/* get the index of the first free stream; once there is none, the stream
+ * table grows
+ */
 uint8_t pcbGetFreeStreamIdx(void) {
+	if (PCB_p->firstFreeStream >= FIO_MAX_STREAMS) {
+		pcbGrowStreams(PCB_p);
+	}
+
 	uint8_t streamIdx = PCB_p->firstFreeStream;
 
 	if (PCB_p->firstFreeStream < FIO_MAX_STREAMS) {
@@ -130,7 +281,7 @@ uint8_t pcbGetFreeStreamIdx(void) {
 
 /* new free stream is set to be the first free stream */
 void pcbReleaseStreamIdx(uint8_t streamIdx) {
-	if (streamIdx < FIO_MAX_STREAMS){
+	if (streamIdx < PCB_p->numStreams){
 		/* check for valid index */
 		PCB_p->stream[streamIdx].device_p = NULL;
 		PCB_p->stream[streamIdx].id[0] = '\0';
@@ -150,21 +301,50 @@ void setCurrentPCB(ProcessControlBlock *pcb_p){
 	PCB_p = pcb_p;
 }
 
-/* adds a link to a circular list */
-PcbLink *pcbAdd(pid_t pid, ProcessState state, UtlAddress_t sp, int size,
+/* adds a link to a circular list; the process gets the pid of a free slot.
+ * returns NULL if there is no free slot or no memory for the link
+ */
+PcbLink *pcbAdd(ProcessState state, UtlAddress_t sp, int size,
 		PcbLink *first_p) {
 
-	PcbLink *pcbLink_p = memAlloc(sizeof(PcbLink), (int) pid);
+	PcbLink *pcbLink_p = poolGet(&pcbLinkPool);
 	if (!pcbLink_p){
 		return NULL;
 	}
+
+	schedLock();
+	int slot = pcbFirstFreeSlot;
+	if (slot >= PCB_MAX_PROCESSES) {
+		schedUnlock();
+		poolPut(&pcbLinkPool, pcbLink_p);
+		return NULL;
+	}
+	pcbFirstFreeSlot = pcbNextFreeSlot[slot];
+	pcbSlot_p[slot] = pcbLink_p;
+	schedUnlock();
+
 	/* set PCB structure */
 
-	pcbLink_p->pcb.processID = pid;
+	pcbLink_p->pcb.processID = (pcbSlotGen[slot] << PCB_SLOT_BITS) | slot;
 	pcbLink_p->pcb.state = state;
 	pcbLink_p->pcb.sp = sp;
 	pcbLink_p->pcb.stackSize = size;
 	pcbLink_p->pcb.cpuTime = 0;
+	pcbLink_p->pcb.cpuStart = pcbCycleCount();
+	pcbLink_p->pcb.priority = PCB_DEFAULT_PRIORITY;
+	pcbLink_p->pcb.basePriority = PCB_DEFAULT_PRIORITY;
+	pcbLink_p->pcb.quantum = PROCESS_QUANTUM;
+	pcbLink_p->pcb.held_p = NULL;
+	pcbLink_p->pcb.blockedOn_p = NULL;
+	pcbLink_p->queuePrev_p = pcbLink_p->queueNext_p = NULL;
+	pcbLink_p->waitQueue_p = NULL;
+	pcbLink_p->timeoutPrev_p = pcbLink_p->timeoutNext_p = NULL;
+	pcbLink_p->pcb.timedOut = false;
+	pcbWaitQueueInit(&pcbLink_p->pcb.exitQueue);
+	pcbLink_p->pcb.exitStatus = PCB_EXIT_KILLED;
+	pcbLink_p->pcb.waitDone = false;
+	pcbLink_p->pcb.memQuota = 0;
+	pcbLink_p->pcb.memUsed = 0;
 
 	if (first_p) {
 		di();
@@ -182,14 +362,32 @@ PcbLink *pcbAdd(pid_t pid, ProcessState state, UtlAddress_t sp, int size,
 	return pcbLink_p;
 }
 
-/* remove a link from a circular list */
+/* remove a link from a circular list; its slot is kept until pcbReleaseSlot */
 void pcbRemove(PcbLink *pcbLink_p) {
 	if (!pcbLink_p){
 		return;
 	}
 
+	/* the list is walked by pcbGetInfo */
+	schedLock();
 	pcbLink_p->prev_p->next_p = pcbLink_p->next_p;
 	pcbLink_p->next_p->prev_p = pcbLink_p->prev_p;
+	schedUnlock();
+}
+
+/* give up the slot of a process; the pid is not valid any more. to be called once
+ * the memory of the process, and so its owner record, is released, so that a new
+ * process in the slot always finds an owner record free
+ */
+void pcbReleaseSlot(pid_t pId) {
+	int slot = pId & (PCB_MAX_PROCESSES - 1);
+
+	schedLock();
+	pcbSlot_p[slot] = NULL;
+	pcbSlotGen[slot] = (pcbSlotGen[slot] + 1) & PCB_GEN_MASK;
+	pcbNextFreeSlot[slot] = pcbFirstFreeSlot;
+	pcbFirstFreeSlot = slot;
+	schedUnlock();
 }
 
 void pcbExit(ProcessControlBlock *pcb_p) {
@@ -197,10 +395,21 @@ void pcbExit(ProcessControlBlock *pcb_p) {
 		return;
 	}
 
+	syncExit(pcb_p);
+	mqExit(pcb_p);
 	pcbCloseStreams(pcb_p);
-	di();
+	schedLock();
+	/* the PCB is the first member of its link */
+	wheelCancel((PcbLink *) pcb_p);
+	if (pcb_p->numStreams == PCB_STREAMS_MIN) {
+		poolPut(&pcbStreamPool, pcb_p->stream);
+	} else if (pcb_p->numStreams > 0) {
+		myFreeErrorCode(pcb_p->stream, (int) pcb_p->processID);
+	}
 	memExit(pcb_p->processID);
-	ei();
+	pcbReleaseSlot(pcb_p->processID);
+	poolPut(&pcbLinkPool, (PcbLink *) pcb_p);
+	schedUnlock();
 }
 
 /* close all streams */
@@ -209,7 +418,7 @@ void pcbCloseStreams(ProcessControlBlock *pcb_p) {
 		pcb_p = getCurrentPCB();
 	}
 
-	myFILE fi = FIO_MAX_STREAMS - 1;
+	myFILE fi = pcb_p->numStreams - 1;
 	for (; fi >= 0; fi--) {
 		if (pcb_p->stream[fi].device_p != NULL) {
 			fileCloseX(fi, pcb_p);
@@ -225,7 +434,7 @@ void pcbCloseUsrStreams(ProcessControlBlock *pcb_p) {
 	}
 
 	/* preset devices are opened for the process, not per user, so no need to close them at logout */
-	myFILE fi = FIO_MAX_STREAMS - 1;
+	myFILE fi = pcb_p->numStreams - 1;
 	for (; fi > LAST_RESERVED_TYPE; fi--) {
 		if (pcb_p->stream[fi].device_p != NULL) {
 			fileCloseX(fi, pcb_p);
@@ -241,27 +450,62 @@ void pcbCloseUsrStreams(ProcessControlBlock *pcb_p) {
  * the argc to be passed to main. Argument 3 is the argv
  * to be passed to main. The stackSize argument is the
  * size of the stack to be allocated for the new process.
+ * memQuota limits the memory the new process may allocate;
+ * the stack is charged to it too. 0 sets no limit. priority
+ * is that of the new process, 0 being the highest.
  * The final argument sets spawnedPid to pid of spawned
  * process.
  */
 int spawn(utlErrno_t main(int argc, char *argv[]), int argc, char *argv[],
-		uint32_t stackSize, pid_t *spawnedPidPtr) {
+		uint32_t stackSize, unsigned memQuota, int priority, pid_t *spawnedPidPtr) {
+	if (spawnCreate(main, argc, argv, stackSize, memQuota, priority, spawnedPidPtr) == -1) {
+		return -1;
+	}
+	pcbSetState(findPCB(*spawnedPidPtr), READY);
+	return 0;
+}
+
+/* create a process as spawn does, but leave it blocked, so that its streams can be
+ * set up before it first runs; it runs once made ready. creating the process (the
+ * stack allocated and painted, the PCB initialized) is done with the scheduler
+ * unlocked. Returns indication of success
+ */
+int spawnCreate(utlErrno_t main(int argc, char *argv[]), int argc, char *argv[],
+		uint32_t stackSize, unsigned memQuota, int priority, pid_t *spawnedPidPtr) {
+	if ((priority < 0) || (priority >= PCB_PRIORITIES)) {
+		return -1;
+	}
+
 	/* checking that stackSize is a multiple of 4 */
 	unsigned mod = (stackSize % 4);
 	if (mod) {
 		stackSize = stackSize + (4 - mod);
 	}
 
-	PcbLink *link = pcbAdd(*spawnedPidPtr, BLOCKED, 0, stackSize, firstLink_p);
+	PcbLink *link = pcbAdd(BLOCKED, 0, stackSize, firstLink_p);
 	if (link == NULL) {
 		return -1;
 	}
+	*spawnedPidPtr = link->pcb.processID;
 
+	link->pcb.memQuota = memQuota;
+	link->pcb.priority = priority;
+	link->pcb.basePriority = priority;
 	link->pcb.stackAddress = memAlloc(stackSize, (int) *spawnedPidPtr);
 	if (link->pcb.stackAddress == NULL) {
+		pcbRemove(link);
+		pcbReleaseSlot(link->pcb.processID);
+		poolPut(&pcbLinkPool, link);
 		return -1;
 	}
 
+	/* paint the stack; the words still painted have never been used */
+	uint32_t *paint_p;
+	for (paint_p = link->pcb.stackAddress;
+			paint_p < (uint32_t *) (link->pcb.stackAddress + stackSize); paint_p++) {
+		*paint_p = PCB_STACK_PAINT;
+	}
+
 	uint32_t *tp = (uint32_t *) ((link->pcb.stackAddress) + stackSize);
 	link->pcb.stackPointer = --tp;
 
@@ -294,14 +538,17 @@ int spawn(utlErrno_t main(int argc, char *argv[]), int argc, char *argv[],
 
 	*(--link->pcb.stackPointer) = 0; /* SVCALLACT */
 
-	/* final initializations */
+	/* final initializations; pcbInit works on the current PCB, which is
+	 * still that of the spawning process afterwards
+	 */
+	ProcessControlBlock *current_p = getCurrentPCB();
 	pcbInit(&link->pcb, (int) *spawnedPidPtr);
+	setCurrentPCB(current_p);
 	uint32_t h, l;
 	di();
 	SvcGetClockImpl(&h, &l);
 	ei();
 	link->pcb.startTime = (((uint64_t) h) << 32) | ((uint64_t) l);
-	link->pcb.state = READY;
 	return 0;
 }
 
@@ -312,10 +559,8 @@ void yield(void){
 
 /* sets the current process to blocked state */
 void block(void){
-	PCB_p->state = BLOCKED;
-	di();
+	pcbSetState(PCB_p, BLOCKED);
 	yield();
-	ei();
 }
 
 /* sets the targetPid process to blocked state.
@@ -329,9 +574,9 @@ int blockPid(pid_t targetPid){
 		success = 0;
 	}else{
 		ProcessControlBlock *pcb_p = findPCB(targetPid);
-		if(pcb_p != NULL){
+		if((pcb_p != NULL) && ((PcbLink *) pcb_p != pcbIdle_p)){
 			if(pcb_p->state != KILL){
-				pcb_p->state = BLOCKED;
+				pcbSetState(pcb_p, BLOCKED);
 				success = 0;
 			}
 		}
@@ -348,7 +593,7 @@ int wake(pid_t targetPid){
 
 	if (pcb_p != NULL) {
 		if (pcb_p->state == BLOCKED) {
-			pcb_p->state = READY;
+			pcbSetState(pcb_p, READY);
 			success = 0;
 		}
 	}
@@ -361,46 +606,492 @@ int wake(pid_t targetPid){
 int myKill(pid_t targetPid){
 	int success = -1;
 	ProcessControlBlock *pcb_p = findPCB(targetPid);
-	if (pcb_p != NULL) {
+	/* the idle process must always be there to run */
+	if ((pcb_p != NULL) && ((PcbLink *) pcb_p != pcbIdle_p)) {
 		uint32_t h, l;
 		di();
 		SvcGetClockImpl(&h, &l);
 		ei();
 		pcb_p->endTime = (((uint64_t) h) << 32) | ((uint64_t) l);
-		pcb_p->state = KILL;
+		pcbSetState(pcb_p, KILL);
 		success = 0;
 	}
 	return success;
 }
 
 /* waits for the targetPid process to end execution
- * (naturally or prematurely) */
-void wait(pid_t targetPid){
-	ProcessControlBlock *pcb_p = findPCB(targetPid);
-	if (pcb_p != NULL) {
-		while (pcb_p->state != KILL) {;}
+ * (naturally or prematurely); the caller is blocked on the exit queue
+ * of the process until end or myKill wakes it, and is handed the exit
+ * status then, since the reaper may clean the process up before the
+ * caller runs again. sets the status if status_p is not NULL.
+ * Returns indication of success: -1 if there is no such process, or it
+ * has been cleaned up before its status could be collected */
+int wait(pid_t targetPid, int *status_p){
+	ProcessControlBlock *self_p = PCB_p;
+	ProcessControlBlock *pcb_p;
+	int success = -1;
+
+	if (targetPid == self_p->processID) {
+		/* would never be woken */
+		return -1;
+	}
+
+	schedLock();
+	self_p->waitDone = false;
+	/* woken for another reason, the caller goes back to sleep */
+	while (!self_p->waitDone && ((pcb_p = findPCB(targetPid)) != NULL)) {
+		if (pcb_p->state == KILL) {
+			self_p->waitStatus = pcb_p->exitStatus;
+			self_p->waitDone = true;
+		} else {
+			pcbSleepOn(&pcb_p->exitQueue);
+		}
+	}
+	if (self_p->waitDone) {
+		if (status_p != NULL) {
+			*status_p = self_p->waitStatus;
+		}
+		success = 0;
 	}
+	schedUnlock();
+	return success;
 }
 
+/* the PCB of a process, looked up in the slot table by its pid; NULL if the
+ * process has been cleaned up, even if its slot has been taken again since
+ */
 ProcessControlBlock *findPCB(pid_t targetPid){
-	pid_t start = shPcbLink_p->pcb.processID;
-	PcbLink *link_p = shPcbLink_p->next_p;
+	PcbLink *link_p;
+
+	if (targetPid < 0) {
+		return NULL;
+	}
+
+	link_p = pcbSlot_p[targetPid & (PCB_MAX_PROCESSES - 1)];
+	if ((link_p == NULL) || (link_p->pcb.processID != targetPid)) {
+		return NULL;
+	}
+	return &link_p->pcb;
+}
+
+/* sets the priority of the targetPid process; 0 is the highest.
+ * Returns indication of success
+ */
+int setPriority(pid_t targetPid, int priority){
+	ProcessControlBlock *pcb_p;
+
+	if ((priority < 0) || (priority >= PCB_PRIORITIES)) {
+		return -1;
+	}
+
+	pcb_p = (PCB_p->processID == targetPid) ? PCB_p : findPCB(targetPid);
+	if ((pcb_p == NULL) || (pcb_p->state == KILL) || ((PcbLink *) pcb_p == pcbIdle_p)) {
+		return -1;
+	}
+
+	schedLock();
+	/* a process holding a mutex keeps the priority it inherited, if higher */
+	pcb_p->basePriority = priority;
+	pcbChangePriority((PcbLink *) pcb_p, syncPriority(pcb_p));
+	schedUnlock();
+
+	return 0;
+}
+
+/* sets the quantum of the targetPid process: the ms it runs before a process
+ * of the same priority gets a turn, from 1 to SYSTICK_MAX_QUANTUM. it applies
+ * from the next turn of the process on.
+ * Returns indication of success
+ */
+int setQuantum(pid_t targetPid, uint32_t ms){
+	ProcessControlBlock *pcb_p;
+
+	if ((ms == 0) || (ms > SYSTICK_MAX_QUANTUM)) {
+		return -1;
+	}
+
+	pcb_p = (PCB_p->processID == targetPid) ? PCB_p : findPCB(targetPid);
+	if ((pcb_p == NULL) || (pcb_p->state == KILL) || ((PcbLink *) pcb_p == pcbIdle_p)) {
+		return -1;
+	}
+
+	pcb_p->quantum = ms;
+	return 0;
+}
+
+/* change the priority a process runs at; a ready one is moved to the queue of
+ * its new priority, and the running process gives up the processor if it no
+ * longer has the highest priority. to be called with the scheduler locked
+ */
+void pcbChangePriority(PcbLink *link_p, int priority) {
+	if (link_p->pcb.state == READY) {
+		pcbUnqueue(link_p);
+		link_p->pcb.priority = priority;
+		pcbEnqueue(link_p);
+	} else {
+		link_p->pcb.priority = priority;
+	}
+
+	/* the running process may have come to a priority others wait at */
+	if ((link_p == shPcbLink_p) && systickStretched() && pcbPeerReady(link_p)) {
+		systickStartQuantum(link_p->pcb.quantum);
+	}
+	if ((pcbReadyMap != 0)
+			&& (__builtin_clz(pcbReadyMap) < shPcbLink_p->pcb.priority)) {
+		yield();
+	}
+}
 
-	while(link_p->pcb.processID != start){
-		if(link_p->pcb.processID == targetPid){
-			return &link_p->pcb;
+/* change the state of a process, and keep the ready queues up to date: only a
+ * READY process is on the queue of its priority. a killed process is put on the
+ * list of processes the scheduler cleans up; KILL is final. a process made ready
+ * with a higher priority than the running one gets the processor at once
+ */
+void pcbSetState(ProcessControlBlock *pcb_p, ProcessState state) {
+	/* the PCB is the first member of its link */
+	PcbLink *link_p = (PcbLink *) pcb_p;
+
+	schedLock();
+	if ((pcb_p->state != KILL) && (pcb_p->state != state)) {
+		if (pcb_p->state == READY) {
+			pcbUnqueue(link_p);
+		} else if (link_p->waitQueue_p != NULL) {
+			pcbWaitQueueRemove(link_p);
 		}
+		pcb_p->state = state;
+
+		if (state == READY) {
+			pcbEnqueue(link_p);
+			if (pcb_p->priority < shPcbLink_p->pcb.priority) {
+				yield();
+			}
+		} else if (state == KILL) {
+			link_p->queuePrev_p = NULL;
+			link_p->queueNext_p = pcbKilled_p;
+			pcbKilled_p = link_p;
+			/* hand the exit status to the processes waiting for it */
+			while (pcb_p->exitQueue.first_p != NULL) {
+				PcbLink *waiter_p = pcb_p->exitQueue.first_p;
+				waiter_p->pcb.waitStatus = pcb_p->exitStatus;
+				waiter_p->pcb.waitDone = true;
+				pcbSetState(&waiter_p->pcb, READY);
+			}
+			pcbWakeOne(&pcbReaperQueue);
+		}
+	}
+	schedUnlock();
+}
+
+void pcbWaitQueueInit(PcbWaitQueue *queue_p) {
+	queue_p->first_p = NULL;
+	queue_p->last_p = NULL;
+}
+
+/* block the current process on a wait queue until it is woken. to be called with
+ * the scheduler locked, right after checking the condition to wait for, so that
+ * the wake up cannot come in between; the lock is given up while the process is
+ * blocked, and is held again when it returns. the caller has to check the
+ * condition again, since the process may also be woken by wake or myKill
+ */
+void pcbSleepOn(PcbWaitQueue *queue_p) {
+	PcbLink *link_p = shPcbLink_p; /* the running process */
+	int lockCount;
+
+	if (link_p->waitQueue_p != NULL) {
+		pcbWaitQueueRemove(link_p);
+	}
+	pcbWaitQueueAppend(link_p, queue_p);
+	link_p->pcb.state = BLOCKED;
+
+	/* the switch is taken as soon as the lock is given up */
+	yield();
+	lockCount = schedRelease();
+	schedReacquire(lockCount);
+}
+
+/* move a blocked process to another wait queue; it stays blocked */
+void pcbWaitQueueMove(PcbLink *link_p, PcbWaitQueue *queue_p) {
+	if (link_p->waitQueue_p != NULL) {
+		pcbWaitQueueRemove(link_p);
+	}
+	pcbWaitQueueAppend(link_p, queue_p);
+}
+
+/* put a process at the end of a wait queue */
+void pcbWaitQueueAppend(PcbLink *link_p, PcbWaitQueue *queue_p) {
+	link_p->queueNext_p = NULL;
+	link_p->queuePrev_p = queue_p->last_p;
+	if (queue_p->last_p != NULL) {
+		queue_p->last_p->queueNext_p = link_p;
+	} else {
+		queue_p->first_p = link_p;
+	}
+	queue_p->last_p = link_p;
+	link_p->waitQueue_p = queue_p;
+}
+
+/* take a blocked process off the wait queue it sleeps on */
+void pcbWaitQueueRemove(PcbLink *link_p) {
+	PcbWaitQueue *queue_p = link_p->waitQueue_p;
+
+	if (link_p->queuePrev_p != NULL) {
+		link_p->queuePrev_p->queueNext_p = link_p->queueNext_p;
+	} else {
+		queue_p->first_p = link_p->queueNext_p;
+	}
+	if (link_p->queueNext_p != NULL) {
+		link_p->queueNext_p->queuePrev_p = link_p->queuePrev_p;
+	} else {
+		queue_p->last_p = link_p->queuePrev_p;
+	}
+	link_p->queuePrev_p = link_p->queueNext_p = NULL;
+	link_p->waitQueue_p = NULL;
+}
+
+/* make the first process on a wait queue ready; returns the number of
+ * processes woken (0 if the queue is empty)
+ */
+int pcbWakeOne(PcbWaitQueue *queue_p) {
+	int woken = 0;
+
+	schedLock();
+	if (queue_p->first_p != NULL) {
+		pcbSetState(&queue_p->first_p->pcb, READY);
+		woken = 1;
+	}
+	schedUnlock();
+	return woken;
+}
+
+/* make all processes on a wait queue ready, in the order they went to sleep;
+ * returns the number of processes woken
+ */
+int pcbWakeAll(PcbWaitQueue *queue_p) {
+	int woken = 0;
+
+	schedLock();
+	while (queue_p->first_p != NULL) {
+		pcbSetState(&queue_p->first_p->pcb, READY);
+		woken++;
+	}
+	schedUnlock();
+	return woken;
+}
+
+/* append a process to the ready queue of its priority */
+void pcbEnqueue(PcbLink *link_p) {
+	int priority = link_p->pcb.priority;
+
+	link_p->queueNext_p = NULL;
+	link_p->queuePrev_p = pcbReadyTail_p[priority];
+	if (link_p->queuePrev_p != NULL) {
+		link_p->queuePrev_p->queueNext_p = link_p;
+	} else {
+		pcbReadyHead_p[priority] = link_p;
+	}
+	pcbReadyTail_p[priority] = link_p;
+	pcbReadyMap |= PCB_READY_BIT(priority);
+
+	/* the running process has someone to take turns with now */
+	if ((link_p != shPcbLink_p) && (priority == shPcbLink_p->pcb.priority)
+			&& systickStretched()) {
+		systickStartQuantum(shPcbLink_p->pcb.quantum);
+	}
+}
+
+/* take a process off the ready queue of its priority */
+void pcbUnqueue(PcbLink *link_p) {
+	int priority = link_p->pcb.priority;
+
+	if (link_p->queuePrev_p != NULL) {
+		link_p->queuePrev_p->queueNext_p = link_p->queueNext_p;
+	} else {
+		pcbReadyHead_p[priority] = link_p->queueNext_p;
+	}
+	if (link_p->queueNext_p != NULL) {
+		link_p->queueNext_p->queuePrev_p = link_p->queuePrev_p;
+	} else {
+		pcbReadyTail_p[priority] = link_p->queuePrev_p;
+	}
+	link_p->queuePrev_p = link_p->queueNext_p = NULL;
+
+	if (pcbReadyHead_p[priority] == NULL) {
+		pcbReadyMap &= ~PCB_READY_BIT(priority);
+	}
+}
+
+/* a process of the same priority as link_p is ready, and waits for a turn */
+bool pcbPeerReady(PcbLink *link_p) {
+	int priority = link_p->pcb.priority;
+
+	return (priority < PCB_PRIORITIES) && (pcbReadyHead_p[priority] != NULL);
+}
+
+/* take the first process off the highest priority non-empty ready queue;
+ * NULL if no process is ready
+ */
+PcbLink *pcbDequeueNext_p(void) {
+	PcbLink *link_p;
+
+	if (pcbReadyMap == 0) {
+		return NULL;
+	}
+
+	link_p = pcbReadyHead_p[__builtin_clz(pcbReadyMap)];
+	pcbUnqueue(link_p);
+	return link_p;
+}
+
+/* clean up the killed processes, one at a time, and sleep on the reaper queue
+ * once there are none; called in the SVC handler for the reaper process, so
+ * the clean up can be preempted. none of the killed processes is running: the
+ * reaper is
+ */
+void pcbReap(void) {
+	PcbLink *link_p;
+
+	schedLock();
+	while (pcbKilled_p == NULL) {
+		pcbSleepOn(&pcbReaperQueue);
+	}
+	while ((link_p = pcbKilled_p) != NULL) {
+		pcbKilled_p = link_p->queueNext_p;
+		schedUnlock();
+		pcbRemove(link_p);
+		pcbExit(&link_p->pcb);
+		schedLock();
+	}
+	schedUnlock();
+}
+
+/* the reaper process, spawned by the shell at start up */
+utlErrno_t pcbReaper(int argc, char *argv[]) {
+	while (1) {
+		SVCreap();
+	}
+	return (utlNoERROR);
+}
+
+/* spawn the idle process, and take it off the ready queues for good; called
+ * by the shell at start up. returns -1 if fails
+ */
+int pcbIdleInit(void) {
+	pid_t idlePid;
+
+	schedLock();
+	if (spawn(pcbIdle, 0, NULL, STACK_SIZE, 0, PCB_PRIORITIES - 1, &idlePid) == -1) {
+		schedUnlock();
+		return -1;
+	}
+	pcbIdle_p = (PcbLink *) findPCB(idlePid);
+	pcbUnqueue(pcbIdle_p);
+	pcbIdle_p->pcb.priority = PCB_IDLE_PRIORITY;
+	pcbIdle_p->pcb.basePriority = PCB_IDLE_PRIORITY;
+	schedUnlock();
+	return 0;
+}
+
+/* the idle process: sleeps until an interrupt comes, and the processor with
+ * it; any process made ready has a higher priority, and takes over at once
+ */
+utlErrno_t pcbIdle(int argc, char *argv[]) {
+	while (1) {
+		__asm volatile("wfi");
+	}
+	return (utlNoERROR);
+}
+
+/* fill in a snapshot of up to maxInfo PCBs, the current process first;
+ * returns the number of PCBs filled in
+ */
+int pcbGetInfo(PcbInfo *info_p, int maxInfo) {
+	PcbLink *link_p = shPcbLink_p;
+	int n = 0;
+
+	if ((info_p == NULL) || (maxInfo <= 0) || (link_p == NULL)) {
+		return 0;
+	}
+
+	schedLock();
+	uint64_t now = pcbCycleCount();
+	do {
+		/* the running process has not been charged since the last switch yet */
+		uint64_t cpu = link_p->pcb.cpuTime;
+		if (link_p == shPcbLink_p) {
+			cpu += utlCycles() - pcbLastCycles;
+		}
+		uint64_t lifetime = now - link_p->pcb.cpuStart;
+
+		info_p[n].processID = link_p->pcb.processID;
+		info_p[n].state = link_p->pcb.state;
+		info_p[n].priority = link_p->pcb.priority;
+		info_p[n].quantum = link_p->pcb.quantum;
+		info_p[n].cpuMs = (uint32_t) (cpu / (UTL_CORE_CLOCK / 1000));
+		info_p[n].cpuPermille = (lifetime == 0) ? 0 : (unsigned) ((cpu * 1000) / lifetime);
+		info_p[n].stackSize = link_p->pcb.stackSize;
+		info_p[n].stackUsed = pcbStackUsed(&link_p->pcb);
+		info_p[n].memQuota = link_p->pcb.memQuota;
+		info_p[n].memUsed = link_p->pcb.memUsed;
+		n++;
 		link_p = link_p->next_p;
+	} while ((n < maxInfo) && (link_p != shPcbLink_p));
+	schedUnlock();
+
+	return n;
+}
+
+/* how deep the stack of a process has been used, found from the words
+ * still painted at its end; -1 for a process not spawned with its own stack
+ */
+int pcbStackUsed(ProcessControlBlock *pcb_p) {
+	uint32_t *word_p = pcb_p->stackAddress;
+	uint32_t *end_p;
+
+	if ((pcb_p->stackSize <= 0) || (word_p == NULL)) {
+		return -1;
 	}
-	return NULL;
+
+	end_p = (uint32_t *) (pcb_p->stackAddress + pcb_p->stackSize);
+	while ((word_p < end_p) && (*word_p == PCB_STACK_PAINT)) {
+		word_p++;
+	}
+	return (int) ((char *) end_p - (char *) word_p);
 }
 
-/*current PCB has finished execution naturally*/
-void end(void){
-	uint32_t h, l;
-	SVCgetClock(&h, &l);
-	PCB_p->endTime = (((uint64_t) h) << 32) | ((uint64_t) l);
-	PCB_p->state = KILL;
+/* charge a process with the cycles since the last switch, and extend the
+ * cycle count; link_p is NULL for time nobody ran. called by the scheduler.
+ * returns the cycles charged
+ */
+uint32_t pcbChargeCpu(PcbLink *link_p) {
+	uint32_t now = utlCycles();
+	uint32_t cycles = now - pcbLastCycles;
+
+	pcbLastCycles = now;
+	pcbCycles += cycles;
+	if (link_p != NULL) {
+		link_p->pcb.cpuTime += cycles;
+	}
+	return cycles;
+}
+
+/* core clock cycles since start up */
+uint64_t pcbCycleCount(void) {
+	uint64_t cycles;
+
+	schedLock();
+	cycles = pcbCycles + (uint32_t) (utlCycles() - pcbLastCycles);
+	schedUnlock();
+	return cycles;
+}
+
+/*current PCB has finished execution naturally; main returns into it, so the
+ * value main returned is the argument */
+void end(int status){
+	PCB_p->exitStatus = status;
+	/* the ready queues can only be changed in privileged mode; myKill
+	 * also records the end time
+	 */
+	SVCmyKill(PCB_p->processID);
 	SVCyield();
 	while(1){;}
 }
@@ -411,13 +1102,13 @@ void pcbReleaseStreamIdxX(uint8_t streamIdx, ProcessControlBlock *pcb_p) {
 	}
 
 	/* check for valid index */
-	if (streamIdx < FIO_MAX_STREAMS) {
+	if (streamIdx < pcb_p->numStreams) {
 		pcb_p->stream[streamIdx].device_p = NULL;
 		pcb_p->stream[streamIdx].id[0] = '\0';
 		pcb_p->stream[streamIdx].position.currBlock_p = NULL;
 		pcb_p->stream[streamIdx].position.offset = 0;
 
-		pcb_p->stream[streamIdx].nextFreeIdx = PCB_p->firstFreeStream;
+		pcb_p->stream[streamIdx].nextFreeIdx = pcb_p->firstFreeStream;
 		pcb_p->firstFreeStream = streamIdx;
 	}
 }
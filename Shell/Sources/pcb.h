@@ -23,6 +23,14 @@ typedef enum {
 	KILL
 } ProcessState;
 
+/* queue of processes blocked until some event; a process sleeps on it with
+ * pcbSleepOn, and is made ready again by pcbWakeOne/pcbWakeAll
+ */
+typedef struct {
+	struct PcbLink_s *first_p;
+	struct PcbLink_s *last_p;
+} PcbWaitQueue;
+
 typedef struct {
 	pid_t processID;
 	ProcessState state;
@@ -34,19 +42,62 @@ typedef struct {
 	/* clock time in millis */
 	uint64_t startTime;
 	uint64_t endTime;
+	/* core clock cycles the process has run, charged by the scheduler at every
+	 * switch, and the cycle count (pcbCycleCount) when it was added
+	 */
 	uint64_t cpuTime;
+	uint64_t cpuStart;
+	int priority; /* 0 is the highest; raised above basePriority while a higher
+	                 priority process waits for a mutex the process holds */
+	int basePriority;
+	uint32_t quantum; /* ms the process runs before one of the same priority gets a turn */
+	struct SyncObj_s *held_p;      /* mutexes held, see sync.c */
+	struct SyncObj_s *blockedOn_p; /* mutex waited for */
+	bool syncGranted; /* a semaphore count or mutex was handed to the process as it was woken */
+	PcbWaitQueue exitQueue; /* processes waiting for this one to end */
+	int exitStatus; /* returned by main; PCB_EXIT_KILLED if killed before */
+	int waitStatus; /* exit status of the process waited for, once it has ended */
+	bool waitDone;
+	uint32_t wakeTime; /* ms the process sleeps until, on the timer wheel */
+	bool timedOut; /* a sleep with a time limit (wheelSleepOn) ran out */
+	/* heap memory, headers not included; charged and credited by the memory manager */
+	unsigned memQuota; /* bytes the process may hold; 0 for no limit */
+	unsigned memUsed;
 	/* fio information */
 	int currentDirInode;
 	Stream *stream;
+	uint8_t numStreams; /* entries in the stream table; grows from PCB_STREAMS_MIN up to FIO_MAX_STREAMS */
 	uint8_t firstFreeStream;
 	myFILE fiLog;
 } ProcessControlBlock;
 
-/* link definition for circular linked list of PCBs */
+/* snapshot of a PCB, for listing the processes */
+typedef struct {
+	pid_t processID;
+	ProcessState state;
+	int priority;
+	uint32_t quantum;
+	uint32_t cpuMs;
+	unsigned cpuPermille; /* share of the processor since the process was added */
+	int stackSize;
+	int stackUsed;        /* deepest the stack has been; -1 if not known */
+	unsigned memQuota;
+	unsigned memUsed;
+} PcbInfo;
+
+/* link definition for circular linked list of PCBs; a READY process is also
+ * on the ready queue of its priority, a BLOCKED one may be on a wait queue,
+ * and a killed one is on the list of processes to be cleaned up
+ */
 typedef struct PcbLink_s {
 	ProcessControlBlock pcb;
 	struct PcbLink_s *prev_p;
 	struct PcbLink_s *next_p;
+	struct PcbLink_s *queuePrev_p;
+	struct PcbLink_s *queueNext_p;
+	PcbWaitQueue *waitQueue_p; /* wait queue the process sleeps on, if any */
+	struct PcbLink_s *timeoutPrev_p; /* list of processes sleeping with a time limit */
+	struct PcbLink_s *timeoutNext_p;
 } PcbLink;
 
 /* global variable declarations */
@@ -60,6 +111,22 @@ typedef struct PcbLink_s {
 
 #define NO_PID -1
 #define STACK_SIZE 2048 //default stack size
+#define PCB_POOL_CHUNK 4 /* PCB links/stream tables reserved at once when the pools grow */
+#define PCB_STREAMS_MIN 32 /* entries of a new stream table: the reserved ones and 8 more; doubled as needed */
+#define PCB_MAX_INFO 32 /* processes listed by ps */
+#define PCB_PRIORITIES 32 /* one ready queue per priority; a bit per queue in a 32 bit map */
+#define PCB_DEFAULT_PRIORITY 16
+#define PCB_IDLE_PRIORITY PCB_PRIORITIES /* below every ready queue; the idle process is on none */
+#define PCB_EXIT_KILLED -1 /* exit status of a process that did not return from main */
+#define PCB_STACK_PAINT 0x5354414B /* "STAK" - fills a new stack, to find how deep it was used */
+/* a pid is the index of the slot of the process in the slot table, with the
+ * generation of the slot in the bits above; a pid is never negative
+ */
+#define PCB_SLOT_BITS 6
+#define PCB_MAX_PROCESSES (1 << PCB_SLOT_BITS)
+#define PCB_GEN_MASK ((1 << (31 - PCB_SLOT_BITS)) - 1)
+
+extern PcbLink *pcbIdle_p; /* the idle process; runs while no other process is ready */
 
 /* function declarations */
 
@@ -69,7 +136,7 @@ FioErrno pcbInit(ProcessControlBlock *pcb_p, int pId);
 void setCurrentPCB(ProcessControlBlock *pcb_p); /* when scheduler triggers, this updates*/
 
 int spawn(utlErrno_t main(int argc, char *argv[]), int argc, char *argv[],
-		uint32_t stackSize, pid_t *spawnedPidPtr);
+		uint32_t stackSize, unsigned memQuota, int priority, pid_t *spawnedPidPtr);
 								/* returns indication of success */
 								/* main is the function to be run by the
 				   	   	   	   	   newly created process */
@@ -78,7 +145,15 @@ int spawn(utlErrno_t main(int argc, char *argv[]), int argc, char *argv[],
 
 								/* stackSize is the size of the stack to be
 				   	   	   	   	   allocated for the new process */
+								/* memQuota is the number of bytes the new
+								   process may allocate, stack included;
+								   0 for no limit */
+								/* priority is the priority of the new
+								   process; 0 is the highest */
 								/* sets spawnedPid to pid of spawned process */
+int spawnCreate(utlErrno_t main(int argc, char *argv[]), int argc, char *argv[],
+		uint32_t stackSize, unsigned memQuota, int priority, pid_t *spawnedPidPtr);
+								/* as spawn, but the process is left blocked */
 void yield(void);				/* yields remaining quantum */
 void block(void);				/* sets the current process to blocked state */
 int blockPid(pid_t targetPid);  /* sets the targetPid process to blocked state */
@@ -87,21 +162,51 @@ int wake(pid_t targetPid);		/* sets the targetPid process to ready state */
 								/* returns indication of success */
 int myKill(pid_t targetPid);	/* prematurely terminates the targetPid process */
 								/* returns indication of success */
-void wait(pid_t targetPid);		/* waits for the targetPid process to end execution
+int wait(pid_t targetPid, int *status_p);
+								/* waits for the targetPid process to end execution
 								   (naturally or prematurely) */
+								/* sets status to its exit status, if not NULL */
+								/* returns indication of success */
+int setPriority(pid_t targetPid, int priority);
+								/* sets the priority of the targetPid process */
+								/* returns indication of success */
+int setQuantum(pid_t targetPid, uint32_t ms);
+								/* sets the quantum of the targetPid process */
+								/* returns indication of success */
 
 uint8_t pcbGetFreeStreamIdx(void);
 void pcbReleaseStreamIdx(uint8_t streamIdx);
+int pcbNumStreams(void);
+int pcbGrowStreams(ProcessControlBlock *pcb_p);
+void pcbMapStream(ProcessControlBlock *pcb_p, myFILE fi, DevType type, char *id_p, char *mode_p);
 
-PcbLink *pcbAdd(pid_t pid, ProcessState state, UtlAddress_t sp, int size, PcbLink *last_p);
+int pcbPoolInit(void);
+PcbLink *pcbAdd(ProcessState state, UtlAddress_t sp, int size, PcbLink *last_p);
 void pcbRemove(PcbLink *pcbLink_p);
+void pcbReleaseSlot(pid_t pId);
 
 void pcbExit(ProcessControlBlock *pcb_p);
 void pcbCloseStreams (ProcessControlBlock *pcb_p);
 void pcbCloseUsrStreams (ProcessControlBlock *pcb_p);
 
 ProcessControlBlock *findPCB(pid_t targetPid);
-int getNextPID(void);
+int pcbGetInfo(PcbInfo *info_p, int maxInfo);
+uint32_t pcbChargeCpu(PcbLink *link_p);
+uint64_t pcbCycleCount(void);
+void pcbSetState(ProcessControlBlock *pcb_p, ProcessState state);
+void pcbEnqueue(PcbLink *link_p);
+void pcbChangePriority(PcbLink *link_p, int priority);
+PcbLink *pcbDequeueNext_p(void);
+void pcbReap(void);
+utlErrno_t pcbReaper(int argc, char *argv[]);
+int pcbIdleInit(void);
+utlErrno_t pcbIdle(int argc, char *argv[]);
+bool pcbPeerReady(PcbLink *link_p);
+void pcbWaitQueueInit(PcbWaitQueue *queue_p);
+void pcbSleepOn(PcbWaitQueue *queue_p);
+void pcbWaitQueueMove(PcbLink *link_p, PcbWaitQueue *queue_p);
+int pcbWakeOne(PcbWaitQueue *queue_p);
+int pcbWakeAll(PcbWaitQueue *queue_p);
 
 void pcbReleaseStreamIdxX(uint8_t streamIdx,ProcessControlBlock *pcb_p);
 
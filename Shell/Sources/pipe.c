@@ -0,0 +1,349 @@
+/* pipe.c contains the anonymous pipes, a device through which the output of one
+ * process is the input of another; the shell runs the stages of a pipeline
+ * ("cmd1 | cmd2") as processes with their STDOUT and STDIN bound to pipes.
+ *
+ * a pipe is a ring buffer of PIPE_SIZE bytes, taken from a pool, with one
+ * writer and one reader. the writer only moves the count of bytes written
+ * (head), after the bytes are in; the reader only moves the count of bytes
+ * read (tail), after it has taken them, so moving data takes no lock. only a
+ * side that has to wait takes the scheduler lock, to check the ring again and
+ * sleep on its wait queue; the other side wakes it after moving the count.
+ * since no process runs while the lock is held, the waker either sees the
+ * sleeper on the queue, or the sleeper sees the new count.
+ *
+ * the creator of a pipe holds a read and a write end of its own until it
+ * releases the pipe, so none of the processes it binds to the pipe sees it
+ * closed before all of them are bound. once there are no writers left, the
+ * reader gets what is left, then the end of file; once there are no readers
+ * left, writes fail. the pipe goes back to the pool when both sides are closed.
+ *
+ * Primary functions:
+ *		pipeCreate(): create a pipe
+ *		pipeBind(): bind a stream of a process to one end of a pipe
+ *		pipeRelease(): give up the ends held by the creator
+ *		pipeRead()/pipeWrite(): move bytes out of/into a pipe
+ *		pipeGetc()/pipePutc()/pipeGets()/pipePuts()/pipeFread()/pipeFwrite():
+ *			the device functions
+ *		pipeOfStream_p(): the pipe a stream is bound to, if any
+ */
+
+/* sys include files */
+#include <stdlib.h>
+#include <string.h>
+
+/* project headers */
+#include "pipe.h"
+#include "pcb.h"
+#include "fio.h"
+#include "pool.h"
+#include "shell.h"
+#include "utl.h"
+
+/* the bytes are in the ring before the count that hands them over is moved */
+#define PIPE_BARRIER() __asm volatile("dmb" : : : "memory")
+
+Pool pipePool;
+
+/* internal function declarations - to be used by the pipes only */
+Pipe *pipeStream_p(myFILE fi, bool write);
+
+/* function definitions */
+
+/* create the pool of pipes; called by fioInit. returns -1 if fails */
+int pipeInit(void) {
+	return poolCreate(&pipePool, sizeof(Pipe), PIPE_POOL_CHUNK);
+}
+
+/* create a pipe; the caller holds a read and a write end until it releases
+ * it. returns NULL if fails
+ */
+Pipe *pipeCreate(void) {
+	Pipe *pipe_p = poolGet(&pipePool);
+
+	if (pipe_p == NULL) {
+		return NULL;
+	}
+	pipe_p->head = 0;
+	pipe_p->tail = 0;
+	pipe_p->readers = 1;
+	pipe_p->writers = 1;
+	pcbWaitQueueInit(&pipe_p->readWait);
+	pcbWaitQueueInit(&pipe_p->writeWait);
+	return pipe_p;
+}
+
+/* give up the ends held by the creator of a pipe. returns -1 if there is no pipe */
+int pipeRelease(Pipe *pipe_p) {
+	if (pipe_p == NULL) {
+		return -1;
+	}
+	schedLock();
+	pipeCloseEnd(pipe_p, false);
+	pipeCloseEnd(pipe_p, true);
+	schedUnlock();
+	return 0;
+}
+
+/* bind the stream fi of a process to the read end of a pipe if fi is STDIN, to
+ * the write end otherwise; the stream is taken over if it is open. to be called
+ * before the process first runs. returns -1 if fails
+ */
+int pipeBind(ProcessControlBlock *pcb_p, myFILE fi, Pipe *pipe_p) {
+	if ((pcb_p == NULL) || (pipe_p == NULL) || (fi < 0) || (fi >= pcb_p->numStreams)) {
+		return -1;
+	}
+
+	Stream *stream_p = &pcb_p->stream[fi];
+	bool write = (fi != STDIN);
+
+	schedLock();
+	if ((stream_p->device_p != NULL) && (stream_p->device_p->type != PIPE)) {
+		/* the file the stream had open is not closed through it any more */
+		INODE(stream_p->inodeIdx).accessCount--;
+	}
+	stream_p->device_p = &fioDevice[PIPE];
+	stream_p->mode[0] = write ? 'w' : 'r';
+	stream_p->mode[1] = '\0';
+	stream_p->pipe_p = pipe_p;
+	if (write) {
+		pipe_p->writers++;
+	} else {
+		pipe_p->readers++;
+	}
+	schedUnlock();
+	return 0;
+}
+
+/* close one end of a pipe: the other side is woken to find it closed, and the
+ * pipe goes back to the pool once both sides are
+ */
+void pipeCloseEnd(Pipe *pipe_p, bool write) {
+	schedLock();
+	if (write) {
+		if (--pipe_p->writers == 0) {
+			pcbWakeAll(&pipe_p->readWait);
+		}
+	} else {
+		if (--pipe_p->readers == 0) {
+			pcbWakeAll(&pipe_p->writeWait);
+		}
+	}
+	if ((pipe_p->readers == 0) && (pipe_p->writers == 0)) {
+		poolPut(&pipePool, pipe_p);
+	}
+	schedUnlock();
+}
+
+/* read up to len bytes from a pipe, waiting for at least one. returns the
+ * number of bytes read, 0 at the end of file (no writer left)
+ */
+int pipeRead(Pipe *pipe_p, char *s_p, int len) {
+	uint32_t tail = pipe_p->tail;
+	uint32_t count;
+	unsigned offset, n;
+
+	while ((count = pipe_p->head - tail) == 0) {
+		schedLock();
+		if ((pipe_p->head == tail) && (pipe_p->writers > 0)) {
+			pcbSleepOn(&pipe_p->readWait);
+		}
+		schedUnlock();
+		if ((pipe_p->head == tail) && (pipe_p->writers == 0)) {
+			return 0;
+		}
+	}
+
+	if (count > (uint32_t) len) {
+		count = len;
+	}
+	/* in up to two pieces, if the bytes wrap around the end of the ring */
+	offset = tail & (PIPE_SIZE - 1);
+	n = (count < (PIPE_SIZE - offset)) ? count : (PIPE_SIZE - offset);
+	memcpy(s_p, &pipe_p->buffer[offset], n);
+	memcpy(s_p + n, pipe_p->buffer, count - n);
+	PIPE_BARRIER();
+	pipe_p->tail = tail + count;
+
+	if (pipe_p->writeWait.first_p != NULL) {
+		schedLock();
+		pcbWakeAll(&pipe_p->writeWait);
+		schedUnlock();
+	}
+	return count;
+}
+
+/* write len bytes to a pipe, waiting for room as needed. returns the number
+ * of bytes written, or -1 if there is no reader left before any is
+ */
+int pipeWrite(Pipe *pipe_p, const char *s_p, int len) {
+	uint32_t head = pipe_p->head;
+	uint32_t room;
+	unsigned offset, n;
+	int done = 0;
+
+	while (done < len) {
+		if (pipe_p->readers == 0) {
+			return (done > 0) ? done : -1;
+		}
+		if ((room = PIPE_SIZE - (head - pipe_p->tail)) == 0) {
+			schedLock();
+			if (((head - pipe_p->tail) == PIPE_SIZE) && (pipe_p->readers > 0)) {
+				pcbSleepOn(&pipe_p->writeWait);
+			}
+			schedUnlock();
+			continue;
+		}
+
+		if (room > (uint32_t) (len - done)) {
+			room = len - done;
+		}
+		offset = head & (PIPE_SIZE - 1);
+		n = (room < (PIPE_SIZE - offset)) ? room : (PIPE_SIZE - offset);
+		memcpy(&pipe_p->buffer[offset], s_p + done, n);
+		memcpy(pipe_p->buffer, s_p + done + n, room - n);
+		PIPE_BARRIER();
+		head += room;
+		pipe_p->head = head;
+		done += room;
+
+		if (pipe_p->readWait.first_p != NULL) {
+			schedLock();
+			pcbWakeAll(&pipe_p->readWait);
+			schedUnlock();
+		}
+	}
+	return done;
+}
+
+/* device specific IO functions */
+
+/* pipes have no name; they are created by the shell, and bound to streams
+ * by spawn
+ */
+int pipeOpen(char *id_p, char *mode_p) {
+	return -1;
+}
+
+/* closes the end of a pipe a stream is bound to; STDIN and STDOUT go back to
+ * the UART, mapped again to their std file, whose reference pipeBind dropped;
+ * other streams are released
+ */
+int pipeClose(myFILE fi) {
+	Pipe *pipe_p = pipeOfStream_p(fi);
+
+	if (pipe_p == NULL) {
+		return -1;
+	}
+
+	ProcessControlBlock *pcb_p = getCurrentPCB();
+	pipeCloseEnd(pipe_p, pcb_p->stream[fi].mode[0] == 'w');
+	if (fi <= STDERR) {
+		static char *stdId_p[] = {"STDIN", "STDOUT", "STDERR"};
+		pcbMapStream(pcb_p, fi, STD, stdId_p[fi - STDIN], "a");
+	} else {
+		pcbReleaseStreamIdx(fi);
+	}
+	return 0;
+}
+
+/* reads a char from a pipe; returns -1 at the end of file */
+int pipeGetc(myFILE fi) {
+	Pipe *pipe_p = pipeStream_p(fi, false);
+	char c;
+
+	if ((pipe_p == NULL) || (pipeRead(pipe_p, &c, 1) != 1)) {
+		return -1;
+	}
+	return (unsigned char) c;
+}
+
+/* writes a char to a pipe; returns the char, or -1 if fails */
+int pipePutc(int c, myFILE fi) {
+	Pipe *pipe_p = pipeStream_p(fi, true);
+	char ch = (char) c;
+
+	if ((pipe_p == NULL) || (pipeWrite(pipe_p, &ch, 1) != 1)) {
+		return -1;
+	}
+	return c;
+}
+
+/* reads a line of up to len - 1 chars from a pipe, '\0' terminated; the
+ * new line, if read, is kept. returns -1 if fails
+ */
+int pipeGets(char *s_p, int len, myFILE fi) {
+	if (s_p == NULL) {
+		return -1;
+	}
+
+	int c;
+	int n = len;
+
+	*s_p = '\0';
+	while ((--n > 0) && ((c = pipeGetc(fi)) != -1)) {
+		*s_p++ = (char) c;
+		if (c == '\n') {
+			break;
+		}
+	}
+	*s_p = '\0';
+	return 0;
+}
+
+/* writes a string to a pipe; returns -1 if fails */
+int pipePuts(char *s_p, myFILE fi) {
+	Pipe *pipe_p = pipeStream_p(fi, true);
+
+	if ((pipe_p == NULL) || (s_p == NULL)) {
+		return -1;
+	}
+	return (pipeWrite(pipe_p, s_p, strlen(s_p)) == -1) ? -1 : 0;
+}
+
+/* reads up to len bytes from a pipe, waiting for at least one; returns the
+ * number read, 0 at the end of file, or -1 if fails
+ */
+int pipeFread(void *buf_p, int len, myFILE fi) {
+	Pipe *pipe_p = pipeStream_p(fi, false);
+
+	if ((pipe_p == NULL) || (buf_p == NULL) || (len < 0)) {
+		return -1;
+	}
+	return pipeRead(pipe_p, buf_p, len);
+}
+
+/* writes len bytes to a pipe; returns the number written, or -1 if fails */
+int pipeFwrite(const void *buf_p, int len, myFILE fi) {
+	Pipe *pipe_p = pipeStream_p(fi, true);
+
+	if ((pipe_p == NULL) || (buf_p == NULL) || (len < 0)) {
+		return -1;
+	}
+	return pipeWrite(pipe_p, buf_p, len);
+}
+
+/* the pipe a stream of the current process is bound to; NULL if it is not */
+Pipe *pipeOfStream_p(myFILE fi) {
+	ProcessControlBlock *pcb_p = getCurrentPCB();
+
+	if ((pcb_p == NULL) || (fi < 0) || (fi >= pcb_p->numStreams)) {
+		return NULL;
+	}
+	Stream *stream_p = &pcb_p->stream[fi];
+	if ((stream_p->device_p == NULL) || (stream_p->device_p->type != PIPE)) {
+		return NULL;
+	}
+	return stream_p->pipe_p;
+}
+
+/* the pipe a stream of the current process is bound to, if it is bound to
+ * the end for writing (write) or reading (!write)
+ */
+Pipe *pipeStream_p(myFILE fi, bool write) {
+	Pipe *pipe_p = pipeOfStream_p(fi);
+
+	if ((pipe_p == NULL) || ((getCurrentPCB()->stream[fi].mode[0] == 'w') != write)) {
+		return NULL;
+	}
+	return pipe_p;
+}
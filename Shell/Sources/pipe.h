@@ -0,0 +1,54 @@
+#ifndef PIPE_
+#define PIPE_
+
+/* systtem headers */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local headers */
+#include "fio.h"
+#include "pcb.h"
+
+/* constants */
+#define PIPE_SIZE 512 /* bytes buffered; a power of 2 */
+#define PIPE_POOL_CHUNK 4 /* pipes reserved at once when the pool grows */
+
+/* type definitions */
+
+/* anonymous pipe: a ring buffer with one writer and one reader. the counts of
+ * bytes written (head) and read (tail) only ever grow, and each is changed by
+ * one side only, so neither side locks to move data. a side that finds the
+ * ring full, or empty, sleeps on its wait queue
+ */
+typedef struct Pipe_s {
+	char buffer[PIPE_SIZE];
+	volatile uint32_t head;  /* bytes written; changed by the writer only */
+	volatile uint32_t tail;  /* bytes read; changed by the reader only */
+	int readers;             /* open read ends, the creator's included */
+	int writers;             /* open write ends, the creator's included */
+	PcbWaitQueue readWait;   /* reader waiting for bytes */
+	PcbWaitQueue writeWait;  /* writer waiting for room */
+} Pipe;
+
+/* function declarations */
+int pipeInit(void);
+Pipe *pipeCreate(void);
+int pipeRelease(Pipe *pipe_p);
+int pipeBind(ProcessControlBlock *pcb_p, myFILE fi, Pipe *pipe_p);
+void pipeCloseEnd(Pipe *pipe_p, bool write);
+int pipeRead(Pipe *pipe_p, char *s_p, int len);
+int pipeWrite(Pipe *pipe_p, const char *s_p, int len);
+Pipe *pipeOfStream_p(myFILE fi);
+
+/* device specific IO functions */
+int pipeOpen(char *id_p, char *mode_p);
+int pipeClose(myFILE fi);
+int pipeGetc(myFILE fi);
+int pipePutc(int c, myFILE fi);
+int pipeGets(char *s_p, int len, myFILE fi);
+int pipePuts(char *s_p, myFILE fi);
+int pipeFread(void *buf_p, int len, myFILE fi);
+int pipeFwrite(const void *buf_p, int len, myFILE fi);
+
+#endif /* PIPE_ */
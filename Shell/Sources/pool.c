@@ -0,0 +1,155 @@
+/* pool.c contains the fixed-size object allocator used for the kernel objects
+ * that are allocated and released all the time (file blocks, process control
+ * blocks, stream tables).
+ *
+ * every pool takes chunks of memory from the heap and carves them into objects
+ * of a single size; getting and putting an object is a pop/push on the free list
+ * of the pool, so it takes constant time, pays no per-object header, and does
+ * not fragment the heap.
+ *
+ * the free list is updated with exclusive load/store (LDREX/STREX): the store only
+ * succeeds if no other access to the list head - and no exception, which clears
+ * the exclusive monitor on the Cortex-M4 - came in between, otherwise the update
+ * is retried. therefore the lists can be used from any process without masking
+ * interrupts; only growing a pool by a new chunk is done with the scheduler locked.
+ *
+ * Primary functions:
+ *		poolCreate(): set up a pool and reserve its first chunk
+ *		poolGet(): take an object from a pool
+ *		poolPut(): give an object back to its pool
+ */
+
+/* sys include files */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* project headers */
+#include "pool.h"
+#include "mem.h"
+#include "utl.h"
+
+/* not declared in mem.h, since to be used by OS only */
+extern void *memAlloc(unsigned size, int pId);
+
+/* internal function declarations - to be used by pool utility only */
+PoolObj *poolPop(PoolObj **head_pp);
+void poolPush(PoolObj **head_pp, PoolObj *first_p, PoolObj *last_p);
+int poolGrow(Pool *pool_p);
+
+/* function definitions */
+
+/* set up a pool of objects of the given size, and reserve the first chunk;
+ * returns -1 if the chunk could not be allocated
+ */
+int poolCreate(Pool *pool_p, unsigned objSize, unsigned objsPerChunk) {
+	if ((pool_p == NULL) || (objSize == 0) || (objsPerChunk == 0)) {
+		return -1;
+	}
+
+	if (objSize < sizeof(PoolObj)) {
+		objSize = sizeof(PoolObj);
+	}
+	if (objSize % DWORD) {
+		objSize += DWORD - (objSize % DWORD);
+	}
+
+	pool_p->objSize = objSize;
+	pool_p->objsPerChunk = objsPerChunk;
+	pool_p->numChunks = 0;
+	pool_p->free_p = NULL;
+
+	return poolGrow(pool_p);
+}
+
+/* take an object from the pool; grows the pool by a chunk if it is empty.
+ * returns NULL if no more memory is available
+ */
+void *poolGet(Pool *pool_p) {
+	PoolObj *obj_p = poolPop(&pool_p->free_p);
+
+	while (obj_p == NULL) {
+		schedLock();
+		/* another process may have grown the pool in the meantime */
+		if ((pool_p->free_p == NULL) && (poolGrow(pool_p) == -1)) {
+			schedUnlock();
+			return NULL;
+		}
+		schedUnlock();
+		obj_p = poolPop(&pool_p->free_p);
+	}
+
+	return ((void *) obj_p);
+}
+
+/* give an object back to the pool it was taken from */
+void poolPut(Pool *pool_p, void *obj_p) {
+	if (obj_p == NULL) {
+		return;
+	}
+	poolPush(&pool_p->free_p, (PoolObj *) obj_p, (PoolObj *) obj_p);
+}
+
+/* pop the first object off a free list */
+PoolObj *poolPop(PoolObj **head_pp) {
+	PoolObj *obj_p;
+	uint32_t failed;
+
+	do {
+		__asm volatile("ldrex %[obj], [%[head]]"
+				: [obj] "=r" (obj_p)
+				: [head] "r" (head_pp)
+				: "memory");
+		if (obj_p == NULL) {
+			__asm volatile("clrex" : : : "memory");
+			return NULL;
+		}
+		__asm volatile("strex %[failed], %[next], [%[head]]"
+				: [failed] "=&r" (failed)
+				: [next] "r" (obj_p->next_p), [head] "r" (head_pp)
+				: "memory");
+	} while (failed);
+
+	return obj_p;
+}
+
+/* push a chain of objects, from first_p to last_p, onto a free list */
+void poolPush(PoolObj **head_pp, PoolObj *first_p, PoolObj *last_p) {
+	PoolObj *head_p;
+	uint32_t failed;
+
+	do {
+		__asm volatile("ldrex %[head_p], [%[head]]"
+				: [head_p] "=r" (head_p)
+				: [head] "r" (head_pp)
+				: "memory");
+		last_p->next_p = head_p;
+		__asm volatile("strex %[failed], %[first], [%[head]]"
+				: [failed] "=&r" (failed)
+				: [first] "r" (first_p), [head] "r" (head_pp)
+				: "memory");
+	} while (failed);
+}
+
+/* take a new chunk from the heap and put all of its objects on the free list;
+ * the chunk is not owned by any process, so it survives the process that
+ * caused the pool to grow. returns -1 if the chunk could not be allocated
+ */
+int poolGrow(Pool *pool_p) {
+	char *chunk_p = memAlloc(pool_p->objSize * pool_p->objsPerChunk, -1);
+	if (chunk_p == NULL) {
+		return -1;
+	}
+
+	/* chain the objects of the chunk in address order */
+	unsigned i;
+	PoolObj *obj_p = (PoolObj *) chunk_p;
+	for (i = 1; i < pool_p->objsPerChunk; i++) {
+		obj_p->next_p = (PoolObj *) (chunk_p + (i * pool_p->objSize));
+		obj_p = obj_p->next_p;
+	}
+
+	poolPush(&pool_p->free_p, (PoolObj *) chunk_p, obj_p);
+	pool_p->numChunks++;
+
+	return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef POOL_
+#define POOL_
+
+/* systtem headers */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local headers */
+#include "utl.h"
+
+/* type definitions */
+
+/* a free object is chained to the next one through its first word */
+typedef struct poolObj_s {
+	struct poolObj_s *next_p;
+} PoolObj;
+
+/* pool of fixed-size objects; objects are carved out of chunks taken from
+ * the heap, and are never given back to it - a released object goes back
+ * on the free list of its pool
+ */
+typedef struct {
+	unsigned objSize;      /* object size, rounded up to a double word */
+	unsigned objsPerChunk; /* number of objects carved out of every chunk */
+	unsigned numChunks;
+	PoolObj *free_p;       /* free list; pushed and popped lock-free */
+} Pool;
+
+/* function declarations */
+int poolCreate(Pool *pool_p, unsigned objSize, unsigned objsPerChunk);
+void *poolGet(Pool *pool_p);
+void poolPut(Pool *pool_p, void *obj_p);
+
+#endif /* POOL_ */
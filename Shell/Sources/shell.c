@@ -6,7 +6,9 @@
  * white space separated fields found in the input line. If text is enclosed in
  * double-quotes, then any whitespace within will be part of the argument.
  * The array argv will contain a list of pointers to copies of each of the
- * fields found in the input line as null-terminated strings. The follwoing
+ * fields found in the input line as null-terminated strings. Commands
+ * separated by a "|" word form a pipeline: each of them runs as a process,
+ * with its output going to the input of the next one. The follwoing
  * features are encluded in the shell:
  * Commands:
  *		date
@@ -31,6 +33,7 @@
  *		shInit(): initalize the shell
  *		shProcessCmdLine(): read in and process the command line
  *		shExecuteCmd(): execute the command
+ *		shExecutePipeline(): run the commands of a pipeline as processes
  *		shParseCmdLine(): parse the command line into its arguments
  *		shReset_p(): initalize storage for reading in the command line
  *		shGetWord_p(): retreive word from string
@@ -69,8 +72,9 @@
 #include "adc.h"
 #include "ctp.h"
 #include "usr.h"
-#include "delay.h"
 #include "rtc.h"
+#include "sync.h"
+#include "mq.h"
 
 /* global variables */
 
@@ -96,6 +100,7 @@ const int peripheralClock = 60000000;
 
 	/* initialize */
 	mcgInit();
+	utlCycleCounterInit();
 	sdramInit();
 	rtc_init();
 	uartInit(UART2_BASE_PTR, peripheralClock / KHzInHz, baud);
@@ -119,7 +124,7 @@ const int peripheralClock = 60000000;
 
 		if (!usrLogin()){
 			SVCprintStr("\r\n");
-			delay(0xe1a7f);
+			SVCsleep(50);
 			exit(0);
 		}
 
@@ -155,7 +160,19 @@ utlStatus_t shInit() {
 		return sts;
 
 	/* create the first pcb link:  PCB for shell with pid = 0 */
-	shPcbLink_p = pcbAdd(0, RUNNING, 0, 0, NULL);
+	if (pcbPoolInit() == -1){
+		utlRETURN(utlFAIL, utlFailERROR,
+				"shInit: failed to initialize PCB pools");
+	}
+	if (syncInit() == -1){
+		utlRETURN(utlFAIL, utlFailERROR,
+				"shInit: failed to initialize the synchronization objects");
+	}
+	if (mqInit() == -1){
+		utlRETURN(utlFAIL, utlFailERROR,
+				"shInit: failed to initialize the message queues");
+	}
+	shPcbLink_p = pcbAdd(RUNNING, 0, 0, NULL);
 	if (!shPcbLink_p){
 		utlRETURN(utlFAIL, utlFailERROR,
 				"shInit: failed to initialize File System");
@@ -182,6 +199,19 @@ utlStatus_t shInit() {
 				"shInit: failed to create variable list");
 	}
 
+	/* the reaper cleans up the processes that have ended */
+	pid_t reaperPid;
+	if (spawn(pcbReaper, 0, NULL, STACK_SIZE, 0, PCB_DEFAULT_PRIORITY, &reaperPid) == -1){
+		utlRETURN(utlFAIL, utlFailERROR,
+				"shInit: failed to spawn the reaper");
+	}
+
+	/* the idle process runs while no other one is ready */
+	if (pcbIdleInit() == -1){
+		utlRETURN(utlFAIL, utlFailERROR,
+				"shInit: failed to spawn the idle process");
+	}
+
 	return (sts);
 }
 
@@ -227,17 +257,12 @@ utlStatus_t shProcessCmdLine() {
  */
 char * shReset_p() {
 	char * line_p;
-	line_p = (char *) SVCMalloc(shMAX_BUFFERSIZE + 1);
+	line_p = (char *) SVCCalloc(shMAX_BUFFERSIZE + 1, sizeof(char));
 	if (line_p == NULL) {
-		utlPrintSysERROR("shReset_p:: myMalloc");
+		utlPrintSysERROR("shReset_p:: myCalloc");
 		utlRETURN(NULL, utlMemERROR, "shReset_p");
 	}
 
-	unsigned i;
-	for (i = 0; i <= shMAX_BUFFERSIZE; i++){
-		line_p[i] = '\0';
-	}
-
 	return (line_p);
 }
 
@@ -303,6 +328,8 @@ utlErrno_t shParseCmdLine(char *line_p, shArg_t *arg_p) {
 
 	char *input_p = line_p;
 
+	arg_p->memQuota = 0;
+	arg_p->priority = PCB_DEFAULT_PRIORITY;
 	for (arg_p->argc = 0; shGetWord_p(&input_p) != NULL; arg_p->argc++){
 		;
 	}
@@ -321,13 +348,27 @@ utlErrno_t shParseCmdLine(char *line_p, shArg_t *arg_p) {
 		utlRETURN(utlArgNumERROR, utlNoCmdERROR, "shParseCmdLine");
 	}
 
-	unsigned i;
+	int i;
+	bool separator = true; /* no stage before the first word */
 
+	/* the stages of a pipeline are separated by NULL pointers too, set as the words
+	 * are read: a quoted word keeps its quotes until the command strips them, so a
+	 * quoted "|" is an argument. no stage may be empty
+	 */
 	for (i = 0; (i < arg_p->argc); i++) {
 		arg_p->argv[i] = shGetWord_p(&line_p);
 		if (arg_p->argv[i] == NULL){
 			utlRETURN(utlArgValERROR, utlErrno, "shParseCmdLine");
 		}
+		if ((arg_p->argv[i][0] != '"') && utlStrCmp(arg_p->argv[i], shPIPE_SYMBOL)) {
+			if (separator || (i == arg_p->argc - 1)) {
+				utlRETURN(utlArgValERROR, utlArgValERROR, "shParseCmdLine: empty pipeline stage");
+			}
+			arg_p->argv[i] = NULL;
+			separator = true;
+		} else {
+			separator = false;
+		}
 	}
 
 	/* final NULL pointer for argv array, as required by C standard */
@@ -348,6 +389,14 @@ utlStatus_t shExecuteCmd(int argc, char *argv_p[]) {
 	utlStatus_t sts = utlSUCCESS;
 
 	int i;
+	for (i = 0; (i < argc) && (argv_p[i] != NULL); i++) {
+		;
+	}
+	if (i < argc) {
+		/* more than one stage */
+		return shExecutePipeline(argc, argv_p);
+	}
+
 	i = cmdMatch(argv_p[0]);
 	if (i < 0){
 		utlRETURN(sts, utlInvCmdERROR, "shExecuteCmd: command not found");
@@ -358,6 +407,84 @@ utlStatus_t shExecuteCmd(int argc, char *argv_p[]) {
 	return (sts);
 }
 
+/* runs a pipeline: the stages are separated by NULL pointers in argv_p, as
+ * set by shParseCmdLine. each stage runs as a process, with STDOUT bound to a
+ * pipe that STDIN of the next stage reads from; the first stage reads from,
+ * and the last one writes to, the UART. the shell waits for all the stages to
+ * end, and prints the error of any that fails. Returns the error status.
+ *
+ * param: int argc, char *argv_p[]
+ * return: utlStatus_t
+ */
+utlStatus_t shExecutePipeline(int argc, char *argv_p[]) {
+	utlStatus_t sts = utlSUCCESS;
+	char **stage_p[shPIPE_MAX_STAGES];
+	int stageArgc[shPIPE_MAX_STAGES];
+	int cmd[shPIPE_MAX_STAGES];
+	Pipe *pipe_p[shPIPE_MAX_STAGES - 1];
+	pid_t stagePid[shPIPE_MAX_STAGES];
+	int stages = 0;
+	int i, start;
+
+	/* split the arguments into stages, and match their commands */
+	for (start = 0; start <= argc; start = i + 1) {
+		for (i = start; (i < argc) && (argv_p[i] != NULL); i++) {
+			;
+		}
+		if (stages == shPIPE_MAX_STAGES) {
+			utlRETURN(sts, utlArgNumERROR, "shExecutePipeline: too many stages");
+		}
+		stage_p[stages] = &argv_p[start];
+		stageArgc[stages] = i - start;
+		cmd[stages] = cmdMatch(argv_p[start]);
+		if (cmd[stages] < 0) {
+			utlRETURN(sts, utlInvCmdERROR, argv_p[start]);
+		}
+		stages++;
+	}
+
+	for (i = 0; i < stages - 1; i++) {
+		pipe_p[i] = SVCpipeCreate();
+		if (pipe_p[i] == NULL) {
+			for (i--; i >= 0; i--) {
+				SVCpipeRelease(pipe_p[i]);
+			}
+			utlRETURN(sts, utlMemERROR, "shExecutePipeline: pipe");
+		}
+	}
+
+	/* spawn the stages; the shell holds both ends of the pipes until all are bound */
+	shArg_t arg;
+	arg.memQuota = 0;
+	arg.priority = PCB_DEFAULT_PRIORITY;
+	for (i = 0; i < stages; i++) {
+		arg.argc = stageArgc[i];
+		arg.argv = stage_p[i];
+		arg.stdin_p = (i > 0) ? pipe_p[i - 1] : NULL;
+		arg.stdout_p = (i < stages - 1) ? pipe_p[i] : NULL;
+		if (SVCspawn(commands[cmd[i]].functionp, &arg, shPIPE_STACK_SIZE, &stagePid[i]) == -1) {
+			stagePid[i] = -1;
+			utlErrno = utlFailERROR;
+			utlPrintERROR(stage_p[i][0]);
+		}
+	}
+	for (i = 0; i < stages - 1; i++) {
+		SVCpipeRelease(pipe_p[i]);
+	}
+
+	/* the arguments of the stages are freed by shDone, so all of them are waited for */
+	for (i = 0; i < stages; i++) {
+		int status;
+		if ((stagePid[i] != -1) && (SVCwait(stagePid[i], &status) == 0)
+				&& (status != utlNoERROR)) {
+			utlErrno = status;
+			utlPrintERROR(stage_p[i][0]);
+		}
+	}
+
+	return (sts);
+}
+
 /* helper function for parsing the line. Finds the next word in the line
  * (determined by whitespace) and returns it.
  *
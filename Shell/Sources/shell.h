@@ -12,6 +12,10 @@
 typedef struct arg{
 	int argc;
 	char **argv;
+	unsigned memQuota; /* spawn only: bytes the new process may allocate; 0 for no limit */
+	int priority;      /* spawn only: priority of the new process, 0 being the highest */
+	struct Pipe_s *stdin_p;  /* spawn only: pipe STDIN reads from; NULL keeps the UART */
+	struct Pipe_s *stdout_p; /* spawn only: pipe STDOUT writes to; NULL keeps the UART */
 } shArg_t;
 
 typedef struct args{
@@ -33,6 +37,11 @@ typedef struct var{
 /* macros */
 #define shWhiteSPACE(A) ((A == ' ') || (A == '\t') || (A == '\n') || (A == '\r'))
 
+/* constants */
+#define shPIPE_SYMBOL "|"        /* separates the stages of a pipeline; a word of its own */
+#define shPIPE_MAX_STAGES 8
+#define shPIPE_STACK_SIZE 4096   /* stack of the process running a stage */
+
 
 /* global variable declarations */
 #ifndef ALLOCATE_
@@ -52,6 +61,7 @@ PcbLink *firstLink_p; //variable for the first pcb (the shell)
 utlStatus_t shInit (void);
 utlStatus_t shProcessCmdLine(void);
 utlStatus_t shExecuteCmd(int argc, char *argv_p[]);
+utlStatus_t shExecutePipeline(int argc, char *argv_p[]);
 utlErrno_t shParseCmdLine(char *line_p, shArg_t *arg_p);
 char * shReset_p (void);
 char * shGetWord_p(char **line_p);
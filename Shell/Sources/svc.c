@@ -75,6 +75,8 @@
 #include "utl.h"
 #include "shell.h"
 #include "rtc.h"
+#include "systick.h"
+#include "wheel.h"
 
 #define XPSR_FRAME_ALIGNED_BIT 9
 #define XPSR_FRAME_ALIGNED_MASK (1<<XPSR_FRAME_ALIGNED_BIT)
@@ -86,13 +88,23 @@ struct frame {
 		char *str0;
 		char c; //for fputc
 		unsigned int size0; //for myMalloc
-		void *address; //for myFree/myFreeErrorCode and the return for myMalloc
+		unsigned int nmemb; //for myCalloc
+		unsigned int alignment; //for myMemalign
+		void *address; //for myFree/myFreeErrorCode, myfread/myfwrite and the return for myMalloc
 		int returnVal;
 		MemErrno err; //for myFreeErrorCode
+		MemStats *stats_p; //for memGetStats
+		FioStats *fioStats_p; //for fioGetStats
+		PcbInfo *info_p; //for pcbGetInfo
+		SyncType syncType; //for syncCreate
+		int handle; //for the sync objects and message queues
+		unsigned int capacity; //for mqCreate
+		Pipe *pipe_p; //for the pipes
 		myFILE fi1; //for file commands
 		uint16_t frequ;
 		uint32_t hi32;
 		uint32_t *hi32_p;
+		uint32_t ms; //for sleep
 		pid_t targetPid;
 		utlErrno_t (*main)(int argc, char *argv[]);
 	};
@@ -101,10 +113,13 @@ struct frame {
 		int arg1;
 		char *str1;
 		myFILE fi2; //for file commands
+		unsigned int size1; //for myRealloc, myCalloc and myMemalign
 		uint32_t low32;
 		uint32_t *low32_p;
 		void (*func_p)();
 		shArg_t *arg;
+		int *status_p; //for wait
+		void *msg_p; //for the message queues
 	};
 	union {
 		int r2;
@@ -112,12 +127,14 @@ struct frame {
 		char *str2;
 		myFILE fi3;
 		uint32_t stackSize;
+		unsigned int size2; //for the message queues
 	};
 	union {
 		int r3;
 		int arg3;
 		char *str3;
 		pid_t *spawnedPidPtr;
+		uint32_t ms3; //for mqTimedReceive
 	};
 	int r12;
 	union {
@@ -302,7 +319,7 @@ int __attribute__((naked)) __attribute__((noinline)) SVCmyKill(pid_t targetPid)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wreturn-type"
-void __attribute__((naked)) __attribute__((noinline)) SVCwait(pid_t targetPid) {
+int __attribute__((naked)) __attribute__((noinline)) SVCwait(pid_t targetPid, int *status_p) {
 	__asm("svc %0" : : "I" (SVC_WAIT));
 	__asm("bx lr");
 }
@@ -356,6 +373,230 @@ uint32_t __attribute__((naked)) __attribute__((noinline)) SVCgetRTC(void) {
 }
 #pragma GCC diagnostic pop
 
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+MemErrno __attribute__((naked)) __attribute__((noinline)) SVCmemStats(MemStats *stats_p) {
+	__asm("svc %0" : : "I" (SVC_MEM_STATS));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+void * __attribute__((naked)) __attribute__((noinline)) SVCRealloc(void *address, unsigned int size1) {
+	__asm("svc %0" : : "I" (SVC_REALLOC));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+void * __attribute__((naked)) __attribute__((noinline)) SVCCalloc(unsigned int nmemb, unsigned int size1) {
+	__asm("svc %0" : : "I" (SVC_CALLOC));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+void * __attribute__((naked)) __attribute__((noinline)) SVCMemalign(unsigned int alignment, unsigned int size1) {
+	__asm("svc %0" : : "I" (SVC_MEMALIGN));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCpcbInfo(PcbInfo *info_p, int arg1) {
+	__asm("svc %0" : : "I" (SVC_PCB_INFO));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCsetPriority(pid_t targetPid, int arg1) {
+	__asm("svc %0" : : "I" (SVC_SET_PRIORITY));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+void __attribute__((naked)) __attribute__((noinline)) SVCsleep(uint32_t ms) {
+	__asm("svc %0" : : "I" (SVC_SLEEP));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+uint32_t __attribute__((naked)) __attribute__((noinline)) SVCidleTime(void) {
+	__asm("svc %0" : : "I" (SVC_IDLE_TIME));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+void __attribute__((naked)) __attribute__((noinline)) SVCreap(void) {
+	__asm("svc %0" : : "I" (SVC_REAP));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCsyncCreate(SyncType syncType, int arg1) {
+	__asm("svc %0" : : "I" (SVC_SYNC_CREATE));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCsyncDestroy(int handle) {
+	__asm("svc %0" : : "I" (SVC_SYNC_DESTROY));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCsemWait(int handle) {
+	__asm("svc %0" : : "I" (SVC_SEM_WAIT));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCsemPost(int handle) {
+	__asm("svc %0" : : "I" (SVC_SEM_POST));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCmutexLock(int handle) {
+	__asm("svc %0" : : "I" (SVC_MUTEX_LOCK));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCmutexUnlock(int handle) {
+	__asm("svc %0" : : "I" (SVC_MUTEX_UNLOCK));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCcondWait(int handle, int arg1) {
+	__asm("svc %0" : : "I" (SVC_COND_WAIT));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCcondSignal(int handle, int arg1) {
+	__asm("svc %0" : : "I" (SVC_COND_SIGNAL));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCmqCreate(unsigned int capacity, unsigned int size1, int arg2) {
+	__asm("svc %0" : : "I" (SVC_MQ_CREATE));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCmqDestroy(int handle) {
+	__asm("svc %0" : : "I" (SVC_MQ_DESTROY));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCmqSend(int handle, void *msg_p, unsigned int size2) {
+	__asm("svc %0" : : "I" (SVC_MQ_SEND));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCmqReceive(int handle, void *msg_p, unsigned int size2) {
+	__asm("svc %0" : : "I" (SVC_MQ_RECEIVE));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCmqTimedReceive(int handle, void *msg_p, unsigned int size2, uint32_t ms3) {
+	__asm("svc %0" : : "I" (SVC_MQ_TIMED_RECEIVE));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+Pipe * __attribute__((naked)) __attribute__((noinline)) SVCpipeCreate(void) {
+	__asm("svc %0" : : "I" (SVC_PIPE_CREATE));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCpipeRelease(Pipe *pipe_p) {
+	__asm("svc %0" : : "I" (SVC_PIPE_RELEASE));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCsetQuantum(pid_t targetPid, int arg1) {
+	__asm("svc %0" : : "I" (SVC_SET_QUANTUM));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCFRead(void *address, int arg1, myFILE fi3) {
+	__asm("svc %0" : : "I" (SVC_FREAD));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCFWrite(void *address, int arg1, myFILE fi3) {
+	__asm("svc %0" : : "I" (SVC_FWRITE));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+int __attribute__((naked)) __attribute__((noinline)) SVCfsStats(FioStats *stats_p) {
+	__asm("svc %0" : : "I" (SVC_FS_STATS));
+	__asm("bx lr");
+}
+#pragma GCC diagnostic pop
+
 /* This function sets the priority at which the SVCall handler runs (See
  * B3.2.11, System Handler Priority Register 2, SHPR2 on page B3-723 of
  * the ARM®v7-M Architecture Reference Manual, ARM DDI 0403Derrata
@@ -487,9 +728,33 @@ void SvcGetClockImpl(uint32_t *h, uint32_t *l){
 	*l = flexTimerGetClockLow();
 }
 
+/* spawns a process; its STDIN and STDOUT are bound to the pipes in arg,
+ * if any, before it first runs. the process is created blocked, with the
+ * scheduler unlocked; only binding it and making it ready is locked
+ */
 int SvcSpawnImpl(utlErrno_t main(int argc, char *argv[]), shArg_t *arg,
 		uint32_t stackSize, pid_t *spawnedPidPtr){
-	return spawn(main, arg->argc, arg->argv, stackSize, spawnedPidPtr);
+	if (spawnCreate(main, arg->argc, arg->argv, stackSize, arg->memQuota,
+			arg->priority, spawnedPidPtr) == -1) {
+		return -1;
+	}
+
+	schedLock();
+	ProcessControlBlock *pcb_p = findPCB(*spawnedPidPtr);
+	if (pcb_p == NULL) {
+		/* killed, and cleaned up, before it ever ran */
+		schedUnlock();
+		return -1;
+	}
+	if (arg->stdin_p != NULL) {
+		pipeBind(pcb_p, STDIN, arg->stdin_p);
+	}
+	if (arg->stdout_p != NULL) {
+		pipeBind(pcb_p, STDOUT, arg->stdout_p);
+	}
+	pcbSetState(pcb_p, READY);
+	schedUnlock();
+	return 0;
 }
 
 void svcHandlerInC(struct frame *framePtr) {
@@ -526,14 +791,10 @@ void svcHandlerInC(struct frame *framePtr) {
 		framePtr->err = myFreeErrorCode(framePtr->address, 0);
 		break;
 	case SVC_PRINTSTR:
-		di();
 		printStr(framePtr->str0);
-		ei();
 		break;
 	case SVC_GETCHAR:
-		di();
 		framePtr->c = getChar(true);
-		ei();
 		break;
 	case SVC_PDB:
 		SVCpcbInitImpl(framePtr->frequ, framePtr->func_p);
@@ -571,15 +832,13 @@ void svcHandlerInC(struct frame *framePtr) {
 		framePtr->returnVal = myKill(framePtr->targetPid);
 		break;
 	case SVC_WAIT:
-		wait(framePtr->targetPid);
+		framePtr->returnVal = wait(framePtr->targetPid, framePtr->status_p);
 		break;
 	case SVC_PID:
 		framePtr->targetPid = pid();
 		break;
 	case SVC_GETCHAR_NOECH:
-		di();
 		framePtr->c = getChar(false);
-		ei();
 		break;
 	case SVC_FPUTS:
 		framePtr->returnVal = myfputs(framePtr->str0, framePtr->fi2);
@@ -593,6 +852,92 @@ void svcHandlerInC(struct frame *framePtr) {
 	case SVC_GET_RTC:
 		framePtr->hi32 = get_time();
 		break;
+	case SVC_MEM_STATS:
+		framePtr->err = memGetStats(framePtr->stats_p);
+		break;
+	case SVC_REALLOC:
+		framePtr->address = myRealloc(framePtr->address, framePtr->size1);
+		break;
+	case SVC_CALLOC:
+		framePtr->address = myCalloc(framePtr->nmemb, framePtr->size1);
+		break;
+	case SVC_MEMALIGN:
+		framePtr->address = myMemalign(framePtr->alignment, framePtr->size1);
+		break;
+	case SVC_PCB_INFO:
+		framePtr->returnVal = pcbGetInfo(framePtr->info_p, framePtr->arg1);
+		break;
+	case SVC_SET_PRIORITY:
+		framePtr->returnVal = setPriority(framePtr->targetPid, framePtr->arg1);
+		break;
+	case SVC_SLEEP:
+		wheelSleep(framePtr->ms);
+		break;
+	case SVC_IDLE_TIME:
+		framePtr->hi32 = schedIdleMs();
+		break;
+	case SVC_REAP:
+		pcbReap();
+		break;
+	case SVC_SYNC_CREATE:
+		framePtr->returnVal = syncCreate(framePtr->syncType, framePtr->arg1);
+		break;
+	case SVC_SYNC_DESTROY:
+		framePtr->returnVal = syncDestroy(framePtr->handle);
+		break;
+	case SVC_SEM_WAIT:
+		framePtr->returnVal = syncSemWait(framePtr->handle);
+		break;
+	case SVC_SEM_POST:
+		framePtr->returnVal = syncSemPost(framePtr->handle);
+		break;
+	case SVC_MUTEX_LOCK:
+		framePtr->returnVal = syncMutexLock(framePtr->handle);
+		break;
+	case SVC_MUTEX_UNLOCK:
+		framePtr->returnVal = syncMutexUnlock(framePtr->handle);
+		break;
+	case SVC_COND_WAIT:
+		framePtr->returnVal = syncCondWait(framePtr->handle, framePtr->arg1);
+		break;
+	case SVC_COND_SIGNAL:
+		framePtr->returnVal = syncCondSignal(framePtr->handle, framePtr->arg1 != 0);
+		break;
+	case SVC_MQ_CREATE:
+		framePtr->returnVal = mqCreate(framePtr->capacity, framePtr->size1, framePtr->arg2);
+		break;
+	case SVC_MQ_DESTROY:
+		framePtr->returnVal = mqDestroy(framePtr->handle);
+		break;
+	case SVC_MQ_SEND:
+		framePtr->returnVal = mqSend(framePtr->handle, framePtr->msg_p, framePtr->size2);
+		break;
+	case SVC_MQ_RECEIVE:
+		framePtr->returnVal = mqReceive(framePtr->handle, framePtr->msg_p, framePtr->size2,
+				MQ_WAIT_FOREVER);
+		break;
+	case SVC_MQ_TIMED_RECEIVE:
+		framePtr->returnVal = mqReceive(framePtr->handle, framePtr->msg_p, framePtr->size2,
+				framePtr->ms3);
+		break;
+	case SVC_PIPE_CREATE:
+		framePtr->pipe_p = pipeCreate();
+		break;
+	case SVC_PIPE_RELEASE:
+		framePtr->returnVal = pipeRelease(framePtr->pipe_p);
+		break;
+	case SVC_SET_QUANTUM:
+		framePtr->returnVal = setQuantum(framePtr->targetPid, (uint32_t) framePtr->arg1);
+		break;
+	case SVC_FREAD:
+		framePtr->returnVal = myfread(framePtr->address, framePtr->arg1, framePtr->fi3);
+		break;
+	case SVC_FWRITE:
+		framePtr->returnVal = myfwrite(framePtr->address, framePtr->arg1, framePtr->fi3);
+		break;
+	case SVC_FS_STATS:
+		framePtr->returnVal = fioGetStats(framePtr->fioStats_p);
+		break;
 	default:
 		uartPuts(UART2_BASE_PTR, "Unknown SVC has been called\r\n");
 	}
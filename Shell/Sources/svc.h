@@ -15,6 +15,9 @@
 #include "fio.h"
 #include "mem.h"
 #include "shell.h"
+#include "sync.h"
+#include "mq.h"
+#include "pipe.h"
 
 #define SVC_MaxPriority 15
 #define SVC_PriorityShift 4
@@ -49,6 +52,34 @@
 #define SVC_FGETS 25
 #define SVC_SET_RTC 26
 #define SVC_GET_RTC 27
+#define SVC_MEM_STATS 28
+#define SVC_REALLOC 29
+#define SVC_CALLOC 30
+#define SVC_MEMALIGN 31
+#define SVC_PCB_INFO 32
+#define SVC_SET_PRIORITY 33
+#define SVC_SLEEP 34
+#define SVC_IDLE_TIME 35
+#define SVC_REAP 36
+#define SVC_SYNC_CREATE 37
+#define SVC_SYNC_DESTROY 38
+#define SVC_SEM_WAIT 39
+#define SVC_SEM_POST 40
+#define SVC_MUTEX_LOCK 41
+#define SVC_MUTEX_UNLOCK 42
+#define SVC_COND_WAIT 43
+#define SVC_COND_SIGNAL 44
+#define SVC_MQ_CREATE 45
+#define SVC_MQ_DESTROY 46
+#define SVC_MQ_SEND 47
+#define SVC_MQ_RECEIVE 48
+#define SVC_MQ_TIMED_RECEIVE 49
+#define SVC_PIPE_CREATE 50
+#define SVC_PIPE_RELEASE 51
+#define SVC_SET_QUANTUM 52
+#define SVC_FREAD 53
+#define SVC_FWRITE 54
+#define SVC_FS_STATS 55
 
 
 void svcInit_SetSVCPriority(unsigned char priority);
@@ -76,13 +107,41 @@ void SVCblock(void);
 int SVCblockPid(pid_t targetPid);
 int SVCwake(pid_t targetPid);
 int SVCmyKill(pid_t targetPid);
-void SVCwait(pid_t targetPid);
+int SVCwait(pid_t targetPid, int *status_p);
 pid_t SVCpid(void);
 char SVCgetCharNoEch();
 int SVCFPuts(char *str0, myFILE fi2);
 int SVCFGets(char *str0, int arg1, myFILE fi3);
 void SVCsetRTC(uint32_t hi32);
 uint32_t SVCgetRTC(void);
+MemErrno SVCmemStats(MemStats *stats_p);
+void *SVCRealloc(void *address, unsigned int size1);
+void *SVCCalloc(unsigned int nmemb, unsigned int size1);
+void *SVCMemalign(unsigned int alignment, unsigned int size1);
+int SVCpcbInfo(PcbInfo *info_p, int arg1);
+int SVCsetPriority(pid_t targetPid, int arg1);
+void SVCsleep(uint32_t ms);
+uint32_t SVCidleTime(void);
+void SVCreap(void);
+int SVCsyncCreate(SyncType syncType, int arg1);
+int SVCsyncDestroy(int handle);
+int SVCsemWait(int handle);
+int SVCsemPost(int handle);
+int SVCmutexLock(int handle);
+int SVCmutexUnlock(int handle);
+int SVCcondWait(int handle, int arg1);
+int SVCcondSignal(int handle, int arg1);
+int SVCmqCreate(unsigned int capacity, unsigned int size1, int arg2);
+int SVCmqDestroy(int handle);
+int SVCmqSend(int handle, void *msg_p, unsigned int size2);
+int SVCmqReceive(int handle, void *msg_p, unsigned int size2);
+int SVCmqTimedReceive(int handle, void *msg_p, unsigned int size2, uint32_t ms3);
+Pipe *SVCpipeCreate(void);
+int SVCpipeRelease(Pipe *pipe_p);
+int SVCsetQuantum(pid_t targetPid, int arg1);
+int SVCFRead(void *address, int arg1, myFILE fi3);
+int SVCFWrite(void *address, int arg1, myFILE fi3);
+int SVCfsStats(FioStats *stats_p);
 
 void SvcGetClockImpl(uint32_t *h, uint32_t *l);
 
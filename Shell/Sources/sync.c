@@ -0,0 +1,421 @@
+/* sync.c contains the synchronization objects processes share: counting
+ * semaphores, mutexes and condition variables, used through supervisor calls.
+ *
+ * an object is taken from a pool and named by a handle, the index of its entry
+ * in the handle table with the generation of the entry above it, so a handle
+ * left over from a destroyed object is refused. a process waiting on an object
+ * sleeps on its wait queue. a semaphore count and a mutex are handed straight
+ * to the process woken, so no other process can take them in between.
+ *
+ * a mutex passes the priority of the processes waiting for it on to its holder
+ * (priority inheritance), and on to the holder of the mutex that one waits for,
+ * so that a low priority holder cannot keep a high priority process waiting
+ * behind the processes of the priorities in between. the holder goes back to
+ * its own priority as it unlocks.
+ *
+ * when a process is cleaned up, the mutexes it still holds are handed on, and
+ * the objects it created are destroyed.
+ *
+ * all the functions are called in the SVC handler, and work with the
+ * scheduler locked.
+ *
+ * Primary functions:
+ *		syncCreate(): create a semaphore, mutex or condition variable
+ *		syncDestroy(): destroy it, failing the waits on it
+ *		syncSemWait()/syncSemPost(): take/give a semaphore count
+ *		syncMutexLock()/syncMutexUnlock(): lock/unlock a mutex
+ *		syncCondWait()/syncCondSignal(): wait for/signal a condition
+ *		syncExit(): clean up after a process
+ */
+
+/* sys include files */
+#include <stdlib.h>
+#include <limits.h>
+
+/* project headers */
+#include "sync.h"
+#include "pcb.h"
+#include "pool.h"
+#include "shell.h"
+#include "utl.h"
+
+Pool syncPool;
+SyncObj *syncTable_p[SYNC_MAX_OBJECTS];
+int syncTableGen[SYNC_MAX_OBJECTS];
+int syncNextFree[SYNC_MAX_OBJECTS];
+int syncFirstFree = 0;
+
+/* internal function declarations - to be used by the sync objects only */
+SyncObj *syncFind_p(int handle, SyncType type);
+void syncDestroyObj(SyncObj *obj_p);
+void syncTake(SyncObj *mutex_p, PcbLink *link_p);
+void syncRelease(SyncObj *mutex_p);
+void syncInherit(SyncObj *mutex_p, int priority);
+PcbLink *syncTopWaiter_p(SyncObj *obj_p);
+
+/* function definitions */
+
+/* create the pool of objects and the handle table; must be called before the
+ * first object is created. returns -1 if fails
+ */
+int syncInit(void) {
+	int i;
+
+	if (poolCreate(&syncPool, sizeof(SyncObj), SYNC_POOL_CHUNK) == -1) {
+		return -1;
+	}
+	for (i = 0; i < SYNC_MAX_OBJECTS; i++) {
+		syncTable_p[i] = NULL;
+		syncTableGen[i] = 0;
+		syncNextFree[i] = i + 1;
+	}
+	syncFirstFree = 0;
+	return 0;
+}
+
+/* create an object of the given type; count is the initial count of a
+ * semaphore. returns the handle of the object, or -1 if fails
+ */
+int syncCreate(SyncType type, int count) {
+	SyncObj *obj_p;
+	int slot;
+
+	if ((type < SYNC_SEMAPHORE) || (type > SYNC_CONDITION)
+			|| ((type == SYNC_SEMAPHORE) && (count < 0))) {
+		return -1;
+	}
+
+	obj_p = poolGet(&syncPool);
+	if (obj_p == NULL) {
+		return -1;
+	}
+
+	schedLock();
+	slot = syncFirstFree;
+	if (slot >= SYNC_MAX_OBJECTS) {
+		schedUnlock();
+		poolPut(&syncPool, obj_p);
+		return -1;
+	}
+	syncFirstFree = syncNextFree[slot];
+
+	obj_p->type = type;
+	obj_p->handle = (syncTableGen[slot] << SYNC_SLOT_BITS) | slot;
+	obj_p->owner = pid();
+	obj_p->count = (type == SYNC_SEMAPHORE) ? count : 0;
+	obj_p->holder_p = NULL;
+	obj_p->nextHeld_p = NULL;
+	pcbWaitQueueInit(&obj_p->waiters);
+	syncTable_p[slot] = obj_p;
+	schedUnlock();
+
+	return obj_p->handle;
+}
+
+/* destroy an object; the processes waiting on it are woken, and their waits
+ * fail. returns -1 if there is no such object
+ */
+int syncDestroy(int handle) {
+	SyncObj *obj_p;
+
+	schedLock();
+	if ((handle < 0) || ((obj_p = syncTable_p[handle & (SYNC_MAX_OBJECTS - 1)]) == NULL)
+			|| (obj_p->handle != handle)) {
+		schedUnlock();
+		return -1;
+	}
+	syncDestroyObj(obj_p);
+	schedUnlock();
+	return 0;
+}
+
+/* take a count of a semaphore, waiting for one if there is none.
+ * returns -1 if there is no such semaphore, or it is destroyed meanwhile
+ */
+int syncSemWait(int handle) {
+	PcbLink *self_p = shPcbLink_p;
+	SyncObj *sem_p;
+	int success = -1;
+
+	schedLock();
+	self_p->pcb.syncGranted = false;
+	/* woken for another reason, the caller looks at the count again */
+	while ((sem_p = syncFind_p(handle, SYNC_SEMAPHORE)) != NULL) {
+		if (self_p->pcb.syncGranted) {
+			success = 0;
+			break;
+		}
+		if (sem_p->count > 0) {
+			sem_p->count--;
+			success = 0;
+			break;
+		}
+		pcbSleepOn(&sem_p->waiters);
+	}
+	schedUnlock();
+	return success;
+}
+
+/* give a count to a semaphore; it goes to the first process waiting, if any.
+ * returns -1 if there is no such semaphore
+ */
+int syncSemPost(int handle) {
+	SyncObj *sem_p;
+	PcbLink *waiter_p;
+	int success = -1;
+
+	schedLock();
+	sem_p = syncFind_p(handle, SYNC_SEMAPHORE);
+	if (sem_p != NULL) {
+		if ((waiter_p = sem_p->waiters.first_p) != NULL) {
+			waiter_p->pcb.syncGranted = true;
+			pcbSetState(&waiter_p->pcb, READY);
+			success = 0;
+		} else if (sem_p->count < INT_MAX) {
+			sem_p->count++;
+			success = 0;
+		}
+	}
+	schedUnlock();
+	return success;
+}
+
+/* lock a mutex, waiting for it if it is held; the holder runs at the priority
+ * of the caller meanwhile, if that is higher. returns -1 if there is no such
+ * mutex, it is destroyed meanwhile, or the caller holds it already
+ */
+int syncMutexLock(int handle) {
+	PcbLink *self_p = shPcbLink_p;
+	SyncObj *mutex_p;
+	int success = -1;
+
+	schedLock();
+	mutex_p = syncFind_p(handle, SYNC_MUTEX);
+	if ((mutex_p == NULL) || (mutex_p->holder_p == self_p)) {
+		schedUnlock();
+		return -1;
+	}
+
+	self_p->pcb.syncGranted = false;
+	while (syncFind_p(handle, SYNC_MUTEX) == mutex_p) {
+		if (self_p->pcb.syncGranted) {
+			success = 0;
+			break;
+		}
+		if (mutex_p->holder_p == NULL) {
+			syncTake(mutex_p, self_p);
+			success = 0;
+			break;
+		}
+		self_p->pcb.blockedOn_p = mutex_p;
+		syncInherit(mutex_p, self_p->pcb.priority);
+		pcbSleepOn(&mutex_p->waiters);
+		self_p->pcb.blockedOn_p = NULL;
+	}
+	schedUnlock();
+	return success;
+}
+
+/* unlock a mutex held by the caller; it goes to the highest priority process
+ * waiting for it. returns -1 if there is no such mutex, or the caller does
+ * not hold it
+ */
+int syncMutexUnlock(int handle) {
+	SyncObj *mutex_p;
+	int success = -1;
+
+	schedLock();
+	mutex_p = syncFind_p(handle, SYNC_MUTEX);
+	if ((mutex_p != NULL) && (mutex_p->holder_p == shPcbLink_p)) {
+		syncRelease(mutex_p);
+		success = 0;
+	}
+	schedUnlock();
+	return success;
+}
+
+/* unlock a mutex held by the caller and wait on a condition variable, in one
+ * step, then lock the mutex again. the wait may also end without a signal, so
+ * the caller checks its condition again. returns -1 if there is no such
+ * condition variable or mutex, or the caller does not hold the mutex
+ */
+int syncCondWait(int condHandle, int mutexHandle) {
+	SyncObj *cond_p;
+	SyncObj *mutex_p;
+	int success = -1;
+
+	schedLock();
+	cond_p = syncFind_p(condHandle, SYNC_CONDITION);
+	mutex_p = syncFind_p(mutexHandle, SYNC_MUTEX);
+	if ((cond_p != NULL) && (mutex_p != NULL) && (mutex_p->holder_p == shPcbLink_p)) {
+		syncRelease(mutex_p);
+		pcbSleepOn(&cond_p->waiters);
+		success = syncMutexLock(mutexHandle);
+	}
+	schedUnlock();
+	return success;
+}
+
+/* wake the first process waiting on a condition variable, or all of them.
+ * returns -1 if there is no such condition variable
+ */
+int syncCondSignal(int handle, bool all) {
+	SyncObj *cond_p;
+	int success = -1;
+
+	schedLock();
+	cond_p = syncFind_p(handle, SYNC_CONDITION);
+	if (cond_p != NULL) {
+		if (all) {
+			pcbWakeAll(&cond_p->waiters);
+		} else {
+			pcbWakeOne(&cond_p->waiters);
+		}
+		success = 0;
+	}
+	schedUnlock();
+	return success;
+}
+
+/* the priority a process is to run at: its own, or that of the highest
+ * priority process waiting for a mutex it holds, if that is higher
+ */
+int syncPriority(ProcessControlBlock *pcb_p) {
+	int priority = pcb_p->basePriority;
+	SyncObj *mutex_p;
+	PcbLink *waiter_p;
+
+	for (mutex_p = pcb_p->held_p; mutex_p != NULL; mutex_p = mutex_p->nextHeld_p) {
+		waiter_p = syncTopWaiter_p(mutex_p);
+		if ((waiter_p != NULL) && (waiter_p->pcb.priority < priority)) {
+			priority = waiter_p->pcb.priority;
+		}
+	}
+	return priority;
+}
+
+/* clean up after a process: the mutexes it still holds go to their next
+ * waiter, and the objects it created are destroyed
+ */
+void syncExit(ProcessControlBlock *pcb_p) {
+	int i;
+
+	schedLock();
+	while (pcb_p->held_p != NULL) {
+		syncRelease(pcb_p->held_p);
+	}
+	for (i = 0; i < SYNC_MAX_OBJECTS; i++) {
+		if ((syncTable_p[i] != NULL) && (syncTable_p[i]->owner == pcb_p->processID)) {
+			syncDestroyObj(syncTable_p[i]);
+		}
+	}
+	schedUnlock();
+}
+
+/* the object of a handle, if it is of the given type */
+SyncObj *syncFind_p(int handle, SyncType type) {
+	SyncObj *obj_p;
+
+	if (handle < 0) {
+		return NULL;
+	}
+	obj_p = syncTable_p[handle & (SYNC_MAX_OBJECTS - 1)];
+	if ((obj_p == NULL) || (obj_p->handle != handle) || (obj_p->type != type)) {
+		return NULL;
+	}
+	return obj_p;
+}
+
+/* free the entry of an object, and give the object back to the pool; the
+ * waiters find the handle no longer valid as they are woken
+ */
+void syncDestroyObj(SyncObj *obj_p) {
+	int slot = obj_p->handle & (SYNC_MAX_OBJECTS - 1);
+
+	if ((obj_p->type == SYNC_MUTEX) && (obj_p->holder_p != NULL)) {
+		PcbLink *holder_p = obj_p->holder_p;
+		SyncObj **mutex_pp = &holder_p->pcb.held_p;
+
+		while (*mutex_pp != obj_p) {
+			mutex_pp = &(*mutex_pp)->nextHeld_p;
+		}
+		*mutex_pp = obj_p->nextHeld_p;
+		obj_p->holder_p = NULL;
+		if (holder_p->pcb.state != KILL) {
+			pcbChangePriority(holder_p, syncPriority(&holder_p->pcb));
+		}
+	}
+
+	syncTable_p[slot] = NULL;
+	syncTableGen[slot] = (syncTableGen[slot] + 1) & SYNC_GEN_MASK;
+	syncNextFree[slot] = syncFirstFree;
+	syncFirstFree = slot;
+
+	pcbWakeAll(&obj_p->waiters);
+	poolPut(&syncPool, obj_p);
+}
+
+/* make a process the holder of a mutex */
+void syncTake(SyncObj *mutex_p, PcbLink *link_p) {
+	mutex_p->holder_p = link_p;
+	mutex_p->nextHeld_p = link_p->pcb.held_p;
+	link_p->pcb.held_p = mutex_p;
+}
+
+/* hand a mutex from its holder to the highest priority process waiting for
+ * it, or leave it unlocked; both run at the priority left to them after
+ */
+void syncRelease(SyncObj *mutex_p) {
+	PcbLink *holder_p = mutex_p->holder_p;
+	PcbLink *next_p = syncTopWaiter_p(mutex_p);
+	SyncObj **mutex_pp = &holder_p->pcb.held_p;
+
+	while (*mutex_pp != mutex_p) {
+		mutex_pp = &(*mutex_pp)->nextHeld_p;
+	}
+	*mutex_pp = mutex_p->nextHeld_p;
+	mutex_p->holder_p = NULL;
+
+	if (next_p != NULL) {
+		syncTake(mutex_p, next_p);
+		next_p->pcb.syncGranted = true;
+		next_p->pcb.blockedOn_p = NULL;
+		pcbSetState(&next_p->pcb, READY);
+		pcbChangePriority(next_p, syncPriority(&next_p->pcb));
+	}
+	if (holder_p->pcb.state != KILL) {
+		pcbChangePriority(holder_p, syncPriority(&holder_p->pcb));
+	}
+}
+
+/* raise the holder of a mutex to the given priority, and the holder of the
+ * mutex that one waits for, and so on, up to SYNC_PI_DEPTH holders
+ */
+void syncInherit(SyncObj *mutex_p, int priority) {
+	PcbLink *holder_p;
+	int depth;
+
+	for (depth = 0; (mutex_p != NULL) && (depth < SYNC_PI_DEPTH); depth++) {
+		holder_p = mutex_p->holder_p;
+		if ((holder_p == NULL) || (holder_p->pcb.priority <= priority)) {
+			break;
+		}
+		pcbChangePriority(holder_p, priority);
+		mutex_p = (holder_p->pcb.state == BLOCKED) ? holder_p->pcb.blockedOn_p : NULL;
+	}
+}
+
+/* the highest priority process waiting on an object, the first one to have
+ * come of those of the same priority; NULL if none waits
+ */
+PcbLink *syncTopWaiter_p(SyncObj *obj_p) {
+	PcbLink *link_p;
+	PcbLink *top_p = NULL;
+
+	for (link_p = obj_p->waiters.first_p; link_p != NULL; link_p = link_p->queueNext_p) {
+		if ((top_p == NULL) || (link_p->pcb.priority < top_p->pcb.priority)) {
+			top_p = link_p;
+		}
+	}
+	return top_p;
+}
@@ -0,0 +1,56 @@
+#ifndef SYNC_
+#define SYNC_
+
+/* systtem headers */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* local headers */
+#include "pcb.h"
+
+/* constants */
+
+/* a handle is the index of the object in the handle table, with the generation
+ * of the entry in the bits above, as pids are made of slots
+ */
+#define SYNC_SLOT_BITS 6
+#define SYNC_MAX_OBJECTS (1 << SYNC_SLOT_BITS)
+#define SYNC_GEN_MASK ((1 << (31 - SYNC_SLOT_BITS)) - 1)
+#define SYNC_POOL_CHUNK 8 /* objects reserved at once when the pool grows */
+#define SYNC_PI_DEPTH 8   /* holders a priority is passed on to, along a chain of mutexes */
+
+/* type definitions */
+typedef enum {
+	SYNC_SEMAPHORE,
+	SYNC_MUTEX,
+	SYNC_CONDITION
+} SyncType;
+
+/* semaphore, mutex or condition variable; the processes waiting on it sleep on
+ * its wait queue
+ */
+typedef struct SyncObj_s {
+	SyncType type;
+	int handle;
+	pid_t owner;             /* process that created it; destroyed when it is cleaned up */
+	int count;               /* semaphore only */
+	PcbLink *holder_p;       /* mutex only; NULL while unlocked */
+	struct SyncObj_s *nextHeld_p; /* next mutex held by the same process */
+	PcbWaitQueue waiters;
+} SyncObj;
+
+/* function declarations */
+int syncInit(void);
+int syncCreate(SyncType type, int count);
+int syncDestroy(int handle);
+int syncSemWait(int handle);
+int syncSemPost(int handle);
+int syncMutexLock(int handle);
+int syncMutexUnlock(int handle);
+int syncCondWait(int condHandle, int mutexHandle);
+int syncCondSignal(int handle, bool all);
+int syncPriority(ProcessControlBlock *pcb_p);
+void syncExit(ProcessControlBlock *pcb_p);
+
+#endif /* SYNC_ */
@@ -5,6 +5,11 @@
 #include "nvic.h"
 #include "shell.h"
 #include "pcb.h"
+#include "wheel.h"
+#include "flexTimer.h"
+
+uint64_t schedIdleCycles = 0; /* time the idle process ran */
+bool systickLong = false;     /* the tick is stretched: no process waits for a turn */
 
 void setPendSV(unsigned char priority) {
 	if (priority > PendSV_MaxPriority) {
@@ -29,6 +34,19 @@ void systickInit() {
 	/* must use the processor clock - this might always be set on the K70 */
 	SYST_CSR |= SysTick_CSR_CLKSOURCE_MASK;
 
+	/* 1 = Count to 0 changes the SysTick exception status to pending. */
+	SYST_CSR |= SysTick_CSR_TICKINT_MASK;
+
+	/* the shell runs first; the scheduler sets the quantum of every process after */
+	systickStartQuantum(PROCESS_QUANTUM);
+}
+
+/* count a quantum of ms down from the start; the scheduler runs at its end */
+void systickStartQuantum(uint32_t ms) {
+	if ((ms == 0) || (ms > SYSTICK_MAX_QUANTUM)) {
+		ms = SYSTICK_MAX_QUANTUM;
+	}
+
 	/*
 	 * Before enabling the SysTick counter, software must
 	 * write the required counter value to SYST_RVR, and then write to SYST_CVR.
@@ -36,17 +54,36 @@ void systickInit() {
 	 * the value from SYST_RVR, and counts down from that value,
 	 * rather than from an arbitrary value.
 	 */
-	SYST_RVR |= SysTick_RVR_RELOAD(PROCESS_QUANTUM);
+	SYST_CSR &= ~SysTick_CSR_ENABLE_MASK;
+	SYST_RVR = SysTick_RVR_RELOAD((ms * SYSTICK_CYCLES_PER_MS) - 1);
 	/* Any write to the register clears the register to zero. */
 	SYST_CVR = 0;
-
-	/* 1 = Count to 0 changes the SysTick exception status to pending. */
-	SYST_CSR |= SysTick_CSR_TICKINT_MASK;
+	/* a tick of the quantum before is no longer due */
+	SCB_ICSR = SCB_ICSR_PENDSTCLR_MASK;
+	systickLong = false;
 
 	/* enable the counter */
 	SYST_CSR |= SysTick_CSR_ENABLE_MASK;
 }
 
+/* stretch the tick as far as it goes, for a process that has no one to take
+ * turns with (or the idle process): it runs until it blocks, or a process of
+ * higher priority is made ready, which pends a switch, so the tick is only kept
+ * for the scheduler to extend the cycle count, and has the processor sleep
+ * through SYSTICK_MAX_QUANTUM ms at a time
+ */
+void systickStretch(void) {
+	systickStartQuantum(SYSTICK_MAX_QUANTUM);
+	systickLong = true;
+}
+
+/* the tick is stretched; a process made ready at the priority of the running
+ * one has it start a quantum
+ */
+bool systickStretched(void) {
+	return systickLong;
+}
+
 /* code from website */
 
 uint32_t *scheduler(uint32_t *oldSP);
@@ -231,27 +268,67 @@ void stHandler() {
 
 }
 
+/* picks the process to run next: the first one on the highest priority ready
+ * queue, found through the priority bitmap, so the time taken does not depend
+ * on the number of processes, blocked or not. the current process goes to the
+ * end of its queue if it is still runnable, so processes of equal priority
+ * take turns, a quantum each; the idle process, on no queue, runs when none
+ * is ready. the tick is stretched while the process picked has no one to take
+ * turns with; for the idle process, the ms tick of the FlexTimer is stretched
+ * up to the next wheel deadline as well.
+ */
 uint32_t *scheduler(uint32_t *oldSP) {
+	PcbLink *next_p;
+	uint32_t cycles;
+
 	shPcbLink_p->pcb.stackPointer = oldSP; //current pcb
-	if (shPcbLink_p->pcb.state != KILL) {
+	cycles = pcbChargeCpu(shPcbLink_p);
+	if (shPcbLink_p == pcbIdle_p) {
+		schedIdleCycles += cycles;
+		shPcbLink_p->pcb.state = READY;
+		/* the ms the FlexTimer slept through are counted before the wheel advances */
+		flexTimer0Resume();
+	} else if (shPcbLink_p->pcb.state == RUNNING) {
 		shPcbLink_p->pcb.state = READY;
+		pcbEnqueue(shPcbLink_p);
 	}
 
-	/* determining next process */
-	while(1){
-		if(shPcbLink_p->next_p->pcb.state == KILL){
-			/*clean up*/
-			ProcessControlBlock *pcb_p = &shPcbLink_p->next_p->pcb;
-			pcbRemove(shPcbLink_p->next_p);
-			pcbExit(pcb_p);
-		}else{
-			shPcbLink_p = shPcbLink_p->next_p;
-			if(shPcbLink_p->pcb.state == READY){
-				shPcbLink_p->pcb.state = RUNNING;
-				setCurrentPCB(&shPcbLink_p->pcb);
-				return shPcbLink_p->pcb.stackPointer;
-			}
-		}
+	/* processes whose sleep is over are ready again */
+	wheelAdvance();
+
+	/* determining next process; while none is ready, all of them are blocked or
+	 * asleep, and the idle process waits for an interrupt until the timer wheel
+	 * (or a device) wakes one
+	 */
+	if ((next_p = pcbDequeueNext_p()) == NULL) {
+		next_p = pcbIdle_p;
 	}
+
+	/* the choice takes every wake up so far into account; a switch pended
+	 * meanwhile would only send the process picked to the end of its queue
+	 */
+	SCB_ICSR = SCB_ICSR_PENDSVCLR_MASK;
+
+	if ((next_p != pcbIdle_p) && pcbPeerReady(next_p)) {
+		systickStartQuantum(next_p->pcb.quantum);
+	} else {
+		systickStretch();
+	}
+	if (next_p == pcbIdle_p) {
+		/* no ms tick while idle: the FlexTimer interrupts when the wheel is due */
+		flexTimer0Stretch(wheelMsToNextDue());
+	}
+
+	shPcbLink_p = next_p;
+	shPcbLink_p->pcb.state = RUNNING;
+	setCurrentPCB(&shPcbLink_p->pcb);
+	return shPcbLink_p->pcb.stackPointer;
+}
+
+/* ms the processor was idle, with no process ready, since start up; the idle
+ * process has run that long
+ */
+uint32_t schedIdleMs(void) {
+	return (uint32_t) (schedIdleCycles / (UTL_CORE_CLOCK / 1000));
 }
 
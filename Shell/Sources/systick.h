@@ -2,6 +2,7 @@
 #define _SYSTICK
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <utl.h>
 
 #define Systick_MaxPriority 15
@@ -14,11 +15,18 @@
 #define Systick_Priority 14
 #define PendSV_Priority 14
 
-#define PROCESS_QUANTUM 19200000
+#define PROCESS_QUANTUM 20 /* ms a process runs before one of the same priority gets a turn, by default */
+#define SYSTICK_CYCLES_PER_MS (UTL_CORE_CLOCK / 1000)
+/* the reload value has 24 bits; the longest quantum, and the stretched tick */
+#define SYSTICK_MAX_QUANTUM ((SysTick_RVR_RELOAD_MASK + 1) / SYSTICK_CYCLES_PER_MS)
 
 void systickInit_SetSystickPriority(unsigned char priority);
 void setPendSV(unsigned char priority);
 void systickInit();
 void stHandler();
+void systickStartQuantum(uint32_t ms);
+void systickStretch(void);
+bool systickStretched(void);
+uint32_t schedIdleMs(void);
 
 #endif /* ifndef _SYSTICK */
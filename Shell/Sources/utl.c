@@ -3,9 +3,11 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "derivative.h"
 #include "utl.h" 
 #include "flexTimer.h"
 #include "svc.h"
+#include "systick.h"
 
 const utlMonth_t month[] = {{31,"January"},
 							{28,"February"},
@@ -23,6 +25,12 @@ const utlMonth_t month[] = {{31,"January"},
 const unsigned utlBitSizeMax = sizeof(UtlAddress_t) * CHAR_BIT;
 
 int diCnt = 0;
+int schedLockCnt = 0;
+
+/* masked time measurement */
+static uint32_t diStart;
+static uint32_t lockStart;
+static utlMaskStats_t utlMaskStats;
 
 /* initialize utl global variables */
 void utlInit(void) {
@@ -710,14 +718,101 @@ void utlUtcMonthDayTime(utlDate_t *date_p, time_t *tv_sec) {
 	*tv_sec += date_p->sec;
 }
 
-/* Interrupt enablers/disablers */
+/* Interrupt enablers/disablers; the time from the outermost di to the
+ * matching ei is measured. an unmatched ei (main enables interrupts
+ * once without having disabled them) leaves the count at 0
+ */
 void ei(){
 	diCnt--;
 	if (diCnt <= 0) {
+		diCnt = 0;
+		uint32_t cycles = utlCycles() - diStart;
+		if (cycles > utlMaskStats.diMaxCycles) {
+			utlMaskStats.diMaxCycles = cycles;
+			utlMaskStats.diMaxCaller_p = __builtin_return_address(0);
+		}
 		__asm("cpsie i");
 	}
 }
 void di(){
-	diCnt++;
 	__asm("cpsid i");
+	if (diCnt++ == 0) {
+		diStart = utlCycles();
+	}
+}
+
+/* Scheduler lock; raises BASEPRI to the priority of the quantum interrupt,
+ * which masks it and every exception of the same or lower priority (PendSV,
+ * SVC), while interrupts of higher priority (UART, timers) are still taken.
+ * a quantum that expires meanwhile stays pending, and the switch happens as
+ * soon as the lock is released.
+ */
+void schedLock(void){
+	uint32_t basepri = Systick_Priority << Systick_PriorityShift;
+
+	/* basepri_max only ever raises the masking level */
+	__asm volatile("msr basepri_max, %[basepri]" : : [basepri] "r" (basepri) : "memory");
+	if (schedLockCnt++ == 0) {
+		lockStart = utlCycles();
+	}
+}
+void schedUnlock(void){
+	schedLockCnt--;
+	if (schedLockCnt <= 0) {
+		schedLockCnt = 0;
+		uint32_t cycles = utlCycles() - lockStart;
+		if (cycles > utlMaskStats.lockMaxCycles) {
+			utlMaskStats.lockMaxCycles = cycles;
+			utlMaskStats.lockMaxCaller_p = __builtin_return_address(0);
+		}
+		__asm volatile("msr basepri, %[basepri]" : : [basepri] "r" (0) : "memory");
+	}
+}
+
+/* give up the scheduler lock, however deeply nested, so that a pending switch
+ * is taken; returns the nesting count, for schedReacquire to restore it
+ */
+int schedRelease(void){
+	int count = schedLockCnt;
+
+	if (count > 0) {
+		schedLockCnt = 1;
+		schedUnlock();
+	}
+	return count;
+}
+void schedReacquire(int count){
+	if (count > 0) {
+		schedLock();
+		schedLockCnt = count;
+	}
+}
+
+/* start the DWT cycle counter used for the masked time measurement */
+void utlCycleCounterInit(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* core clock cycles since utlCycleCounterInit; wraps every 35 seconds at 120 MHz */
+uint32_t utlCycles(void){
+	return DWT->CYCCNT;
+}
+
+/* copy the longest masked windows measured so far */
+void utlGetMaskStats(utlMaskStats_t *stats_p){
+	di();
+	*stats_p = utlMaskStats;
+	ei();
+}
+
+/* start the measurement over */
+void utlResetMaskStats(void){
+	di();
+	utlMaskStats.diMaxCycles = 0;
+	utlMaskStats.diMaxCaller_p = NULL;
+	utlMaskStats.lockMaxCycles = 0;
+	utlMaskStats.lockMaxCaller_p = NULL;
+	ei();
 }
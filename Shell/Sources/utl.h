@@ -190,4 +190,31 @@ void utlUtcMonthDayTime(utlDate_t *date_p, time_t *tv_sec);
 void ei();
 void di();
 
+/* scheduler lock; keeps the quantum interrupt (SysTick), PendSV and SVCs from being taken,
+ * but leaves the device interrupts enabled. nests like di/ei. no SVC may be issued while it
+ * is held, and it must not be taken from an ISR of a higher priority than the quantum
+ */
+void schedLock(void);
+void schedUnlock(void);
+int schedRelease(void);
+void schedReacquire(int count);
+
+/* longest windows with interrupts disabled (di/ei) and with the scheduler locked, in core
+ * clock cycles as counted by the DWT cycle counter, with the address the window ended at
+ */
+#define UTL_CORE_CLOCK 120000000
+#define UTL_CYCLES_TO_USEC(C) ((C) / (UTL_CORE_CLOCK / 1000000))
+
+typedef struct {
+	uint32_t diMaxCycles;
+	void *diMaxCaller_p;
+	uint32_t lockMaxCycles;
+	void *lockMaxCaller_p;
+} utlMaskStats_t;
+
+void utlCycleCounterInit(void);
+uint32_t utlCycles(void);
+void utlGetMaskStats(utlMaskStats_t *stats_p);
+void utlResetMaskStats(void);
+
 #endif /* UTL_ */
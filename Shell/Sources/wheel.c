@@ -0,0 +1,288 @@
+/* wheel.c contains the sleep service: a process sleeps for a number of ms on a
+ * hierarchical timer wheel, blocked, instead of spinning in a delay loop.
+ *
+ * a sleeping process is on the wait queue of the slot its wake up time falls in.
+ * level 0 has a slot per ms; when a level has made a full turn, the slot of the
+ * level above that has come due is emptied into the levels below ("cascaded").
+ * a process is moved at most once per level, so putting it to sleep and waking
+ * it take constant time, amortized; one woken early by wake or myKill just
+ * leaves its slot, as it leaves any other wait queue.
+ *
+ * a process may also sleep on some other wait queue with a time limit: it is
+ * then kept on a list of timed sleepers as well, sorted by wake up time, and
+ * made ready when the time runs out, unless woken before. the list is short
+ * (timed receives on the message queues), so it is kept apart from the slots.
+ *
+ * the FlexTimer 0 ISR only counts the ms and pends the scheduler when a slot
+ * comes due (while the idle process runs, it interrupts only then, counting the
+ * ms up to the slot at once): its priority is above that of the scheduler lock, so it must not
+ * touch the queues. the wheel is advanced by the scheduler, and by wheelSleep
+ * with the scheduler locked. the ms are counted apart from clockInMill, which
+ * jumps when the date is set.
+ *
+ * Primary functions:
+ *		wheelSleep(): put the current process to sleep
+ *		wheelSleepOn(): put the current process to sleep on a wait queue, with a time limit
+ *		wheelTick(): count ms; called by the FlexTimer 0 ISR
+ *		wheelMsToNextDue(): ms up to the time the scheduler has to run next
+ *		wheelAdvance(): make ready the processes whose sleep is over
+ */
+
+/* sys include files */
+#include <stdint.h>
+
+/* project headers */
+#include "wheel.h"
+#include "pcb.h"
+#include "utl.h"
+#include "shell.h"
+
+#define WHEEL_MAP0_WORDS (WHEEL_SLOTS0 / 32)
+#define WHEEL_BIT(I) (1U << ((I) % 32))
+#define WHEEL_NEVER 0x7FFFFFFF /* ms ahead the next due time is set to when none sleeps */
+
+/* slots; a bit is set in the map of a level while its slot may not be empty (a
+ * process woken early leaves the bit behind until the slot is reached)
+ */
+PcbWaitQueue wheelSlot0[WHEEL_SLOTS0];
+PcbWaitQueue wheelSlot[WHEEL_LEVELS - 1][WHEEL_SLOTS];
+uint32_t wheelMap0[WHEEL_MAP0_WORDS];
+uint64_t wheelMap[WHEEL_LEVELS - 1];
+
+volatile uint32_t wheelTicks = 0;   /* ms counted by the ISR */
+uint32_t wheelNow = 0;              /* ms the wheel has been advanced to */
+volatile uint32_t wheelNextDue = WHEEL_NEVER; /* ms at which the ISR pends the scheduler */
+PcbLink *wheelTimeout_p = NULL;     /* timed sleepers, the first to wake up first */
+
+/* internal function declarations - to be used by the timer wheel only */
+PcbWaitQueue *wheelSlot_p(uint32_t wakeTime);
+void wheelCascade(int level, unsigned idx);
+uint32_t wheelFindNextDue(void);
+void wheelExpire(void);
+
+/* function definitions */
+
+/* put the current process to sleep for ms milliseconds; called from the SVC
+ * handler. the sleep ends early if the process is woken by wake
+ */
+void wheelSleep(uint32_t ms) {
+	PcbLink *link_p = shPcbLink_p; /* the running process */
+
+	if (ms == 0) {
+		yield();
+		return;
+	}
+
+	schedLock();
+	/* the sleep starts now, not when the scheduler last ran */
+	wheelAdvance();
+	link_p->pcb.wakeTime = wheelNow + ms;
+	PcbWaitQueue *slot_p = wheelSlot_p(link_p->pcb.wakeTime);
+	wheelNextDue = wheelFindNextDue();
+	pcbSleepOn(slot_p);
+	schedUnlock();
+}
+
+/* put the current process to sleep on a wait queue for at most *ms_p
+ * milliseconds; *ms_p is left with the time that was left as it woke up.
+ * called from the SVC handler. returns -1 if the time ran out, 0 if the
+ * process was woken before
+ */
+int wheelSleepOn(PcbWaitQueue *queue_p, uint32_t *ms_p) {
+	PcbLink *link_p = shPcbLink_p; /* the running process */
+	PcbLink **next_pp;
+	uint32_t ms = *ms_p;
+
+	if (ms == 0) {
+		return -1;
+	}
+	if (ms >= WHEEL_NEVER) {
+		ms = WHEEL_NEVER - 1;
+	}
+
+	schedLock();
+	wheelAdvance();
+	link_p->pcb.wakeTime = wheelNow + ms;
+	link_p->pcb.timedOut = false;
+
+	/* after the sleepers waking up at the same time */
+	link_p->timeoutPrev_p = NULL;
+	for (next_pp = &wheelTimeout_p; (*next_pp != NULL)
+			&& ((int32_t) ((*next_pp)->pcb.wakeTime - link_p->pcb.wakeTime) <= 0);
+			next_pp = &(*next_pp)->timeoutNext_p) {
+		link_p->timeoutPrev_p = *next_pp;
+	}
+	link_p->timeoutNext_p = *next_pp;
+	if (link_p->timeoutNext_p != NULL) {
+		link_p->timeoutNext_p->timeoutPrev_p = link_p;
+	}
+	*next_pp = link_p;
+	wheelNextDue = wheelFindNextDue();
+
+	pcbSleepOn(queue_p);
+
+	wheelCancel(link_p);
+	wheelAdvance();
+	if (link_p->pcb.timedOut || ((int32_t) (link_p->pcb.wakeTime - wheelNow) <= 0)) {
+		*ms_p = 0;
+	} else {
+		*ms_p = link_p->pcb.wakeTime - wheelNow;
+	}
+	schedUnlock();
+	return link_p->pcb.timedOut ? -1 : 0;
+}
+
+/* take a process off the list of timed sleepers, if it is on it */
+void wheelCancel(PcbLink *link_p) {
+	schedLock();
+	if ((link_p->timeoutPrev_p != NULL) || (wheelTimeout_p == link_p)) {
+		if (link_p->timeoutPrev_p != NULL) {
+			link_p->timeoutPrev_p->timeoutNext_p = link_p->timeoutNext_p;
+		} else {
+			wheelTimeout_p = link_p->timeoutNext_p;
+		}
+		if (link_p->timeoutNext_p != NULL) {
+			link_p->timeoutNext_p->timeoutPrev_p = link_p->timeoutPrev_p;
+		}
+		link_p->timeoutPrev_p = link_p->timeoutNext_p = NULL;
+	}
+	schedUnlock();
+}
+
+/* count ms, and have the scheduler run when a slot is due */
+void wheelTick(uint32_t ms) {
+	wheelTicks += ms;
+	if ((int32_t) (wheelTicks - wheelNextDue) >= 0) {
+		yield();
+	}
+}
+
+/* catch the wheel up with the ms counted by the ISR: cascade the levels that
+ * have turned, and make ready the processes on the level 0 slots passed
+ */
+void wheelAdvance(void) {
+	unsigned idx;
+	int level;
+
+	schedLock();
+	while (wheelNow != wheelTicks) {
+		wheelNow++;
+		for (level = 1; (level < WHEEL_LEVELS)
+				&& ((wheelNow & ((1U << WHEEL_SHIFT(level)) - 1)) == 0); level++) {
+			wheelCascade(level, (wheelNow >> WHEEL_SHIFT(level)) & (WHEEL_SLOTS - 1));
+		}
+
+		idx = wheelNow & (WHEEL_SLOTS0 - 1);
+		if (wheelMap0[idx / 32] & WHEEL_BIT(idx)) {
+			wheelMap0[idx / 32] &= ~WHEEL_BIT(idx);
+			pcbWakeAll(&wheelSlot0[idx]);
+		}
+	}
+	wheelExpire();
+	wheelNextDue = wheelFindNextDue();
+	schedUnlock();
+}
+
+/* ms from the last one counted up to the time the next slot comes due, or the
+ * first timed sleep runs out; 0 if it is due already
+ */
+uint32_t wheelMsToNextDue(void) {
+	int32_t ms = (int32_t) (wheelNextDue - wheelTicks);
+
+	return (ms > 0) ? (uint32_t) ms : 0;
+}
+
+/* the slot a process waking up at wakeTime sleeps on, marked in the map of its
+ * level; the level is the lowest one that does not turn before wakeTime
+ */
+PcbWaitQueue *wheelSlot_p(uint32_t wakeTime) {
+	uint32_t delta = wakeTime - wheelNow;
+	unsigned idx;
+	int level;
+
+	if (delta < WHEEL_SLOTS0) {
+		idx = wakeTime & (WHEEL_SLOTS0 - 1);
+		wheelMap0[idx / 32] |= WHEEL_BIT(idx);
+		return &wheelSlot0[idx];
+	}
+
+	if (delta > WHEEL_MAX_MS) {
+		/* placed again when it comes down from the top level */
+		delta = WHEEL_MAX_MS;
+		wakeTime = wheelNow + delta;
+	}
+	for (level = 1; (level < WHEEL_LEVELS - 1)
+			&& (delta >= (1U << WHEEL_SHIFT(level + 1))); level++) {;}
+
+	idx = (wakeTime >> WHEEL_SHIFT(level)) & (WHEEL_SLOTS - 1);
+	wheelMap[level - 1] |= ((uint64_t) 1) << idx;
+	return &wheelSlot[level - 1][idx];
+}
+
+/* move the processes on a slot of a level above 0 to the levels below; they all
+ * wake up before the level below turns again, so none comes back to this slot
+ */
+void wheelCascade(int level, unsigned idx) {
+	PcbWaitQueue *slot_p = &wheelSlot[level - 1][idx];
+	PcbLink *link_p;
+
+	wheelMap[level - 1] &= ~(((uint64_t) 1) << idx);
+	while ((link_p = slot_p->first_p) != NULL) {
+		pcbWaitQueueMove(link_p, wheelSlot_p(link_p->pcb.wakeTime));
+	}
+}
+
+/* make ready the timed sleepers whose time has run out; those that are no
+ * longer blocked (woken, or killed) are just taken off the list
+ */
+void wheelExpire(void) {
+	PcbLink *link_p;
+
+	while (((link_p = wheelTimeout_p) != NULL)
+			&& ((int32_t) (link_p->pcb.wakeTime - wheelNow) <= 0)) {
+		wheelCancel(link_p);
+		if (link_p->pcb.state == BLOCKED) {
+			link_p->pcb.timedOut = true;
+			pcbSetState(&link_p->pcb, READY);
+		}
+	}
+}
+
+/* the ms the next level 0 slot in use comes due, level 0 next turns if
+ * processes sleep on the levels above, or the first timed sleep runs out,
+ * whichever comes first
+ */
+uint32_t wheelFindNextDue(void) {
+	uint32_t due = wheelNow + WHEEL_NEVER;
+	unsigned start = (wheelNow + 1) & (WHEEL_SLOTS0 - 1);
+	unsigned word = start / 32;
+	uint32_t bits = wheelMap0[word] & (~0U << (start % 32));
+	int level, n;
+
+	/* the word of the start slot is looked at again last, for the slots before it */
+	for (n = 0; n <= WHEEL_MAP0_WORDS; n++) {
+		if (bits != 0) {
+			unsigned idx = (word * 32) + __builtin_ctz(bits);
+			due = wheelNow + ((idx - wheelNow - 1) & (WHEEL_SLOTS0 - 1)) + 1;
+			break;
+		}
+		word = (word + 1) % WHEEL_MAP0_WORDS;
+		bits = wheelMap0[word];
+	}
+
+	for (level = 1; level < WHEEL_LEVELS; level++) {
+		if (wheelMap[level - 1] != 0) {
+			uint32_t turn = (wheelNow | (WHEEL_SLOTS0 - 1)) + 1;
+			if ((int32_t) (turn - due) < 0) {
+				due = turn;
+			}
+			break;
+		}
+	}
+
+	if ((wheelTimeout_p != NULL) && ((int32_t) (wheelTimeout_p->pcb.wakeTime - due) < 0)) {
+		due = wheelTimeout_p->pcb.wakeTime;
+	}
+
+	return due;
+}
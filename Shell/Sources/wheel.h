@@ -0,0 +1,32 @@
+#ifndef WHEEL_
+#define WHEEL_
+
+/* systtem headers */
+#include <stdint.h>
+
+/* local headers */
+#include "pcb.h"
+
+/* constants */
+
+/* level 0 of the timer wheel has a slot per ms; every slot of a level above spans a
+ * full turn of the level below. the levels cover 2^26 ms (about 18 hours); a longer
+ * sleep waits in the top level, and is placed again every time it comes down
+ */
+#define WHEEL_SLOTS0_LOG2 8
+#define WHEEL_SLOTS_LOG2 6
+#define WHEEL_LEVELS 4
+#define WHEEL_SLOTS0 (1 << WHEEL_SLOTS0_LOG2)
+#define WHEEL_SLOTS (1 << WHEEL_SLOTS_LOG2)
+#define WHEEL_SHIFT(L) (WHEEL_SLOTS0_LOG2 + ((L) - 1) * WHEEL_SLOTS_LOG2) /* L > 0 */
+#define WHEEL_MAX_MS ((1U << WHEEL_SHIFT(WHEEL_LEVELS)) - 1)
+
+/* function declarations */
+void wheelSleep(uint32_t ms);
+int wheelSleepOn(PcbWaitQueue *queue_p, uint32_t *ms_p);
+void wheelCancel(PcbLink *link_p);
+void wheelTick(uint32_t ms);
+uint32_t wheelMsToNextDue(void);
+void wheelAdvance(void);
+
+#endif /* WHEEL_ */
@@ -0,0 +1,350 @@
+/* memreplay.c is a host program that replays an allocation trace, as printed by
+ * 'memtrace dump' on the tower, against the memory manager in Shell/Sources/mem.c,
+ * and reports how fragmented the heap gets over time, and how long the allocations,
+ * frees and reallocations take. since it is built from the current mem.c, running the
+ * same dump before and after a change to the allocator compares the two on a real
+ * workload.
+ *
+ * the heap is placed at its address on the tower, so the host has to be able to map
+ * SDRAM_START (a 64-bit linux host can). build from Shell/Sources, without MEM_TRACE:
+ *
+ *   gcc -std=gnu99 -fcommon -I. -I../Includes ../Tools/memreplay.c mem.c -o memreplay
+ *
+ * usage: memreplay [-i interval] [dump file]
+ *   the dump is read from stdin if no file is given; lines that are not trace records
+ *   (prompt, other output captured from the terminal) are skipped. a line of statistics
+ *   is printed every interval events (default 100), as comma separated values:
+ *   event, time, used, free, largest free, free segments, fragmentation (%)
+ *   where fragmentation is the part of the free bytes not in the largest free segment.
+ *   at the end, the 50th and 99th percentile and the largest time of each kind of call
+ *   into the allocator are printed, in ns of host time; only the call itself is timed.
+ *
+ * the dump only holds the last MEM_TRACE_RECORDS events; frees of segments allocated
+ * before the window of the dump are counted, but not replayed (as are hand overs of
+ * such segments), and reallocations of such segments are replayed as allocations.
+ */
+
+/* sys include files */
+#include <sys/mman.h>
+#include <time.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project headers */
+#define ALLOCATE_
+#include "mem.h"
+#include "pcb.h"
+
+/* constants */
+#define REPLAY_MAP_SIZE (4 * 8192) /* power of 2, well above the number of live segments */
+#define REPLAY_LINE_SIZE 256
+#define REPLAY_LATENCY_CHUNK 4096 /* latencies the sample of a call grows by */
+
+/* type definitions */
+
+/* segment allocated on the tower, and the segment it was replayed by */
+typedef struct {
+	uintptr_t traced;
+	void *replayed_p;
+	pid_t processID;
+} ReplayEntry;
+
+/* latencies of one kind of call into the allocator, in ns */
+typedef struct {
+	const char *name_p;
+	unsigned long *ns_p;
+	unsigned count;
+	unsigned capacity;
+} ReplayLatency;
+
+/* globals */
+static ReplayEntry replayMap[REPLAY_MAP_SIZE];
+static ReplayLatency replayAlloc = { "alloc" };
+static ReplayLatency replayFree = { "free" };
+static ReplayLatency replayRealloc = { "realloc" };
+static pid_t replayPid = 1;
+
+/* not declared in mem.h, since to be used by OS only */
+extern void *memAlloc(unsigned size, int pId);
+
+/* stand-ins for the kernel functions the memory manager calls */
+pid_t pid(void) {
+	return replayPid;
+}
+
+void SVCprintStr(char *str_p) {
+	fputs(str_p, stdout);
+}
+
+void schedLock(void) {
+}
+
+void schedUnlock(void) {
+}
+
+uint32_t flexTimerGetClockLow() {
+	return 0;
+}
+
+/* the replayed processes have no PCB, so no quota */
+ProcessControlBlock *getCurrentPCB(void) {
+	return NULL;
+}
+
+ProcessControlBlock *findPCB(pid_t targetPid) {
+	return NULL;
+}
+
+/* find the entry of a traced address, or the empty entry it would go in */
+ReplayEntry *replayFind_p(uintptr_t traced) {
+	unsigned i = (unsigned) (traced / DWORD) & (REPLAY_MAP_SIZE - 1);
+
+	while ((replayMap[i].traced != 0) && (replayMap[i].traced != traced)) {
+		i = (i + 1) & (REPLAY_MAP_SIZE - 1);
+	}
+	return &replayMap[i];
+}
+
+/* remove an entry; the entries following it in the probe sequence are
+ * inserted again, so that none of them is cut off from its home slot
+ */
+void replayRemove(ReplayEntry *entry_p) {
+	unsigned i = entry_p - replayMap;
+	ReplayEntry moved;
+
+	entry_p->traced = 0;
+	for (i = (i + 1) & (REPLAY_MAP_SIZE - 1); replayMap[i].traced != 0;
+			i = (i + 1) & (REPLAY_MAP_SIZE - 1)) {
+		moved = replayMap[i];
+		replayMap[i].traced = 0;
+		*replayFind_p(moved.traced) = moved;
+	}
+}
+
+/* host time in ns */
+unsigned long replayNow(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long) ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/* add the time a call took, since start, to the sample of its kind */
+void replayLatencyAdd(ReplayLatency *latency_p, unsigned long start) {
+	unsigned long ns = replayNow() - start;
+
+	if (latency_p->count == latency_p->capacity) {
+		latency_p->capacity += REPLAY_LATENCY_CHUNK;
+		latency_p->ns_p = realloc(latency_p->ns_p,
+				latency_p->capacity * sizeof(unsigned long));
+		if (latency_p->ns_p == NULL) {
+			perror("memreplay");
+			exit(1);
+		}
+	}
+	latency_p->ns_p[latency_p->count++] = ns;
+}
+
+int replayCompare(const void *a_p, const void *b_p) {
+	unsigned long a = *(const unsigned long *) a_p;
+	unsigned long b = *(const unsigned long *) b_p;
+
+	return (a > b) - (a < b);
+}
+
+/* print the 50th and 99th percentile and the largest of a sample */
+void replayLatencyReport(ReplayLatency *latency_p) {
+	unsigned n = latency_p->count;
+
+	if (n == 0) {
+		printf("# %s: no calls\n", latency_p->name_p);
+		return;
+	}
+	qsort(latency_p->ns_p, n, sizeof(unsigned long), replayCompare);
+	printf("# %s: %u calls, p50 %lu ns, p99 %lu ns, max %lu ns\n", latency_p->name_p, n,
+			latency_p->ns_p[(n - 1) * 50 / 100], latency_p->ns_p[(n - 1) * 99 / 100],
+			latency_p->ns_p[n - 1]);
+}
+
+/* percentage of the free bytes that are not in the largest free segment */
+unsigned replayFragmentation(MemStats *stats_p) {
+	if (stats_p->freeBytes == 0) {
+		return 0;
+	}
+	return (unsigned) ((100ULL * (stats_p->freeBytes - stats_p->largestFree))
+			/ stats_p->freeBytes);
+}
+
+/* print the statistics line of the heap after an event */
+void replayReport(unsigned event, unsigned time, MemStats *stats_p) {
+	printf("%u,%u,%u,%u,%u,%u,%u\n", event, time, stats_p->usedBytes,
+			stats_p->freeBytes, stats_p->largestFree, stats_p->numFree,
+			replayFragmentation(stats_p));
+}
+
+int main(int argc, char *argv[]) {
+	FILE *dump_p = stdin;
+	unsigned interval = 100;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "-i") == 0) && (i + 1 < argc)) {
+			interval = (unsigned) strtoul(argv[++i], NULL, 0);
+			if (interval == 0) {
+				interval = 1;
+			}
+		} else if ((dump_p = fopen(argv[i], "r")) == NULL) {
+			perror(argv[i]);
+			return 1;
+		}
+	}
+
+	void *sdram_p = mmap((void *) (uintptr_t) SDRAM_START, SDRAM_SIZE,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	if (sdram_p != (void *) (uintptr_t) SDRAM_START) {
+		perror("memreplay: cannot map SDRAM");
+		return 1;
+	}
+	memInit();
+
+	char line[REPLAY_LINE_SIZE];
+	char event;
+	unsigned time, size, lastTime = 0;
+	int processID;
+	unsigned long long traced, caller, previous;
+	unsigned numEvents = 0, numFailed = 0, numTracedFailed = 0, numUnmatched = 0;
+	unsigned maxFrag = 0, maxFragEvent = 0;
+	MemStats stats;
+	ReplayEntry *entry_p;
+	unsigned long start;
+
+	printf("event,time,used,free,largest,segments,fragmentation\n");
+	while (fgets(line, sizeof(line), dump_p) != NULL) {
+		previous = 0;
+		if (sscanf(line, " @%c %u %d %u %llx %llx %llx", &event, &time, &processID,
+				&size, &traced, &caller, &previous) < 6) {
+			/* "(nil)" is printed for a failed allocation */
+			if (sscanf(line, " @%c %u %d %u", &event, &time, &processID, &size) != 4) {
+				continue;
+			}
+			traced = 0;
+		}
+
+		replayPid = processID;
+		switch (event) {
+		case MEM_TRACE_ALLOC: {
+			start = replayNow();
+			void *address_p = memAlloc(size, processID);
+			replayLatencyAdd(&replayAlloc, start);
+			if ((traced == 0) && (size > 0)) {
+				numTracedFailed++;
+			}
+			if ((address_p == NULL) && (size > 0)) {
+				numFailed++;
+			}
+			if ((address_p != NULL) && (traced != 0)) {
+				entry_p = replayFind_p((uintptr_t) traced);
+				entry_p->traced = (uintptr_t) traced;
+				entry_p->replayed_p = address_p;
+				entry_p->processID = processID;
+			} else if (address_p != NULL) {
+				/* failed on the tower; do not let it hold memory here either */
+				myFreeErrorCode(address_p, processID);
+			}
+			break;
+		}
+		case MEM_TRACE_REALLOC: {
+			void *address_p;
+			entry_p = replayFind_p((uintptr_t) previous);
+			if (entry_p->traced == 0) {
+				/* resized a segment allocated before the dump; replay as an allocation */
+				numUnmatched++;
+				start = replayNow();
+				address_p = memAlloc(size, processID);
+				replayLatencyAdd(&replayAlloc, start);
+			} else {
+				start = replayNow();
+				address_p = myRealloc(entry_p->replayed_p, size);
+				replayLatencyAdd(&replayRealloc, start);
+				if (address_p == NULL) {
+					/* the old segment is left as it was */
+					numFailed++;
+					break;
+				}
+				replayRemove(entry_p);
+			}
+			if (address_p == NULL) {
+				numFailed++;
+			} else {
+				entry_p = replayFind_p((uintptr_t) traced);
+				entry_p->traced = (uintptr_t) traced;
+				entry_p->replayed_p = address_p;
+				entry_p->processID = processID;
+			}
+			break;
+		}
+		case MEM_TRACE_FREE:
+			entry_p = replayFind_p((uintptr_t) traced);
+			if (entry_p->traced == 0) {
+				numUnmatched++;
+				break;
+			}
+			start = replayNow();
+			myFreeErrorCode(entry_p->replayed_p, processID);
+			replayLatencyAdd(&replayFree, start);
+			replayRemove(entry_p);
+			break;
+		case MEM_TRACE_GIVE:
+			/* handed over to another process, by a zero-copy message */
+			entry_p = replayFind_p((uintptr_t) traced);
+			if (entry_p->traced == 0) {
+				numUnmatched++;
+				break;
+			}
+			memGive(entry_p->replayed_p, entry_p->processID, processID);
+			entry_p->processID = processID;
+			break;
+		case MEM_TRACE_EXIT:
+			memExit(processID);
+			for (i = 0; i < REPLAY_MAP_SIZE; i++) {
+				while ((replayMap[i].traced != 0)
+						&& (replayMap[i].processID == processID)) {
+					replayRemove(&replayMap[i]);
+				}
+			}
+			break;
+		default:
+			continue;
+		}
+
+		numEvents++;
+		lastTime = time;
+		memGetStats(&stats);
+		unsigned frag = replayFragmentation(&stats);
+		if (frag > maxFrag) {
+			maxFrag = frag;
+			maxFragEvent = numEvents;
+		}
+		if ((numEvents % interval) == 0) {
+			replayReport(numEvents, time, &stats);
+		}
+	}
+
+	memGetStats(&stats);
+	printf("\n# events: %u (last at %u ms)\n", numEvents, lastTime);
+	printf("# failed allocations: %u (%u failed when traced)\n", numFailed,
+			numTracedFailed);
+	printf("# frees/reallocations of segments allocated before the dump: %u\n",
+			numUnmatched);
+	printf("# peak used: %u, largest fragmentation: %u%% at event %u\n",
+			stats.peakUsedBytes, maxFrag, maxFragEvent);
+	printf("# final: used %u, free %u in %u segments, largest free %u\n",
+			stats.usedBytes, stats.freeBytes, stats.numFree, stats.largestFree);
+	replayLatencyReport(&replayAlloc);
+	replayLatencyReport(&replayFree);
+	replayLatencyReport(&replayRealloc);
+
+	return 0;
+}
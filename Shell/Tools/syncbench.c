@@ -0,0 +1,283 @@
+/* syncbench.c is a host program that measures the handoff latency of the
+ * synchronization objects in Shell/Sources/sync.c: two processes pass a
+ * semaphore count back and forth (ping-pong), and contend for a mutex that
+ * each of them holds across a switch, so that every unlock hands it over.
+ *
+ * the processes are coroutines (ucontext), and the kernel functions sync.c
+ * calls are replaced by stand-ins below that keep the same queues, so the time
+ * measured is that of the sync.c code plus a host context switch. the numbers
+ * compare one version of sync.c with another; they are not those of the tower.
+ * build from Shell/Sources:
+ *
+ *   gcc -O2 -std=gnu99 -fcommon -I. -I../Includes ../Tools/syncbench.c sync.c -o syncbench
+ *
+ * usage: syncbench [rounds]
+ *   rounds is the number of round trips of each test (default 1000000).
+ */
+
+/* sys include files */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+/* project headers; the bench defines the current process, as the shell does */
+#define ALLOCATE_
+#include "shell.h"
+#include "sync.h"
+#include "pcb.h"
+#include "pool.h"
+
+/* constants */
+#define BENCH_PROCESSES 2
+#define BENCH_STACK_SIZE (64 * 1024)
+
+/* globals */
+static PcbLink benchLink[BENCH_PROCESSES];
+static ucontext_t benchContext[BENCH_PROCESSES];
+static ucontext_t benchMain;
+static char benchStack[BENCH_PROCESSES][BENCH_STACK_SIZE];
+static PcbWaitQueue benchReady;   /* one FIFO is enough for processes of the same priority */
+static int benchRunning;          /* processes that have not finished yet */
+static unsigned long benchRounds = 1000000;
+static unsigned long benchHandoffs;
+static int benchSem[2];
+static int benchMutex;
+
+/* stand-ins for the kernel functions sync.c calls */
+pid_t pid(void) {
+	return shPcbLink_p->pcb.processID;
+}
+
+void schedLock(void) {
+}
+
+void schedUnlock(void) {
+}
+
+void yield(void) {
+}
+
+int poolCreate(Pool *pool_p, unsigned objSize, unsigned objsPerChunk) {
+	pool_p->objSize = objSize;
+	return 0;
+}
+
+void *poolGet(Pool *pool_p) {
+	return malloc(pool_p->objSize);
+}
+
+void poolPut(Pool *pool_p, void *obj_p) {
+	free(obj_p);
+}
+
+void pcbWaitQueueInit(PcbWaitQueue *queue_p) {
+	queue_p->first_p = queue_p->last_p = NULL;
+}
+
+static void benchAppend(PcbWaitQueue *queue_p, PcbLink *link_p) {
+	link_p->queueNext_p = NULL;
+	link_p->queuePrev_p = queue_p->last_p;
+	if (queue_p->last_p != NULL) {
+		queue_p->last_p->queueNext_p = link_p;
+	} else {
+		queue_p->first_p = link_p;
+	}
+	queue_p->last_p = link_p;
+	link_p->waitQueue_p = queue_p;
+}
+
+static void benchRemove(PcbLink *link_p) {
+	PcbWaitQueue *queue_p = link_p->waitQueue_p;
+
+	if (link_p->queuePrev_p != NULL) {
+		link_p->queuePrev_p->queueNext_p = link_p->queueNext_p;
+	} else {
+		queue_p->first_p = link_p->queueNext_p;
+	}
+	if (link_p->queueNext_p != NULL) {
+		link_p->queueNext_p->queuePrev_p = link_p->queuePrev_p;
+	} else {
+		queue_p->last_p = link_p->queuePrev_p;
+	}
+	link_p->queuePrev_p = link_p->queueNext_p = NULL;
+	link_p->waitQueue_p = NULL;
+}
+
+/* switch to the next ready process; back to main once none is left */
+static void benchSwitch(void) {
+	PcbLink *self_p = shPcbLink_p;
+	PcbLink *next_p = benchReady.first_p;
+
+	if (next_p == NULL) {
+		swapcontext(&benchContext[self_p - benchLink], &benchMain);
+		return;
+	}
+	benchRemove(next_p);
+	next_p->pcb.state = RUNNING;
+	shPcbLink_p = next_p;
+	if (next_p != self_p) {
+		swapcontext(&benchContext[self_p - benchLink], &benchContext[next_p - benchLink]);
+	}
+}
+
+void pcbSetState(ProcessControlBlock *pcb_p, ProcessState state) {
+	PcbLink *link_p = (PcbLink *) pcb_p;
+
+	if (pcb_p->state == state) {
+		return;
+	}
+	if (link_p->waitQueue_p != NULL) {
+		benchRemove(link_p);
+	}
+	pcb_p->state = state;
+	if (state == READY) {
+		benchAppend(&benchReady, link_p);
+	}
+}
+
+void pcbSleepOn(PcbWaitQueue *queue_p) {
+	benchAppend(queue_p, shPcbLink_p);
+	shPcbLink_p->pcb.state = BLOCKED;
+	benchSwitch();
+}
+
+int pcbWakeOne(PcbWaitQueue *queue_p) {
+	if (queue_p->first_p == NULL) {
+		return 0;
+	}
+	pcbSetState(&queue_p->first_p->pcb, READY);
+	return 1;
+}
+
+int pcbWakeAll(PcbWaitQueue *queue_p) {
+	int woken = 0;
+
+	while (queue_p->first_p != NULL) {
+		pcbSetState(&queue_p->first_p->pcb, READY);
+		woken++;
+	}
+	return woken;
+}
+
+void pcbChangePriority(PcbLink *link_p, int priority) {
+	link_p->pcb.priority = priority;
+}
+
+/* give the processor to the other process, staying ready */
+static void benchYield(void) {
+	shPcbLink_p->pcb.state = READY;
+	benchAppend(&benchReady, shPcbLink_p);
+	benchSwitch();
+}
+
+/* the processes of the tests */
+static void benchPing(void) {
+	unsigned long i;
+
+	for (i = 0; i < benchRounds; i++) {
+		syncSemPost(benchSem[0]);
+		syncSemWait(benchSem[1]);
+	}
+	benchRunning--;
+	shPcbLink_p->pcb.state = KILL;
+	benchSwitch();
+}
+
+static void benchPong(void) {
+	unsigned long i;
+
+	for (i = 0; i < benchRounds; i++) {
+		syncSemWait(benchSem[0]);
+		syncSemPost(benchSem[1]);
+	}
+	benchRunning--;
+	shPcbLink_p->pcb.state = KILL;
+	benchSwitch();
+}
+
+static void benchContend(void) {
+	unsigned long i;
+
+	for (i = 0; i < benchRounds; i++) {
+		syncMutexLock(benchMutex);
+		benchYield(); /* the other process blocks on the mutex meanwhile */
+		if (benchLink[0].pcb.state == BLOCKED || benchLink[1].pcb.state == BLOCKED) {
+			benchHandoffs++;
+		}
+		syncMutexUnlock(benchMutex);
+	}
+	benchRunning--;
+	shPcbLink_p->pcb.state = KILL;
+	benchSwitch();
+}
+
+/* run the two processes to the end, and return the time it took, in ns */
+static double benchRun(void (*first)(void), void (*second)(void)) {
+	void (*body[BENCH_PROCESSES])(void) = {first, second};
+	struct timespec start, end;
+	int i;
+
+	pcbWaitQueueInit(&benchReady);
+	for (i = 0; i < BENCH_PROCESSES; i++) {
+		memset(&benchLink[i], 0, sizeof(PcbLink));
+		benchLink[i].pcb.processID = i + 1;
+		benchLink[i].pcb.priority = benchLink[i].pcb.basePriority = PCB_DEFAULT_PRIORITY;
+		getcontext(&benchContext[i]);
+		benchContext[i].uc_stack.ss_sp = benchStack[i];
+		benchContext[i].uc_stack.ss_size = BENCH_STACK_SIZE;
+		benchContext[i].uc_link = &benchMain;
+		makecontext(&benchContext[i], body[i], 0);
+		if (i > 0) {
+			benchLink[i].pcb.state = READY;
+			benchAppend(&benchReady, &benchLink[i]);
+		}
+	}
+	benchRunning = BENCH_PROCESSES;
+	benchLink[0].pcb.state = RUNNING;
+	shPcbLink_p = &benchLink[0];
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	swapcontext(&benchMain, &benchContext[0]);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (benchRunning != 0) {
+		fprintf(stderr, "syncbench: processes left blocked\n");
+		exit(1);
+	}
+	return ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+}
+
+int main(int argc, char *argv[]) {
+	double ns;
+
+	if (argc > 1) {
+		benchRounds = strtoul(argv[1], NULL, 0);
+		if (benchRounds == 0) {
+			benchRounds = 1;
+		}
+	}
+	if (syncInit() == -1) {
+		fprintf(stderr, "syncbench: cannot set up the sync objects\n");
+		return 1;
+	}
+
+	/* the objects belong to the process that creates them */
+	shPcbLink_p = &benchLink[0];
+	benchSem[0] = syncCreate(SYNC_SEMAPHORE, 0);
+	benchSem[1] = syncCreate(SYNC_SEMAPHORE, 0);
+	benchMutex = syncCreate(SYNC_MUTEX, 0);
+
+	ns = benchRun(benchPing, benchPong);
+	printf("semaphore ping-pong: %lu round trips, %.1f ns per handoff\n", benchRounds,
+			ns / (2.0 * benchRounds));
+
+	benchHandoffs = 0;
+	ns = benchRun(benchContend, benchContend);
+	printf("mutex contention:    %lu handoffs, %.1f ns per lock/unlock pair\n",
+			benchHandoffs, ns / (2.0 * benchRounds));
+
+	return 0;
+}